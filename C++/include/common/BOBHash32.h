@@ -260,4 +260,7 @@ BOBHash32::~BOBHash32()
 {
 
 }
+
+// keep the mixing macro from clashing with functions named mix elsewhere
+#undef mix
 #endif //_BOBHASH32_H
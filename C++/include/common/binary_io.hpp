@@ -0,0 +1,156 @@
+#pragma once
+#include <cstdio>
+#include <type_traits>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Read-only memory mapping of a whole file.
+    class MappedFile {
+    public:
+        /// @brief Map a file.
+        /// @param sequential Whether the file is read front to back, as
+        ///                   opposed to queried in place.
+        explicit MappedFile(const string& path, bool sequential = true);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// @brief Return the first byte of the file.
+        const u8* data() const { return addr; }
+
+        /// @brief Return the size of the file in bytes.
+        u64 size() const { return len; }
+
+    private:
+        const u8* addr = nullptr;   ///< Mapped file, @c nullptr if empty.
+        u64 len = 0;                ///< File size.
+    };
+
+    /// @brief Sequential writer of a sketch file.
+    /// @details A sketch file is a header followed by fields in host byte
+    ///          order. Counters are packed to the width their capacity
+    ///          needs, or varint-encoded if the file is compact.
+    class BinaryWriter {
+    public:
+        /// @brief Create a sketch file.
+        /// @param path Path of the file.
+        /// @param compact Whether counters are varint-encoded.
+        BinaryWriter(const string& path, bool compact);
+
+        ~BinaryWriter();
+
+        BinaryWriter(const BinaryWriter&) = delete;
+        BinaryWriter& operator=(const BinaryWriter&) = delete;
+
+        /// @brief Return whether counters are varint-encoded.
+        bool compact() const { return isCompact; }
+
+        /// @brief Write the sketch file header, with the selected
+        ///        @c HashFamily, as hashes are rebuilt from their seeds.
+        /// @param model Sketch model, see @c SketchModel.
+        /// @param meta META model, see @c MetaModel.
+        /// @param key_bytes Width of the flow keys.
+        void putHeader(u32 model, u32 meta, u32 key_bytes = sizeof(u32));
+
+        /// @brief Write a trivially copyable value.
+        template <typename T>
+        void put(const T& value) { putArray(&value, 1); }
+
+        /// @brief Write an array of trivially copyable values.
+        template <typename T>
+        void putArray(const T* values, u64 n);
+
+        /// @brief Write an unsigned value in LEB128.
+        void putVarint(u64 value);
+
+        /// @brief Write a counter in a given number of bytes.
+        /// @param width 1, 2 or 4, see @c packed_width.
+        void putPacked(u32 value, u32 width);
+
+        /// @brief Write an array of counters in a given number of bytes each.
+        void putPackedArray(const u32* values, u64 n, u32 width);
+
+        /// @brief Write a counter, packed or varint-encoded if compact.
+        void putCounter(u32 value, u32 width) {
+            isCompact ? putVarint(value) : putPacked(value, width);
+        }
+
+        /// @brief Flush and close the file.
+        void close();
+
+    private:
+        FILE* pf;           ///< Sketch file.
+        bool isCompact;     ///< Whether counters are varint-encoded.
+    };
+
+    /// @brief Bounds-checked sequential reader over a mapped sketch file.
+    class BinaryReader {
+    public:
+        /// @brief Read from a given memory range.
+        BinaryReader(const u8* data, u64 len);
+
+        /// @brief Return whether counters are varint-encoded.
+        bool compact() const { return isCompact; }
+
+        /// @brief Read and check the sketch file header, including the
+        ///        selected @c HashFamily.
+        /// @param model Expected sketch model.
+        /// @param meta Expected META model.
+        /// @param key_bytes Expected width of the flow keys.
+        void getHeader(u32 model, u32 meta, u32 key_bytes = sizeof(u32));
+
+        /// @brief Read a trivially copyable value.
+        template <typename T>
+        T get() {
+            T value;
+            getArray(&value, 1);
+            return value;
+        }
+
+        /// @brief Read an array of trivially copyable values.
+        template <typename T>
+        void getArray(T* values, u64 n);
+
+        /// @brief Read an unsigned value in LEB128.
+        u64 getVarint();
+
+        /// @brief Read a counter written by @c putPacked.
+        u32 getPacked(u32 width);
+
+        /// @brief Read an array written by @c putPackedArray.
+        void getPackedArray(u32* values, u64 n, u32 width);
+
+        /// @brief Read a counter written by @c putCounter.
+        u32 getCounter(u32 width) {
+            return isCompact ? static_cast<u32>(getVarint()) : getPacked(width);
+        }
+
+        /// @brief Return number of bytes left to read.
+        u64 remaining() const { return end - cur; }
+
+        /// @brief Skip a given number of bytes, to be read in place.
+        /// @return The first skipped byte.
+        const u8* skip(u64 n) { return take(n); }
+
+    private:
+        const u8* cur;          ///< Next byte.
+        const u8* end;          ///< End of the range.
+        bool isCompact = false; ///< Whether counters are varint-encoded.
+
+        /// @brief Reserve a given number of bytes to read.
+        const u8* take(u64 n);
+    };
+
+    /// @brief Return the bytes needed by a counter of a given capacity.
+    u32 packed_width(u32 cap);
+
+    /// @brief Read a counter written by @c BinaryWriter::putPacked in
+    ///        place.
+    /// @param src First byte of the counter.
+    /// @param width 1, 2 or 4, see @c packed_width.
+    u32 read_packed(const u8* src, u32 width);
+}   // namespace sketch
+
+#include "binary_io_impl.hpp"
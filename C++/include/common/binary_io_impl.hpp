@@ -0,0 +1,229 @@
+#pragma once
+#include "binary_io.hpp"
+#include "crc_hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sketch {
+    namespace sketch_file {
+        constexpr u32 MAGIC = 0x4b53344d;   ///< "M4SK" in little endian.
+        constexpr u32 VERSION = 6;          ///< Current format version.
+        constexpr u32 FLAG_COMPACT = 1;     ///< Counters are varint-encoded.
+    }   // namespace sketch_file
+
+    MappedFile::MappedFile(const string& path, bool sequential) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open file");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot stat file");
+        }
+        len = st.st_size;
+        if (len == 0) {
+            close(fd);
+            return;
+        }
+
+        void* res = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (res == MAP_FAILED) {
+            throw std::runtime_error("cannot map file");
+        }
+        madvise(res, len, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        addr = static_cast<const u8*>(res);
+    }
+
+    MappedFile::~MappedFile() {
+        if (addr) {
+            munmap(const_cast<u8*>(addr), len);
+        }
+    }
+
+    BinaryWriter::BinaryWriter(const string& path, bool compact)
+        : isCompact(compact) {
+        pf = fopen(path.c_str(), "wb");
+        if (!pf) {
+            throw std::runtime_error("cannot open file");
+        }
+        setvbuf(pf, nullptr, _IOFBF, 1 << 20);
+    }
+
+    BinaryWriter::~BinaryWriter() {
+        if (pf) {
+            fclose(pf);
+        }
+    }
+
+    void BinaryWriter::putHeader(u32 model, u32 meta, u32 key_bytes) {
+        put(sketch_file::MAGIC);
+        put(sketch_file::VERSION);
+        put(isCompact ? sketch_file::FLAG_COMPACT : 0u);
+        put(model);
+        put(meta);
+        put(key_bytes);
+        put(static_cast<u32>(HashFamily::selected()));
+    }
+
+    template <typename T>
+    void BinaryWriter::putArray(const T* values, u64 n) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "only trivially copyable types can be written");
+        if (n != 0 && fwrite_unlocked(values, sizeof(T), n, pf) != n) {
+            throw std::runtime_error("cannot write sketch file");
+        }
+    }
+
+    void BinaryWriter::putVarint(u64 value) {
+        u8 buf[10];
+        u32 n = 0;
+        for (; value >= 0x80; value >>= 7) {
+            buf[n++] = static_cast<u8>(value) | 0x80;
+        }
+        buf[n++] = static_cast<u8>(value);
+        putArray(buf, n);
+    }
+
+    void BinaryWriter::putPacked(u32 value, u32 width) {
+        switch (width) {
+            case 1: put(static_cast<u8>(value)); break;
+            case 2: put(static_cast<uint16_t>(value)); break;
+            default: put(value); break;
+        }
+    }
+
+    void BinaryWriter::putPackedArray(const u32* values, u64 n, u32 width) {
+        if (width == sizeof(u32)) {
+            putArray(values, n);
+            return;
+        }
+        // Narrow through a small buffer, so that the file is written in
+        // large blocks rather than one call per counter.
+        u8 buf[4096];
+        u64 per_buf = sizeof(buf) / width;
+        for (u64 i = 0; i < n; i += per_buf) {
+            u64 num = std::min(per_buf, n - i);
+            for (u64 j = 0; j < num; ++j) {
+                if (width == 1) {
+                    buf[j] = static_cast<u8>(values[i + j]);
+                } else {
+                    uint16_t v = static_cast<uint16_t>(values[i + j]);
+                    memcpy(buf + j * width, &v, width);
+                }
+            }
+            putArray(buf, num * width);
+        }
+    }
+
+    void BinaryWriter::close() {
+        int res = fclose(pf);
+        pf = nullptr;
+        if (res != 0) {
+            throw std::runtime_error("cannot write sketch file");
+        }
+    }
+
+    BinaryReader::BinaryReader(const u8* data, u64 len)
+        : cur(data), end(data + len) { }
+
+    void BinaryReader::getHeader(u32 model, u32 meta, u32 key_bytes) {
+        if (end - cur < 28 || get<u32>() != sketch_file::MAGIC) {
+            throw std::runtime_error("not a sketch file");
+        }
+        if (get<u32>() != sketch_file::VERSION) {
+            throw std::runtime_error("unsupported sketch file version");
+        }
+        isCompact = get<u32>() & sketch_file::FLAG_COMPACT;
+        if (get<u32>() != model || get<u32>() != meta) {
+            throw std::runtime_error("sketch file of another sketch type");
+        }
+        if (get<u32>() != key_bytes) {
+            throw std::runtime_error("sketch file of another key type");
+        }
+        if (get<u32>() != HashFamily::selected()) {
+            throw std::runtime_error("sketch file of another hash family");
+        }
+    }
+
+    template <typename T>
+    void BinaryReader::getArray(T* values, u64 n) {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "only trivially copyable types can be read");
+        if (n != 0) {
+            memcpy(values, take(n * sizeof(T)), n * sizeof(T));
+        }
+    }
+
+    u64 BinaryReader::getVarint() {
+        u64 res = 0;
+        for (u32 shift = 0; shift < 64; shift += 7) {
+            u8 byte = *take(1);
+            res |= static_cast<u64>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return res;
+            }
+        }
+        throw std::runtime_error("corrupt sketch file");
+    }
+
+    u32 BinaryReader::getPacked(u32 width) {
+        switch (width) {
+            case 1: return get<u8>();
+            case 2: return get<uint16_t>();
+            default: return get<u32>();
+        }
+    }
+
+    void BinaryReader::getPackedArray(u32* values, u64 n, u32 width) {
+        if (width == sizeof(u32)) {
+            getArray(values, n);
+            return;
+        }
+        const u8* src = take(n * width);
+        for (u64 i = 0; i < n; ++i) {
+            if (width == 1) {
+                values[i] = src[i];
+            } else {
+                uint16_t v;
+                memcpy(&v, src + i * width, width);
+                values[i] = v;
+            }
+        }
+    }
+
+    const u8* BinaryReader::take(u64 n) {
+        if (static_cast<u64>(end - cur) < n) {
+            throw std::runtime_error("truncated sketch file");
+        }
+        const u8* res = cur;
+        cur += n;
+        return res;
+    }
+
+    u32 packed_width(u32 cap) {
+        return cap <= UINT8_MAX ? 1 : cap <= UINT16_MAX ? 2 : 4;
+    }
+
+    u32 read_packed(const u8* src, u32 width) {
+        switch (width) {
+            case 1: return *src;
+            case 2: {
+                uint16_t v;
+                memcpy(&v, src, sizeof(v));
+                return v;
+            }
+            default: {
+                u32 v;
+                memcpy(&v, src, sizeof(v));
+                return v;
+            }
+        }
+    }
+}   // namespace sketch
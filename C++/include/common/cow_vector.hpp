@@ -0,0 +1,82 @@
+#pragma once
+#include <memory>
+#include "sketch_defs.hpp"
+#include "mem_usage.hpp"
+
+namespace sketch {
+    /// @brief Fixed-size vector stored as shared slabs with copy-on-write.
+    /// @details Copying a CowVector only copies its slab table, so a copy
+    ///          is cheap and both vectors share every slab. A slab is cloned
+    ///          the first time it is written through @c mut while shared,
+    ///          which leaves the other copies untouched. A vector never
+    ///          copied skips the sharing check, and elements are reached
+    ///          through raw slab pointers, so that a sketch taking no
+    ///          snapshots pays one extra load per access.
+    /// @warning Only one thread may write a given CowVector, but copies of
+    ///          it may be read from other threads at the same time.
+    /// @tparam Alloc Allocator of the slabs, which clones copy.
+    template <typename T, typename Alloc = std::allocator<T>>
+    class CowVector {
+        using Slab = vector<T, Alloc>;
+
+    public:
+        /// @brief Construct an empty vector.
+        CowVector() = default;
+
+        /// @brief Construct a vector holding copies of a given value.
+        /// @param num Number of elements.
+        /// @param value Value to fill with.
+        /// @param alloc Allocator of the slabs.
+        CowVector(u64 num, const T& value, const Alloc& alloc = Alloc());
+
+        /// @brief Share every slab with another vector, marking both as
+        ///        shared.
+        CowVector(const CowVector& other);
+        CowVector& operator=(const CowVector& other);
+
+        CowVector(CowVector&&) = default;
+        CowVector& operator=(CowVector&&) = default;
+
+        /// @brief Return number of elements.
+        u64 size() const { return num; }
+
+        /// @brief Read an element.
+        const T& operator[](u64 idx) const {
+            return ptrs[idx >> SLAB_BITS][idx & SLAB_MASK];
+        }
+
+        /// @brief Return the first element.
+        const T& front() const { return (*this)[0]; }
+
+        /// @brief Return a writable element, cloning its slab if shared.
+        T& mut(u64 idx);
+
+        /// @brief Overwrite every element with a given value, reusing
+        ///        unshared slabs in place.
+        void fill(const T& value);
+
+        /// @brief Return number of slabs cloned since construction.
+        u64 clones() const { return cloned; }
+
+        /// @brief Return the heap bytes of the slab table and the slabs,
+        ///        counting shared slabs in full.
+        u64 heapBytes() const;
+
+    private:
+        static constexpr u32 SLAB_BITS = 10;    ///< log2 of slab length.
+        static constexpr u64 SLAB_MASK = (1ull << SLAB_BITS) - 1;
+
+        vector<std::shared_ptr<Slab>> slabs;    ///< Slab table.
+        vector<T*> ptrs;                        ///< Elements of each slab.
+        u64 num = 0;                            ///< Number of elements.
+        u64 cloned = 0;                         ///< Number of slab clones.
+        /// Whether the vector was ever copied, set on the original by
+        /// the writer that copies it.
+        mutable bool shared = false;
+
+        /// @brief Replace a slab, keeping @c ptrs in step.
+        void replace(u64 s, std::shared_ptr<Slab> slab);
+    };
+}   // namespace sketch
+
+#include "cow_vector_impl.hpp"
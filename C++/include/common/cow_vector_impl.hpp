@@ -0,0 +1,73 @@
+#pragma once
+#include "cow_vector.hpp"
+#include <algorithm>
+
+namespace sketch {
+    template <typename T, typename Alloc>
+    CowVector<T, Alloc>::CowVector(u64 num_, const T& value,
+                                   const Alloc& alloc)
+        : num(num_) {
+        slabs.reserve((num + SLAB_MASK) >> SLAB_BITS);
+        for (u64 i = 0; i < num; i += SLAB_MASK + 1) {
+            u64 len = std::min(num - i, SLAB_MASK + 1);
+            slabs.push_back(std::make_shared<Slab>(len, value, alloc));
+            ptrs.push_back(slabs.back()->data());
+        }
+    }
+
+    template <typename T, typename Alloc>
+    CowVector<T, Alloc>::CowVector(const CowVector& other)
+        : slabs(other.slabs), ptrs(other.ptrs), num(other.num),
+          cloned(other.cloned), shared(true) {
+        // a copy of a copy finds the flag set, so readers copying a
+        // snapshot never write to it
+        if (!other.shared) {
+            other.shared = true;
+        }
+    }
+
+    template <typename T, typename Alloc>
+    auto CowVector<T, Alloc>::operator=(const CowVector& other) -> CowVector& {
+        if (this != &other) {
+            *this = CowVector(other);
+        }
+        return *this;
+    }
+
+    template <typename T, typename Alloc>
+    T& CowVector<T, Alloc>::mut(u64 idx) {
+        u64 s = idx >> SLAB_BITS;
+        if (shared && slabs[s].use_count() != 1) {
+            replace(s, std::make_shared<Slab>(*slabs[s]));
+            ++cloned;
+        }
+        return ptrs[s][idx & SLAB_MASK];
+    }
+
+    template <typename T, typename Alloc>
+    void CowVector<T, Alloc>::fill(const T& value) {
+        for (u64 s = 0; s < slabs.size(); ++s) {
+            if (slabs[s].use_count() == 1) {
+                std::fill(slabs[s]->begin(), slabs[s]->end(), value);
+            } else {
+                replace(s, std::make_shared<Slab>(
+                    slabs[s]->size(), value, slabs[s]->get_allocator()));
+            }
+        }
+    }
+
+    template <typename T, typename Alloc>
+    void CowVector<T, Alloc>::replace(u64 s, std::shared_ptr<Slab> slab) {
+        ptrs[s] = slab->data();
+        slabs[s] = std::move(slab);
+    }
+
+    template <typename T, typename Alloc>
+    u64 CowVector<T, Alloc>::heapBytes() const {
+        u64 res = heap_bytes(slabs) + heap_bytes(ptrs);
+        for (const auto& slab : slabs) {
+            res += sizeof(Slab) + heap_bytes(*slab);
+        }
+        return res;
+    }
+}   // namespace sketch
@@ -0,0 +1,73 @@
+#pragma once
+#include <ostream>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Hash functions the frameworks build their bucket hashes from,
+    ///        chosen once for the whole process.
+    class HashFamily {
+    public:
+        enum Family {
+            BOB,            ///< @c BOBHash32 with prime seeds.
+            CRC,            ///< CRC-32 variants of the Tofino pipeline.
+            NUM_FAMILIES,
+        };
+
+        /// @brief Select the family of hashes built from now on.
+        static void select(Family family) { current = family; }
+
+        /// @brief Return the selected family, @c BOB by default.
+        static Family selected() { return current; }
+
+        /// @brief Return the name of a family, as accepted by @c parse.
+        static const char* name(Family family);
+
+        /// @brief Parse a family name, bob or crc.
+        /// @throw std::invalid_argument if the name is unknown.
+        static Family parse(const string& name);
+
+    private:
+        inline static Family current = BOB;
+    };
+
+    /// @brief CRC-32 of a 32-bit flow ID, bit-exact with the @c Hash
+    ///        externs of @c M4.p4.
+    /// @details The pipeline hashes the ID field most significant bit first
+    ///          with three non-reflected polynomials, initial value and
+    ///          output XOR 0xFFFFFFFF. With a 32-bit message the CRC is
+    ///          ((init ^ id) * x^32) mod P ^ xorout, computed by two
+    ///          carry-less multiplies (Barrett reduction) when built with
+    ///          PCLMUL, and by four table lookups otherwise.
+    class CrcHash {
+    public:
+        /// Polynomials of hash_1, hash_2 and hash_3 of the pipeline.
+        static constexpr u32 VARIANTS = 3;
+        static constexpr u32 POLY[VARIANTS] = {
+            0x04C11DB7, 0x741B8CD7, 0xDB710641,
+        };
+        static constexpr u32 INIT = 0xFFFFFFFF;
+        static constexpr u32 XOROUT = 0xFFFFFFFF;
+
+        CrcHash() = default;
+
+        /// @brief Constructor.
+        /// @param variant Index of the polynomial, below @c VARIANTS.
+        /// @throw std::invalid_argument if there is no such variant.
+        explicit CrcHash(u32 variant);
+
+        /// @brief Return the CRC of a flow ID.
+        u32 run(u32 id) const;
+
+        /// @brief Return the CRC of a flow ID bit by bit, the reference
+        ///        @c run is checked against.
+        static u32 reference(u32 variant, u32 id);
+
+        /// @brief Write which implementation @c run uses.
+        static void report(std::ostream& out);
+
+    private:
+        u32 var = 0;    ///< Index of the polynomial.
+    };
+}   // namespace sketch
+
+#include "crc_hash_impl.hpp"
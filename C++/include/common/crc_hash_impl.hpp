@@ -0,0 +1,128 @@
+#pragma once
+#include "crc_hash.hpp"
+#include <array>
+#include <stdexcept>
+#ifdef __PCLMUL__
+#include <wmmintrin.h>
+#endif
+
+namespace sketch {
+    namespace crc {
+        /// Lookup tables of a polynomial: entry b of table k is
+        /// (b * x^(32 + 8k)) mod P, the contribution of byte k of the
+        /// message counted from the lowest.
+        using Tables = std::array<std::array<u32, 256>, 4>;
+
+        constexpr Tables make_tables(u32 poly) {
+            Tables res{};
+            for (u32 b = 0; b < 256; ++b) {
+                u32 crc = b << 24;
+                for (u32 i = 0; i < 8; ++i) {
+                    crc = crc & 0x80000000 ? crc << 1 ^ poly : crc << 1;
+                }
+                res[0][b] = crc;
+            }
+            for (u32 k = 1; k < 4; ++k) {
+                for (u32 b = 0; b < 256; ++b) {
+                    u32 prev = res[k - 1][b];
+                    res[k][b] = prev << 8 ^ res[0][prev >> 24];
+                }
+            }
+            return res;
+        }
+
+        /// @brief Return floor(x^64 / P), the Barrett constant of P, P
+        ///        taken with its implied x^32 term.
+        constexpr u64 barrett_mu(u32 poly) {
+            // long division of x^64: the remainder holds the top 33 bits,
+            // and each step yields a quotient bit and shifts in a zero
+            u64 full = (u64(1) << 32) | poly;
+            u64 rem = u64(1) << 32;
+            u64 quo = 0;
+            for (u32 i = 0; i <= 32; ++i) {
+                quo <<= 1;
+                if (rem & (u64(1) << 32)) {
+                    quo |= 1;
+                    rem ^= full;
+                }
+                rem <<= 1;
+            }
+            return quo;
+        }
+
+        inline constexpr Tables TABLES[CrcHash::VARIANTS] = {
+            make_tables(CrcHash::POLY[0]),
+            make_tables(CrcHash::POLY[1]),
+            make_tables(CrcHash::POLY[2]),
+        };
+
+        inline constexpr u64 MU[CrcHash::VARIANTS] = {
+            barrett_mu(CrcHash::POLY[0]),
+            barrett_mu(CrcHash::POLY[1]),
+            barrett_mu(CrcHash::POLY[2]),
+        };
+    }   // namespace crc
+
+    const char* HashFamily::name(Family family) {
+        switch (family) {
+            case BOB: return "bob";
+            case CRC: return "crc";
+            default: return "unknown";
+        }
+    }
+
+    HashFamily::Family HashFamily::parse(const string& name) {
+        for (u32 i = 0; i < NUM_FAMILIES; ++i) {
+            if (name == HashFamily::name(static_cast<Family>(i))) {
+                return static_cast<Family>(i);
+            }
+        }
+        throw std::invalid_argument("unknown hash family: " + name);
+    }
+
+    CrcHash::CrcHash(u32 variant) : var(variant) {
+        if (variant >= VARIANTS) {
+            throw std::invalid_argument(
+                "the CRC family has only three hash functions");
+        }
+    }
+
+    u32 CrcHash::run(u32 id) const {
+        u32 v = id ^ INIT;
+#ifdef __PCLMUL__
+        // q = floor(v * x^32 / P) = (v * mu) >> 32, and the remainder is
+        // v * x^32 - q * P, whose low 32 bits are those of q * P
+        __m128i p = _mm_cvtsi64_si128((u64(1) << 32) | POLY[var]);
+        __m128i q = _mm_clmulepi64_si128(
+            _mm_cvtsi64_si128(v), _mm_cvtsi64_si128(crc::MU[var]), 0);
+        q = _mm_srli_epi64(q, 32);
+        u32 crc = _mm_cvtsi128_si32(_mm_clmulepi64_si128(q, p, 0));
+#else
+        const crc::Tables& t = crc::TABLES[var];
+        u32 crc = t[3][v >> 24] ^ t[2][v >> 16 & 0xff] ^ t[1][v >> 8 & 0xff]
+                  ^ t[0][v & 0xff];
+#endif
+        return crc ^ XOROUT;
+    }
+
+    u32 CrcHash::reference(u32 variant, u32 id) {
+        u32 crc = INIT;
+        for (i32 bit = 31; bit >= 0; --bit) {
+            u32 in = id >> bit & 1;
+            u32 top = crc >> 31;
+            crc <<= 1;
+            if (top ^ in) {
+                crc ^= POLY[variant];
+            }
+        }
+        return crc ^ XOROUT;
+    }
+
+    void CrcHash::report(std::ostream& out) {
+#ifdef __PCLMUL__
+        out << "CRC hashes: PCLMUL Barrett reduction" << endl;
+#else
+        out << "CRC hashes: lookup tables" << endl;
+#endif
+    }
+}   // namespace sketch
@@ -0,0 +1,26 @@
+#pragma once
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Timestamp counter for timing single operations.
+    /// @details Reads the TSC on x86, fenced so that the timed operation
+    ///          cannot leak out of the interval, and a steady clock in
+    ///          nanoseconds elsewhere.
+    struct CycleClock {
+        /// @brief Return a timestamp opening an interval.
+        static u64 start();
+
+        /// @brief Return a timestamp closing an interval.
+        static u64 stop();
+
+        /// @brief Return timestamp ticks per nanosecond, calibrated
+        ///        against the steady clock on first use.
+        static f64 ticksPerNs();
+
+        /// @brief Return ticks of an empty interval, the floor of every
+        ///        sampled latency.
+        static u64 overhead();
+    };
+}   // namespace sketch
+
+#include "cycle_clock_impl.hpp"
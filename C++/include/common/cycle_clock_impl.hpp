@@ -0,0 +1,63 @@
+#pragma once
+#include "cycle_clock.hpp"
+#include <algorithm>
+#include <climits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace sketch {
+#if defined(__x86_64__) || defined(__i386__)
+    u64 CycleClock::start() {
+        _mm_lfence();
+        u64 t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+
+    u64 CycleClock::stop() {
+        unsigned aux;
+        u64 t = __rdtscp(&aux);
+        _mm_lfence();
+        return t;
+    }
+
+    f64 CycleClock::ticksPerNs() {
+        static const f64 ratio = [] {
+            auto begin = steady_clock::now();
+            u64 c0 = start();
+            while (steady_clock::now() - begin < milliseconds(20)) { }
+            u64 c1 = stop();
+            f64 ns = duration_cast<nanoseconds>(steady_clock::now() - begin)
+                         .count();
+            return (c1 - c0) / ns;
+        }();
+        return ratio;
+    }
+#else
+    u64 CycleClock::start() {
+        return duration_cast<nanoseconds>(
+                   steady_clock::now().time_since_epoch()).count();
+    }
+
+    u64 CycleClock::stop() {
+        return start();
+    }
+
+    f64 CycleClock::ticksPerNs() {
+        return 1.0;
+    }
+#endif
+
+    u64 CycleClock::overhead() {
+        static const u64 ticks = [] {
+            u64 res = UINT64_MAX;
+            for (u32 i = 0; i < 1000; ++i) {
+                u64 c0 = start();
+                res = std::min(res, stop() - c0);
+            }
+            return res;
+        }();
+        return ticks;
+    }
+}   // namespace sketch
@@ -4,4 +4,5 @@ const char* mawi_path = "/share/pcap_zhangyd/time07.dat";
 const char* seattle_path = "/share/M4_DATASET/SeattleData_all";
 const char* web_path = "/share/M4_DATASET/webget-all-simplify.dat";
 const char* criteo_path = "/share/M4_DATASET/criteo_attribution_dataset.tsv";
+const char* pcap_path = nullptr;    // capture given by --pcap
 const char* res_path = "./res_tmp/";
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstring>
+#include <type_traits>
+#include "BOBHash32.h"
+#include "crc_hash.hpp"
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief IPv4 5-tuple, packed to its 13 bytes so that it hashes and
+    ///        compares as plain memory.
+    struct FiveTuple {
+        u32 src_ip;
+        u32 dst_ip;
+        uint16_t src_port;
+        uint16_t dst_port;
+        u8 proto;
+    } __attribute__((packed));
+
+    static_assert(sizeof(FiveTuple) == 13, "5-tuple must be packed");
+
+    inline bool operator==(const FiveTuple& a, const FiveTuple& b) {
+        return std::memcmp(&a, &b, sizeof(FiveTuple)) == 0;
+    }
+
+    inline bool operator!=(const FiveTuple& a, const FiveTuple& b) {
+        return !(a == b);
+    }
+
+    /// @brief Byte-wise order, only to break ties deterministically.
+    inline bool operator<(const FiveTuple& a, const FiveTuple& b) {
+        return std::memcmp(&a, &b, sizeof(FiveTuple)) < 0;
+    }
+
+    /// @brief Seeded 32-bit hash of a fixed-width flow key.
+    /// @details The key is read as 64-bit words, each folded in with one
+    ///          multiply, then the state is finalized once, so a 13-byte
+    ///          5-tuple costs two multiplies more than a 64-bit ID and
+    ///          wider keys add one per 8 bytes. 32-bit keys keep
+    ///          @c BOBHash32 or the CRCs of @c HashFamily, see the
+    ///          specialization; wider keys ignore the family.
+    /// @tparam Key Trivially copyable key without padding bytes.
+    template <typename Key>
+    class KeyHash {
+        static_assert(std::is_trivially_copyable_v<Key>
+                          && std::has_unique_object_representations_v<Key>,
+                      "keys are hashed as their bytes");
+
+    public:
+        KeyHash() = default;
+
+        /// @brief Constructor, see @c initialize.
+        constexpr explicit KeyHash(u32 seed, u32 index = 0) {
+            initialize(seed, index);
+        }
+
+        /// @brief Derive the hash function from a seed.
+        /// @param seed Seed, any value.
+        /// @param index Unused, as for 32-bit keys.
+        constexpr void initialize(u32 seed, u32 index = 0);
+
+        /// @brief Return the hash value of a given key.
+        u32 run(const Key& key) const;
+
+    private:
+        u64 state = 0;  ///< Starting state, derived from the seed.
+    };
+
+    /// @brief 32-bit keys use the family selected by @c HashFamily when
+    ///        the hash is initialized: @c BOBHash32 as before, so that
+    ///        results of existing runs are reproduced exactly, or the CRC
+    ///        of the same index as the pipeline's.
+    template <>
+    class KeyHash<u32> {
+    public:
+        KeyHash() = default;
+
+        /// @brief Constructor, see @c initialize.
+        explicit KeyHash(u32 seed, u32 index = 0) { initialize(seed, index); }
+
+        /// @brief Pick the hash function.
+        /// @param seed Prime index of @c BOBHash32, below @c MAX_PRIME32.
+        /// @param index Index of the hash among those of a level, picking
+        ///              the CRC polynomial.
+        /// @throw std::invalid_argument if the CRC family has no such index.
+        void initialize(u32 seed, u32 index = 0);
+
+        u32 run(u32 key) const {
+            return family == HashFamily::CRC ? crc.run(key) : bob.run(key);
+        }
+
+    private:
+        HashFamily::Family family = HashFamily::BOB;
+        BOBHash32 bob;
+        CrcHash crc;
+    };
+
+    /// @brief How the key-storing frameworks keep a key in their buckets.
+    /// @details A bucket keeps a 32-bit word per flow, whatever the key
+    ///          width, so that the memory budget buys the same number of
+    ///          buckets. For 32-bit keys the word is the key itself, and
+    ///          flows can be enumerated. Wider keys keep a fingerprint of
+    ///          an independent hash instead, so two flows are confused
+    ///          only if they share a candidate bucket and their
+    ///          fingerprint, about once per 2^32 lookups, rather than as
+    ///          soon as the keys are folded to 32 bits.
+    template <typename Key>
+    struct KeyTraits {
+        /// Whether the word is the key, which can then be read back.
+        static constexpr bool exact = std::is_same_v<Key, u32>;
+
+        /// Word of an empty bucket.
+        static constexpr u32 EMPTY = UINT32_MAX;
+
+        /// @brief Return the word kept for a given key, never @c EMPTY
+        ///        for wider keys.
+        static u32 word(const Key& key);
+
+        /// @brief Return the key of a word, for exact keys only.
+        static Key key(u32 word);
+
+        /// @brief Return a key with every byte set, the key of an empty
+        ///        bucket where whole keys are kept.
+        static Key empty();
+    };
+
+    /// @brief Return the bucket of a flow other than a given one, knowing
+    ///        only its word, i.e. partial-key cuckoo hashing.
+    /// @details The two buckets of a flow add up to a hash of its word
+    ///          modulo the table size, so each is found from the other.
+    /// @param word Word of the flow, see @c KeyTraits.
+    /// @param bucket One bucket of the flow.
+    /// @param num Number of buckets.
+    u32 alt_bucket(u32 word, u32 bucket, u32 num);
+}   // namespace sketch
+
+#include "flow_key_impl.hpp"
@@ -0,0 +1,94 @@
+#pragma once
+#include "flow_key.hpp"
+
+namespace sketch {
+    namespace key_hash {
+        constexpr u64 MUL = 0x9e3779b97f4a7c15ull;  ///< 2^64 / golden ratio.
+        /// Seed of the fingerprints, apart from every bucket hash.
+        constexpr u32 FINGERPRINT_SEED = 0x5eed;
+
+        /// @brief Finalizer of MurmurHash3, mixing every bit into all.
+        constexpr u64 fmix64(u64 h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return h;
+        }
+    }   // namespace key_hash
+
+    template <typename Key>
+    constexpr void KeyHash<Key>::initialize(u32 seed, u32) {
+        state = key_hash::fmix64(seed + key_hash::MUL);
+    }
+
+    void KeyHash<u32>::initialize(u32 seed, u32 index) {
+        family = HashFamily::selected();
+        if (family == HashFamily::CRC) {
+            crc = CrcHash(index);
+        } else {
+            bob.initialize(seed);
+        }
+    }
+
+    template <typename Key>
+    u32 KeyHash<Key>::run(const Key& key) const {
+        const char* bytes = reinterpret_cast<const char*>(&key);
+        u64 h = state ^ sizeof(Key);
+        auto fold = [&h](u64 word) {
+            h = (h ^ word) * key_hash::MUL;
+            h ^= h >> 29;
+        };
+
+        if constexpr (sizeof(Key) < sizeof(u64)) {
+            u64 word = 0;
+            std::memcpy(&word, bytes, sizeof(Key));
+            fold(word);
+        } else {
+            // whole words, then the last 8 bytes, overlapping the previous
+            // word rather than copied into a padded one; the word count is
+            // a constant, so the loop unrolls
+            constexpr u32 WORDS = (sizeof(Key) + 7) / 8;
+            for (u32 i = 0; i + 1 < WORDS; ++i) {
+                u64 word;
+                std::memcpy(&word, bytes + 8 * i, 8);
+                fold(word);
+            }
+            u64 word;
+            std::memcpy(&word, bytes + sizeof(Key) - 8, 8);
+            fold(word);
+        }
+        return key_hash::fmix64(h) >> 32;
+    }
+
+    template <typename Key>
+    u32 KeyTraits<Key>::word(const Key& key) {
+        if constexpr (exact) {
+            return key;
+        } else {
+            static constexpr KeyHash<Key> fingerprint(
+                key_hash::FINGERPRINT_SEED);
+            u32 res = fingerprint.run(key);
+            return res != EMPTY ? res : EMPTY - 1;
+        }
+    }
+
+    template <typename Key>
+    Key KeyTraits<Key>::key(u32 word) {
+        static_assert(exact, "fingerprints cannot be turned back into keys");
+        return word;
+    }
+
+    template <typename Key>
+    Key KeyTraits<Key>::empty() {
+        Key res;
+        std::memset(&res, 0xff, sizeof(Key));
+        return res;
+    }
+
+    u32 alt_bucket(u32 word, u32 bucket, u32 num) {
+        u64 sum = key_hash::fmix64(word) % num;
+        return (sum + num - bucket) % num;
+    }
+}   // namespace sketch
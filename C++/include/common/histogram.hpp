@@ -18,6 +18,9 @@ namespace sketch {
         vec_f64 splitPoints() const { return m_splitPoints; }
         vec_u32 heights() const { return m_heights; }
 
+        /// @brief Return whether the histogram has no interval.
+        bool empty() const { return m_heights.empty(); }
+
         // Operations.
 
         /// @brief Perform 'and' operation on two histograms.
@@ -28,6 +31,14 @@ namespace sketch {
         /// @brief Estimate the quantile value of a given normalized rank.
         u32 quantile(f64 nom_rank) const;
 
+        /// @brief Estimate the quantile values of several normalized ranks
+        ///        at once, same as calling @c quantile for each of them.
+        /// @details Ascending ranks are answered in a single scan.
+        /// @param ranks Normalized ranks.
+        /// @param n Number of ranks.
+        /// @param out Quantile values, @p n of them.
+        void quantiles(const f64* ranks, u32 n, u32* out) const;
+
     private:
         // It must be satisfied that m_splitPoints and m_heights are sorted
         // and that m_splitPoints.size() == m_heights.size() + 1.
@@ -63,8 +63,16 @@ namespace sketch {
     }
 
     u32 Histogram::quantile(f64 nom_rank) const {
-        if (nom_rank < 0.0 || nom_rank > 1.0) {
-            throw std::invalid_argument("normalized rank out of range");
+        u32 res;
+        quantiles(&nom_rank, 1, &res);
+        return res;
+    }
+
+    void Histogram::quantiles(const f64* ranks, u32 n, u32* out) const {
+        for (u32 k = 0; k < n; ++k) {
+            if (ranks[k] < 0.0 || ranks[k] > 1.0) {
+                throw std::invalid_argument("normalized rank out of range");
+            }
         }
 
         u32 total_height = 0;
@@ -72,19 +80,28 @@ namespace sketch {
             total_height += h;
         }
         if (total_height == 0) {
-            return 0;
+            std::fill(out, out + n, 0);
+            return;
         }
-        u32 rk = nom_rank * total_height;
 
-        u32 l = 0, l_rk = 0;
-        for (; l_rk == 0 || l_rk < rk; l_rk += m_heights[l++]);
+        // The scan stops at the first interval whose cumulative height
+        // reaches the rank, so it resumes from there for a larger rank.
+        u32 l = 0, l_rk = 0, last_rk = 0;
+        for (u32 k = 0; k < n; ++k) {
+            u32 rk = ranks[k] * total_height;
+            if (rk < last_rk) {
+                l = l_rk = 0;
+            }
+            last_rk = rk;
+            for (; l_rk == 0 || l_rk < rk; l_rk += m_heights[l++]);
 
-        u32 r = l;
-        u32 r_rk = l_rk;
-        l_rk -= m_heights[--l];
+            u32 r = l;
+            u32 lo = l - 1;
+            u32 lo_rk = l_rk - m_heights[lo];
 
-        f64 p = static_cast<f64>(rk - l_rk) / (r_rk - l_rk);
-        f64 interval = m_splitPoints[r] - m_splitPoints[l];
-        return m_splitPoints[l] + p * interval;
+            f64 p = static_cast<f64>(rk - lo_rk) / (l_rk - lo_rk);
+            f64 interval = m_splitPoints[r] - m_splitPoints[lo];
+            out[k] = m_splitPoints[lo] + p * interval;
+        }
     }
 }   // namespace sketch
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Process-wide choice of the pages sketch arrays are backed by.
+    /// @details Frameworks read it when they allocate their bucket arrays,
+    ///          so it must be set before they are constructed. Every region
+    ///          tries the requested backing first and falls back to smaller
+    ///          pages, down to normal ones, when the system has none left.
+    class HugePages {
+    public:
+        /// Page backings, from smallest to largest.
+        enum Backing {
+            NORMAL,     ///< Normal pages.
+            THP,        ///< Transparent huge pages, through madvise.
+            HUGE_2MB,   ///< 2 MB pages of the hugetlb pool.
+            HUGE_1GB,   ///< 1 GB pages of the hugetlb pool.
+            NUM_BACKINGS
+        };
+
+        /// @brief Set the largest backing regions try, by default
+        ///        @c NORMAL, i.e. huge pages are off.
+        static void request(Backing backing) { requested = backing; }
+
+        /// @brief Return the largest backing regions try.
+        static Backing largest() { return requested; }
+
+        /// @brief Return the name of a backing, as given on command lines.
+        static const char* name(Backing backing);
+
+        /// @brief Return the backing of a given name.
+        /// @throw std::invalid_argument if the name is unknown.
+        static Backing parse(const string& name);
+
+        /// @brief Return bytes mapped so far by regions that obtained a
+        ///        given backing.
+        static u64 mapped(Backing backing) {
+            return mappedBytes[backing].load(std::memory_order_relaxed);
+        }
+
+        /// @brief Write the bytes mapped with each backing so far.
+        static void report(std::ostream& out);
+
+    private:
+        friend class HugeRegion;
+
+        inline static Backing requested = NORMAL;
+        inline static std::atomic<u64> mappedBytes[NUM_BACKINGS]{};
+    };
+
+    /// @brief Anonymous mapping that arrays are carved from, backed by
+    ///        huge pages where possible.
+    /// @details Allocation bumps a pointer and freeing is a no-op, since
+    ///          frameworks allocate their arrays once; the mapping is
+    ///          released with the region.
+    class HugeRegion {
+    public:
+        /// @brief Map at least a given number of bytes, trying backings
+        ///        from @c HugePages::largest down.
+        /// @throw std::bad_alloc if not even normal pages can be mapped.
+        explicit HugeRegion(u64 bytes);
+
+        ~HugeRegion();
+
+        HugeRegion(const HugeRegion&) = delete;
+        HugeRegion& operator=(const HugeRegion&) = delete;
+
+        /// @brief Carve an aligned block, @c nullptr if it does not fit.
+        void* allocate(u64 bytes, u64 align);
+
+        /// @brief Return whether a block was carved from the region.
+        bool owns(const void* p) const {
+            return p >= base && p < static_cast<const char*>(base) + len;
+        }
+
+        /// @brief Return the backing obtained.
+        HugePages::Backing backing() const { return type; }
+
+        /// @brief Return number of bytes mapped.
+        u64 size() const { return len; }
+
+        /// @brief Return number of bytes actually on huge pages, which
+        ///        for @c THP is what the kernel has collapsed so far.
+        u64 hugeBytes() const;
+
+    private:
+        void* base = nullptr;   ///< Start of the mapping.
+        u64 len = 0;            ///< Length of the mapping.
+        u64 used = 0;           ///< Bytes carved so far.
+        HugePages::Backing type = HugePages::NORMAL;
+
+        /// @brief Try to map with a given backing.
+        bool map(u64 bytes, HugePages::Backing backing);
+    };
+
+    /// @brief Return a region for arrays of a given total size, @c nullptr
+    ///        if huge pages are off or the arrays would not fill a single
+    ///        huge page.
+    std::shared_ptr<HugeRegion> make_huge_region(u64 bytes);
+
+    /// @brief Allocator carving blocks out of a shared @c HugeRegion, and
+    ///        from the heap if it has none or the region is exhausted.
+    template <typename T>
+    class HugePageAllocator {
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        HugePageAllocator() = default;
+
+        explicit HugePageAllocator(std::shared_ptr<HugeRegion> region_)
+            : region(std::move(region_)) { }
+
+        template <typename U>
+        HugePageAllocator(const HugePageAllocator<U>& other)
+            : region(other.region) { }
+
+        T* allocate(u64 n);
+        void deallocate(T* p, u64 n);
+
+        template <typename U>
+        bool operator==(const HugePageAllocator<U>& other) const {
+            return region == other.region;
+        }
+
+        template <typename U>
+        bool operator!=(const HugePageAllocator<U>& other) const {
+            return region != other.region;
+        }
+
+    private:
+        template <typename U>
+        friend class HugePageAllocator;
+
+        std::shared_ptr<HugeRegion> region;     ///< Region, may be null.
+    };
+
+    /// @brief Vector whose buffer may live on huge pages.
+    template <typename T>
+    using huge_vector = vector<T, HugePageAllocator<T>>;
+}   // namespace sketch
+
+#include "huge_pages_impl.hpp"
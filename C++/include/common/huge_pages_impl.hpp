@@ -0,0 +1,175 @@
+#pragma once
+#include "huge_pages.hpp"
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace sketch {
+    const char* HugePages::name(Backing backing) {
+        static constexpr const char* names[NUM_BACKINGS] = {
+            "normal", "thp", "2mb", "1gb"
+        };
+        if (backing >= NUM_BACKINGS) {
+            throw std::invalid_argument("unknown page backing");
+        }
+        return names[backing];
+    }
+
+    HugePages::Backing HugePages::parse(const string& name) {
+        for (u32 i = 0; i < NUM_BACKINGS; ++i) {
+            if (name == HugePages::name(static_cast<Backing>(i))) {
+                return static_cast<Backing>(i);
+            }
+        }
+        throw std::invalid_argument("unknown page backing: " + name);
+    }
+
+    void HugePages::report(std::ostream& out) {
+        out << "requested pages: " << name(requested) << endl;
+        for (u32 i = 0; i < NUM_BACKINGS; ++i) {
+            u64 bytes = mapped(static_cast<Backing>(i));
+            if (bytes != 0) {
+                out << "mapped on " << name(static_cast<Backing>(i)) << ": "
+                    << (bytes >> 20) << " MB" << endl;
+            }
+        }
+    }
+
+    HugeRegion::HugeRegion(u64 bytes) {
+        for (i32 b = HugePages::largest(); b >= HugePages::NORMAL; --b) {
+            if (map(bytes, static_cast<HugePages::Backing>(b))) {
+                HugePages::mappedBytes[type].fetch_add(
+                    len, std::memory_order_relaxed);
+                return;
+            }
+        }
+        throw std::bad_alloc();
+    }
+
+    HugeRegion::~HugeRegion() {
+        munmap(base, len);
+    }
+
+    bool HugeRegion::map(u64 bytes, HugePages::Backing backing) {
+        constexpr u64 PAGE_2MB = 1ull << 21;
+        constexpr u64 PAGE_1GB = 1ull << 30;
+        constexpr int PROT = PROT_READ | PROT_WRITE;
+        constexpr int FLAGS = MAP_PRIVATE | MAP_ANONYMOUS;
+
+        void* p = MAP_FAILED;
+        switch (backing) {
+        case HugePages::HUGE_1GB:
+            len = (bytes + PAGE_1GB - 1) & ~(PAGE_1GB - 1);
+            p = mmap(nullptr, len, PROT,
+                     FLAGS | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT), -1, 0);
+            break;
+        case HugePages::HUGE_2MB:
+            len = (bytes + PAGE_2MB - 1) & ~(PAGE_2MB - 1);
+            p = mmap(nullptr, len, PROT,
+                     FLAGS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+            break;
+        case HugePages::THP: {
+            // map one page more and trim, so that the region starts on a
+            // huge page boundary and every page of it can be collapsed
+            len = (bytes + PAGE_2MB - 1) & ~(PAGE_2MB - 1);
+            void* raw = mmap(nullptr, len + PAGE_2MB, PROT, FLAGS, -1, 0);
+            if (raw == MAP_FAILED) {
+                return false;
+            }
+            uintptr_t addr = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t start = (addr + PAGE_2MB - 1) & ~(PAGE_2MB - 1);
+            if (start != addr) {
+                munmap(raw, start - addr);
+            }
+            munmap(reinterpret_cast<void*>(start + len),
+                   addr + PAGE_2MB - start);
+            p = reinterpret_cast<void*>(start);
+            if (madvise(p, len, MADV_HUGEPAGE) != 0) {
+                munmap(p, len);
+                return false;
+            }
+            break;
+        }
+        default:
+            len = bytes;
+            p = mmap(nullptr, len, PROT, FLAGS, -1, 0);
+            break;
+        }
+
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        base = p;
+        type = backing;
+        return true;
+    }
+
+    void* HugeRegion::allocate(u64 bytes, u64 align) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(base);
+        uintptr_t start = (addr + used + align - 1) & ~(align - 1);
+        if (start + bytes > addr + len) {
+            return nullptr;
+        }
+        used = start + bytes - addr;
+        return reinterpret_cast<void*>(start);
+    }
+
+    u64 HugeRegion::hugeBytes() const {
+        if (type != HugePages::THP) {
+            return type == HugePages::NORMAL ? 0 : len;
+        }
+
+        // the kernel reports collapsed pages per mapping in smaps
+        FILE* pf = fopen("/proc/self/smaps", "r");
+        if (pf == nullptr) {
+            return 0;
+        }
+        char line[256];
+        char head[32];
+        snprintf(head, sizeof(head), "%lx-",
+                 static_cast<unsigned long>(reinterpret_cast<uintptr_t>(base)));
+        bool inside = false;
+        unsigned long long kb = 0;
+        while (fgets(line, sizeof(line), pf) != nullptr) {
+            if (strncmp(line, head, strlen(head)) == 0) {
+                inside = true;
+            } else if (inside
+                       && sscanf(line, "AnonHugePages: %llu kB", &kb) == 1) {
+                break;
+            }
+        }
+        fclose(pf);
+        return kb << 10;
+    }
+
+    std::shared_ptr<HugeRegion> make_huge_region(u64 bytes) {
+        if (HugePages::largest() == HugePages::NORMAL || bytes < (1ull << 21)) {
+            return nullptr;
+        }
+        return std::make_shared<HugeRegion>(bytes);
+    }
+
+    template <typename T>
+    T* HugePageAllocator<T>::allocate(u64 n) {
+        if (region) {
+            // cache-line aligned, so that buckets do not straddle lines
+            void* p = region->allocate(n * sizeof(T),
+                                       std::max<u64>(alignof(T), 64));
+            if (p != nullptr) {
+                return static_cast<T*>(p);
+            }
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    template <typename T>
+    void HugePageAllocator<T>::deallocate(T* p, u64 n) {
+        if (region && region->owns(p)) {
+            return;
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+}   // namespace sketch
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <type_traits>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    // Sketches report memory in two ways: memory() is the modeled budget,
+    // counters packed to the bits they need, while heapBytes() counts the
+    // bytes the objects really occupy. HeapTracker and rss_bytes measure
+    // the same from outside, to cross-check heapBytes().
+
+    /// @brief Return the heap bytes of a vector's buffer, plus the heap
+    ///        bytes its elements own if they report @c heapBytes.
+    template <typename T, typename Alloc>
+    u64 heap_bytes(const vector<T, Alloc>& v);
+
+    /// @brief Return the resident set size of the process in bytes, 0 if
+    ///        it cannot be read.
+    u64 rss_bytes();
+
+    /// @brief Return freed heap memory to the system, so that RSS reflects
+    ///        live allocations only.
+    void trim_heap();
+
+    /// @brief Count of live bytes allocated through @c operator @c new.
+    /// @details Counting is compiled in with @c TRACK_HEAP only, i.e.
+    ///          @c make @c TRACK=1, which replaces the global allocation
+    ///          functions. Blocks are counted by their usable size, so the
+    ///          count includes allocator rounding but not its headers.
+    class HeapTracker {
+    public:
+        /// @brief Return whether allocations are counted.
+        static constexpr bool enabled() {
+#ifdef TRACK_HEAP
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /// @brief Return the bytes allocated and not yet freed, 0 if
+        ///        allocations are not counted.
+        static u64 liveBytes() {
+            return live.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Count an allocated block.
+        static void add(void* p);
+        /// @brief Count a block about to be freed.
+        static void sub(void* p);
+
+    private:
+        inline static std::atomic<u64> live{0};
+    };
+}   // namespace sketch
+
+#include "mem_usage_impl.hpp"
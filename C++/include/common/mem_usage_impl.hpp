@@ -0,0 +1,176 @@
+#pragma once
+#include "mem_usage.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include <unistd.h>
+
+namespace sketch {
+    template <typename T, typename = void>
+    struct owns_heap : std::false_type { };
+
+    template <typename T>
+    struct owns_heap<T, std::void_t<decltype(std::declval<const T&>()
+                                             .heapBytes())>>
+        : std::true_type { };
+
+    template <typename T, typename Alloc>
+    u64 heap_bytes(const vector<T, Alloc>& v) {
+        u64 res = v.capacity() * sizeof(T);
+        if constexpr (owns_heap<T>::value) {
+            for (const T& x : v) {
+                res += x.heapBytes();
+            }
+        }
+        return res;
+    }
+
+    u64 rss_bytes() {
+        FILE* pf = fopen("/proc/self/statm", "r");
+        if (pf == nullptr) {
+            return 0;
+        }
+        unsigned long long pages = 0, resident = 0;
+        int got = fscanf(pf, "%llu %llu", &pages, &resident);
+        fclose(pf);
+        return got == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+    }
+
+    void trim_heap() {
+        malloc_trim(0);
+    }
+
+    void HeapTracker::add(void* p) {
+        live.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    }
+
+    void HeapTracker::sub(void* p) {
+        live.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+    }
+}   // namespace sketch
+
+#ifdef TRACK_HEAP
+// Replacements of every global allocation function. All of them share one
+// allocating and one releasing helper, kept out of line so that the
+// compiler never pairs an inlined free with a call to operator new.
+
+namespace sketch {
+    namespace tracked {
+        [[gnu::noinline]] void* allocate(std::size_t n, std::size_t align) {
+            void* p = nullptr;
+            n = n != 0 ? n : 1;
+            if (align <= alignof(std::max_align_t)) {
+                p = std::malloc(n);
+            } else if (posix_memalign(&p, align, n) != 0) {
+                p = nullptr;
+            }
+            if (p != nullptr) {
+                HeapTracker::add(p);
+            }
+            return p;
+        }
+
+        [[gnu::noinline]] void release(void* p) noexcept {
+            if (p != nullptr) {
+                HeapTracker::sub(p);
+                std::free(p);
+            }
+        }
+
+        void* allocateOrThrow(std::size_t n, std::size_t align) {
+            void* p = allocate(n, align);
+            if (p == nullptr) {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+    }   // namespace tracked
+}   // namespace sketch
+
+void* operator new(std::size_t n) {
+    return sketch::tracked::allocateOrThrow(n, 0);
+}
+
+void* operator new[](std::size_t n) {
+    return sketch::tracked::allocateOrThrow(n, 0);
+}
+
+void* operator new(std::size_t n, std::align_val_t al) {
+    return sketch::tracked::allocateOrThrow(n, std::size_t(al));
+}
+
+void* operator new[](std::size_t n, std::align_val_t al) {
+    return sketch::tracked::allocateOrThrow(n, std::size_t(al));
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    return sketch::tracked::allocate(n, 0);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    return sketch::tracked::allocate(n, 0);
+}
+
+void* operator new(std::size_t n, std::align_val_t al,
+                   const std::nothrow_t&) noexcept {
+    return sketch::tracked::allocate(n, std::size_t(al));
+}
+
+void* operator new[](std::size_t n, std::align_val_t al,
+                     const std::nothrow_t&) noexcept {
+    return sketch::tracked::allocate(n, std::size_t(al));
+}
+
+void operator delete(void* p) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+    sketch::tracked::release(p);
+}
+
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+    sketch::tracked::release(p);
+}
+#endif
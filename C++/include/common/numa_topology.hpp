@@ -0,0 +1,51 @@
+#pragma once
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief NUMA nodes the process may run on, with their CPUs.
+    /// @details Nodes are read from sysfs and restricted to the CPU affinity
+    ///          of the process. Without NUMA support, or when the process is
+    ///          confined to one node, the topology is a single node and
+    ///          every placement call is a no-op.
+    class NumaTopology {
+    public:
+        /// @brief Detect the topology of the calling process.
+        NumaTopology();
+
+        /// @brief Return number of nodes.
+        u32 nodes() const { return cpuSets.size(); }
+
+        /// @brief Return whether there is only one node, i.e. placement
+        ///        does nothing.
+        bool single() const { return nodes() <= 1; }
+
+        /// @brief Return the system ID of a node.
+        /// @param node Node index, in [0, @c nodes).
+        u32 id(u32 node) const { return ids[node]; }
+
+        /// @brief Return the CPUs of a node the process may run on.
+        /// @param node Node index, in [0, @c nodes).
+        const vector<u32>& cpus(u32 node) const { return cpuSets[node]; }
+
+        /// @brief Pin the calling thread to the CPUs of a node.
+        /// @param node Node index, in [0, @c nodes).
+        /// @return Whether the thread is pinned, false on a single node.
+        bool pinToNode(u32 node) const;
+
+        /// @brief Make pages first touched by the calling thread come from
+        ///        a node while it has free memory.
+        /// @param node Node index, in [0, @c nodes).
+        /// @return Whether the policy is set, false on a single node.
+        bool preferNode(u32 node) const;
+
+        /// @brief Return resident bytes of the process on each node, all
+        ///        counted on node 0 if they cannot be told apart.
+        vector<u64> residentBytes() const;
+
+    private:
+        vector<u32> ids;                ///< System ID of each node.
+        vector<vector<u32>> cpuSets;    ///< Allowed CPUs of each node.
+    };
+}   // namespace sketch
+
+#include "numa_topology_impl.hpp"
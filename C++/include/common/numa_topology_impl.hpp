@@ -0,0 +1,146 @@
+#pragma once
+#include "numa_topology.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+namespace sketch {
+    NumaTopology::NumaTopology() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            for (u32 cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+
+        vector<std::pair<u32, vector<u32>>> found;
+        const char* root = "/sys/devices/system/node";
+        if (DIR* dir = opendir(root)) {
+            while (dirent* entry = readdir(dir)) {
+                u32 node;
+                char rest;
+                if (sscanf(entry->d_name, "node%u%c", &node, &rest) != 1) {
+                    continue;
+                }
+                string path = string(root) + "/" + entry->d_name + "/cpulist";
+                FILE* pf = fopen(path.c_str(), "r");
+                if (pf == nullptr) {
+                    continue;
+                }
+
+                // a list of ranges like 0-3,8-11
+                vector<u32> cpus;
+                u32 lo, hi;
+                while (fscanf(pf, "%u", &lo) == 1) {
+                    hi = lo;
+                    int c = fgetc(pf);
+                    if (c == '-') {
+                        if (fscanf(pf, "%u", &hi) != 1) {
+                            break;
+                        }
+                        c = fgetc(pf);
+                    }
+                    for (u32 cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu) {
+                        if (CPU_ISSET(cpu, &allowed)) {
+                            cpus.push_back(cpu);
+                        }
+                    }
+                    if (c != ',') {
+                        break;
+                    }
+                }
+                fclose(pf);
+                if (!cpus.empty()) {
+                    found.emplace_back(node, std::move(cpus));
+                }
+            }
+            closedir(dir);
+        }
+
+        std::sort(found.begin(), found.end());
+        for (auto& [node, cpus] : found) {
+            ids.push_back(node);
+            cpuSets.push_back(std::move(cpus));
+        }
+        if (cpuSets.empty()) {
+            ids.push_back(0);
+            cpuSets.emplace_back();
+            for (u32 cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpuSets[0].push_back(cpu);
+                }
+            }
+        }
+    }
+
+    bool NumaTopology::pinToNode(u32 node) const {
+        if (single()) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (u32 cpu : cpuSets[node]) {
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    bool NumaTopology::preferNode(u32 node) const {
+        if (single()) {
+            return false;
+        }
+        // set_mempolicy through the raw system call, so that libnuma is
+        // not needed; the kernel reads maxnode - 1 bits of the mask
+        constexpr u32 WORD_BITS = 8 * sizeof(unsigned long);
+        unsigned long mask[1024 / WORD_BITS] = {};
+        u32 sys = ids[node];
+        if (sys >= 1024) {
+            return false;
+        }
+        mask[sys / WORD_BITS] |= 1ul << (sys % WORD_BITS);
+        return syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                       1024 + 1) == 0;
+    }
+
+    vector<u64> NumaTopology::residentBytes() const {
+        vector<u64> res(nodes(), 0);
+        FILE* pf = fopen("/proc/self/numa_maps", "r");
+        if (pf == nullptr) {
+            return res;
+        }
+
+        // each mapping lists its pages per node as N<id>=<pages>, and
+        // the page size as kernelpagesize_kB=<kB>
+        char line[4096];
+        vector<std::pair<u32, u64>> pages;
+        while (fgets(line, sizeof(line), pf) != nullptr) {
+            pages.clear();
+            u64 page_kb = 4;
+            char* save = nullptr;
+            for (char* tok = strtok_r(line, " \n", &save); tok != nullptr;
+                 tok = strtok_r(nullptr, " \n", &save)) {
+                u32 sys;
+                unsigned long long num;
+                if (sscanf(tok, "N%u=%llu", &sys, &num) == 2) {
+                    pages.emplace_back(sys, num);
+                } else if (sscanf(tok, "kernelpagesize_kB=%llu", &num) == 1) {
+                    page_kb = num;
+                }
+            }
+            for (auto [sys, num] : pages) {
+                u64 node = std::find(ids.begin(), ids.end(), sys) - ids.begin();
+                res[node < ids.size() ? node : 0] += num * page_kb * 1024;
+            }
+        }
+        fclose(pf);
+        return res;
+    }
+}   // namespace sketch
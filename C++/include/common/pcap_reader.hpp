@@ -0,0 +1,79 @@
+#pragma once
+#include "binary_io.hpp"
+
+namespace sketch {
+    /// @brief Zero-copy reader of M4 telemetry packets from a pcap or pcapng
+    ///        capture, mapped into memory as a whole.
+    /// @details Packets are parsed like the Tofino parser does, i.e.
+    ///          Ethernet, IPv4, UDP, then @c my_protocol_h carrying a 32-bit
+    ///          flow ID and a 16-bit latency in network byte order. Each
+    ///          telemetry packet becomes an item (flow ID, latency), other
+    ///          packets, and those with zero latency which no sketch takes,
+    ///          are counted and skipped.
+    class PcapReader {
+    public:
+        /// @brief Map a capture file.
+        /// @param path Path of a pcap or pcapng file.
+        explicit PcapReader(const string& path);
+
+        /// @brief Decode the next telemetry items of the capture.
+        /// @param items Output buffer.
+        /// @param n Capacity of @p items.
+        /// @return Number of decoded items, 0 at the end of the capture.
+        u32 read(FlowItem* items, u32 n);
+
+        /// @brief Append all remaining items to a sketch in batches.
+        /// @param sketch Any type with @c append(id, value), e.g. a Framework.
+        /// @param batch Items decoded per batch.
+        /// @return Number of appended items.
+        template <typename Sketch>
+        u64 replay(Sketch& sketch, u32 batch = 1024);
+
+        /// @brief Return number of packets seen so far.
+        u64 packets() const { return packetNum; }
+
+        /// @brief Return number of packets skipped as not telemetry.
+        u64 skipped() const { return skipNum; }
+
+    private:
+        static constexpr u32 LINKTYPE_ETHERNET = 1;
+        static constexpr u32 ETHERTYPE_IPV4 = 0x0800;
+        static constexpr u32 IPV4PROTOCOL_UDP = 17;
+        static constexpr u32 ETHERNET_LEN = 14;
+        static constexpr u32 UDP_LEN = 8;
+        static constexpr u32 MY_PROTOCOL_LEN = 6;
+
+        MappedFile file;            ///< Mapped capture.
+        const u8* data;             ///< First byte of @c file.
+        u64 len;                    ///< Capture size in bytes.
+        u64 pos = 0;                ///< Next record or block.
+        bool ng;                    ///< Whether the capture is pcapng.
+        bool swapped = false;       ///< Whether headers are byte-swapped.
+        u32 linkType = 0;           ///< Link type of a pcap capture.
+        vector<u32> ifLinkTypes;    ///< Link types of pcapng interfaces.
+        u64 packetNum = 0;          ///< Packets seen.
+        u64 skipNum = 0;            ///< Packets skipped.
+
+        /// @brief Return the next packet, @c nullptr at the end.
+        /// @param caplen Captured length of the packet.
+        /// @param link Link type of the packet.
+        const u8* nextPacket(u32& caplen, u32& link);
+
+        /// @brief Return the next pcapng packet, @c nullptr at the end.
+        const u8* nextBlock(u32& caplen, u32& link);
+
+        /// @brief Parse a packet into an item.
+        /// @return Whether it is a telemetry packet.
+        static bool parse(const u8* pkt, u32 caplen, FlowItem& item);
+
+        /// @brief Load a header field in capture byte order.
+        u32 load32(u64 off) const;
+        u32 load16(u64 off) const;
+
+        /// @brief Load a field in network byte order.
+        static u32 loadBE32(const u8* p);
+        static u32 loadBE16(const u8* p);
+    };
+}   // namespace sketch
+
+#include "pcap_reader_impl.hpp"
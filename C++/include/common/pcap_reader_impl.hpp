@@ -0,0 +1,201 @@
+#pragma once
+#include "pcap_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sketch {
+    namespace pcap {
+        constexpr u32 MAGIC_USEC = 0xa1b2c3d4;      ///< pcap, microseconds.
+        constexpr u32 MAGIC_NSEC = 0xa1b23c4d;      ///< pcap, nanoseconds.
+        constexpr u32 FILE_HEADER_LEN = 24;
+        constexpr u32 RECORD_HEADER_LEN = 16;
+
+        constexpr u32 SHB = 0x0a0d0d0a;             ///< Section header.
+        constexpr u32 IDB = 1;                      ///< Interface description.
+        constexpr u32 OPB = 2;                      ///< Obsolete packet.
+        constexpr u32 SPB = 3;                      ///< Simple packet.
+        constexpr u32 EPB = 6;                      ///< Enhanced packet.
+        constexpr u32 BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+    }   // namespace pcap
+
+    PcapReader::PcapReader(const string& path)
+        : file(path), data(file.data()), len(file.size()) {
+        if (len < 12) {
+            throw std::invalid_argument("not a capture file");
+        }
+
+        u32 magic;
+        memcpy(&magic, data, sizeof(magic));
+        if (magic == pcap::SHB) {
+            // The byte order is set by each section header, read later.
+            ng = true;
+            return;
+        }
+
+        ng = false;
+        if (magic == __builtin_bswap32(pcap::MAGIC_USEC)
+                || magic == __builtin_bswap32(pcap::MAGIC_NSEC)) {
+            swapped = true;
+        } else if (magic != pcap::MAGIC_USEC && magic != pcap::MAGIC_NSEC) {
+            throw std::invalid_argument("not a capture file");
+        }
+        if (len < pcap::FILE_HEADER_LEN) {
+            throw std::runtime_error("truncated capture");
+        }
+        linkType = load32(20) & 0xffff;
+        pos = pcap::FILE_HEADER_LEN;
+    }
+
+    u32 PcapReader::read(FlowItem* items, u32 n) {
+        u32 res = 0;
+        u32 caplen, link;
+        const u8* pkt;
+        while (res < n && (pkt = nextPacket(caplen, link)) != nullptr) {
+            ++packetNum;
+            if (link == LINKTYPE_ETHERNET && parse(pkt, caplen, items[res])) {
+                ++res;
+            } else {
+                ++skipNum;
+            }
+        }
+        return res;
+    }
+
+    template <typename Sketch>
+    u64 PcapReader::replay(Sketch& sketch, u32 batch) {
+        vector<FlowItem> items(batch);
+        u64 res = 0;
+        for (u32 n; (n = read(items.data(), batch)) != 0; res += n) {
+            for (u32 i = 0; i < n; ++i) {
+                sketch.append(items[i].id, items[i].value);
+            }
+        }
+        return res;
+    }
+
+    const u8* PcapReader::nextPacket(u32& caplen, u32& link) {
+        if (ng) {
+            return nextBlock(caplen, link);
+        }
+
+        if (pos + pcap::RECORD_HEADER_LEN > len) {
+            return nullptr;
+        }
+        caplen = load32(pos + 8);
+        const u8* pkt = data + pos + pcap::RECORD_HEADER_LEN;
+        pos += pcap::RECORD_HEADER_LEN + static_cast<u64>(caplen);
+        if (pos > len) {
+            throw std::runtime_error("truncated capture");
+        }
+        link = linkType;
+        return pkt;
+    }
+
+    const u8* PcapReader::nextBlock(u32& caplen, u32& link) {
+        while (pos + 12 <= len) {
+            u32 type;
+            memcpy(&type, data + pos, sizeof(type));
+            if (type == pcap::SHB) {
+                u32 bom;
+                memcpy(&bom, data + pos + 8, sizeof(bom));
+                if (bom == pcap::BYTE_ORDER_MAGIC) {
+                    swapped = false;
+                } else if (bom == __builtin_bswap32(pcap::BYTE_ORDER_MAGIC)) {
+                    swapped = true;
+                } else {
+                    throw std::runtime_error("corrupt section header");
+                }
+                ifLinkTypes.clear();
+            } else {
+                type = load32(pos);
+            }
+
+            u64 block = pos;
+            u32 block_len = load32(pos + 4);
+            if (block_len < 12 || block_len % 4 != 0 || pos + block_len > len) {
+                throw std::runtime_error("truncated capture");
+            }
+            pos += block_len;
+
+            u32 iface;
+            switch (type) {
+            case pcap::IDB:
+                ifLinkTypes.push_back(load16(block + 8));
+                continue;
+            case pcap::EPB:
+            case pcap::OPB:
+                if (block_len < 32) {
+                    throw std::runtime_error("truncated capture");
+                }
+                iface = type == pcap::EPB ? load32(block + 8)
+                                          : load16(block + 8);
+                caplen = load32(block + 20);
+                if (caplen > block_len - 32) {
+                    throw std::runtime_error("truncated capture");
+                }
+                link = iface < ifLinkTypes.size() ? ifLinkTypes[iface] : 0;
+                return data + block + 28;
+            case pcap::SPB:
+                if (block_len < 16) {
+                    throw std::runtime_error("truncated capture");
+                }
+                caplen = std::min(load32(block + 8), block_len - 16);
+                link = ifLinkTypes.empty() ? 0 : ifLinkTypes[0];
+                return data + block + 12;
+            default:
+                continue;
+            }
+        }
+        return nullptr;
+    }
+
+    bool PcapReader::parse(const u8* pkt, u32 caplen, FlowItem& item) {
+        if (caplen < ETHERNET_LEN
+                || loadBE16(pkt + 12) != ETHERTYPE_IPV4) {
+            return false;
+        }
+        pkt += ETHERNET_LEN;
+        caplen -= ETHERNET_LEN;
+
+        if (caplen < 20) {
+            return false;
+        }
+        u32 ihl = (pkt[0] & 0xf) * 4;
+        bool first_frag = (loadBE16(pkt + 6) & 0x1fff) == 0;
+        if ((pkt[0] >> 4) != 4 || ihl < 20 || pkt[9] != IPV4PROTOCOL_UDP
+                || !first_frag) {
+            return false;
+        }
+
+        // The data plane takes whatever follows the UDP header as
+        // my_protocol_h without checking the port, and so do we.
+        if (caplen < ihl + UDP_LEN + MY_PROTOCOL_LEN) {
+            return false;
+        }
+        const u8* my_protocol = pkt + ihl + UDP_LEN;
+        item.id = loadBE32(my_protocol);
+        item.value = loadBE16(my_protocol + 4);
+        return item.value != 0;
+    }
+
+    u32 PcapReader::load32(u64 off) const {
+        u32 v;
+        memcpy(&v, data + off, sizeof(v));
+        return swapped ? __builtin_bswap32(v) : v;
+    }
+
+    u32 PcapReader::load16(u64 off) const {
+        uint16_t v;
+        memcpy(&v, data + off, sizeof(v));
+        return swapped ? __builtin_bswap16(v) : v;
+    }
+
+    u32 PcapReader::loadBE32(const u8* p) {
+        return (u32(p[0]) << 24) | (u32(p[1]) << 16) | (u32(p[2]) << 8) | p[3];
+    }
+
+    u32 PcapReader::loadBE16(const u8* p) {
+        return (u32(p[0]) << 8) | p[1];
+    }
+}   // namespace sketch
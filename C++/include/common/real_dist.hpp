@@ -1,14 +1,40 @@
 #pragma once
-#include <unordered_map>
 #include "sketch_defs.hpp"
+#include "flow_key.hpp"
+#include "thread_pool.hpp"
+#include "trace_reader.hpp"
 
 namespace sketch {
+    /// @brief Exact value distribution of every flow of a dataset.
+    /// @details Values are stored in CSR layout: one array holding the
+    ///          values of all flows, each flow's values contiguous and
+    ///          sorted, and an offset per flow. Ranks and quantiles are
+    ///          binary searches and lookups, and queries are safe to run
+    ///          from several threads.
     class real_dist {
     public:
-        /// @brief Append a given item.
-        /// @param id Item ID.
-        /// @param value Item value.
-        void append(u32 id, u32 value);
+        /// @brief Construct an empty distribution.
+        real_dist() = default;
+
+        /// @brief Build the distribution of a dataset.
+        /// @details Counts the items of each flow, then fills every flow's
+        ///          slice of the values array in a second pass, and finally
+        ///          sorts the slices in parallel.
+        /// @param dataset Items of all flows.
+        /// @param pool Workers sorting the flows.
+        real_dist(const vector<FlowItem>& dataset, ThreadPool& pool);
+
+        /// @brief Build the distribution of a binary trace, reading it
+        ///        twice rather than holding its items.
+        /// @details With @p sample below 1, only the flows whose seeded hash
+        ///          falls below it are kept, each with all its values, so
+        ///          that memory scales with the sample and not the trace.
+        /// @param dataset Dataset name, see @c TraceReader::streamable.
+        /// @param pool Workers sorting the flows.
+        /// @param sample Expected share of the flows kept, in (0, 1].
+        /// @param seed Seed of the flow hash picking the sample.
+        real_dist(const string& dataset, ThreadPool& pool, f64 sample = 1,
+                  u32 seed = 0);
 
         /// @brief Return absolute rank of a given item.
         /// @param id Item ID.
@@ -36,9 +62,28 @@ namespace sketch {
         /// @param id Flow ID.
         FlowType type(u32 id) const;
 
+        /// @brief Return IDs of all flows in ascending order.
+        const vec_u32& flows() const { return ids; }
+
     private:
-        std::unordered_map<u32, vec_u32> container;  ///< Container.
+        vec_u32 ids;            ///< Flow IDs, sorted.
+        vector<u64> offsets;    ///< Start of each flow in @c values, and
+                                ///< the end of the last one.
+        vec_u32 values;         ///< Values of all flows, sorted per flow.
+
+        /// @brief Build from a function calling its argument on every
+        ///        item, once per pass.
+        template <typename Scan>
+        void build(Scan scan, ThreadPool& pool);
+
+        /// @brief Return the position of a given flow in @c ids.
+        /// @throw std::out_of_range if the flow is absent.
+        u32 find(u32 id) const;
+
+        /// @brief Return the first and past-the-last value of a flow.
+        const u32* begin(u32 idx) const { return values.data() + offsets[idx]; }
+        const u32* end(u32 idx) const { return values.data() + offsets[idx + 1]; }
     };
 }   // namespace sketch
 
-#include "real_dist_impl.hpp"
\ No newline at end of file
+#include "real_dist_impl.hpp"
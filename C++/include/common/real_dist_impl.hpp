@@ -1,16 +1,91 @@
 #include "real_dist.hpp"
-#include <numeric>
+#include <unordered_map>
 #include <cmath>
 #include <algorithm>
-#include "vec_ops.hpp"
+#include <stdexcept>
 
 namespace sketch {
-    void real_dist::append(u32 id, u32 value) {
-        container[id].push_back(value);
+    real_dist::real_dist(const vector<FlowItem>& dataset, ThreadPool& pool) {
+        build([&dataset](auto&& f) {
+            for (auto [id, value] : dataset) {
+                f(id, value);
+            }
+        }, pool);
+    }
+
+    real_dist::real_dist(const string& dataset, ThreadPool& pool, f64 sample,
+                         u32 seed) {
+        if (!(sample > 0.0 && sample <= 1.0)) {
+            throw std::invalid_argument("flow sample out of range");
+        }
+        // a flow is kept if the top 32 bits of its hash are below this
+        const u64 bound = std::ceil(std::ldexp(sample, 32));
+        const u64 key = u64(seed) << 32;
+        vector<FlowItem> batch(1 << 16);
+        build([&dataset, &batch, bound, key](auto&& f) {
+            TraceReader reader(dataset);
+            while (u32 num = reader.read(batch.data(), batch.size())) {
+                for (u32 i = 0; i < num; ++i) {
+                    u32 id = batch[i].id;
+                    if ((key_hash::fmix64(key | id) >> 32) < bound) {
+                        f(id, batch[i].value);
+                    }
+                }
+            }
+        }, pool);
+    }
+
+    template <typename Scan>
+    void real_dist::build(Scan scan, ThreadPool& pool) {
+        // first pass: count items per flow
+        std::unordered_map<u32, u32> slot;
+        u64 total = 0;
+        scan([&slot, &total](u32 id, u32) {
+            ++slot[id];
+            ++total;
+        });
+
+        ids.reserve(slot.size());
+        for (auto [id, cnt] : slot) {
+            ids.push_back(id);
+        }
+        std::sort(ids.begin(), ids.end());
+
+        offsets.resize(ids.size() + 1);
+        for (u32 i = 0; i < ids.size(); ++i) {
+            u32& s = slot[ids[i]];
+            offsets[i + 1] = offsets[i] + s;
+            s = i;
+        }
+
+        // second pass: fill every flow's slice
+        values.resize(total);
+        vector<u64> cursor(offsets.begin(), offsets.end() - 1);
+        scan([this, &slot, &cursor](u32 id, u32 value) {
+            values[cursor[slot[id]]++] = value;
+        });
+
+        pool.parallelFor(ids.size(), 256, [this](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; ++i) {
+                std::sort(values.begin() + offsets[i],
+                          values.begin() + offsets[i + 1]);
+            }
+        });
+    }
+
+    u32 real_dist::find(u32 id) const {
+        auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it == ids.end() || *it != id) {
+            throw std::out_of_range("flow not in the distribution");
+        }
+        return it - ids.begin();
     }
 
     u32 real_dist::rank(u32 id, u32 value, bool inclusive) const {
-        return vec_rank(container.at(id), value, inclusive);
+        u32 idx = find(id);
+        const u32* pos = inclusive ? std::upper_bound(begin(idx), end(idx), value)
+                                   : std::lower_bound(begin(idx), end(idx), value);
+        return pos - begin(idx);
     }
 
     f64 real_dist::nomRank(u32 id, u32 value, bool inclusive) const {
@@ -25,13 +100,12 @@ namespace sketch {
         u64 tmp = nom_rank * size(id) - inclusive;
         u32 idx = inclusive ? std::ceil(tmp) : tmp;
 
-        auto& vec = const_cast<real_dist*>(this)->container.at(id);
-        std::nth_element(vec.begin(), vec.begin() + idx, vec.end());
-        return vec[idx];
+        return begin(find(id))[idx];
     }
 
     u32 real_dist::size(u32 id) const {
-        return container.at(id).size();
+        u32 idx = find(id);
+        return offsets[idx + 1] - offsets[idx];
     }
 
     FlowType real_dist::type(u32 id) const {
@@ -40,4 +114,4 @@ namespace sketch {
         else if (sz <= 255) return MID;
         else return HUGE;
     }
-}   // namespace sketch
\ No newline at end of file
+}   // namespace sketch
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Sequence lock guarding a bucket or a small shared structure.
+    /// @details Writers take it exclusively and bump the version twice, so
+    ///          the version is odd while a write is in progress. Readers
+    ///          never block writers: they sample the version before reading
+    ///          and retry if it changed.
+    class SeqLock {
+    public:
+        /// @brief Construct an unlocked lock with version 0.
+        SeqLock() = default;
+
+        SeqLock(const SeqLock&) = delete;
+        SeqLock& operator=(const SeqLock&) = delete;
+
+        /// @brief Wait until no write is in progress and return the version.
+        u32 readBegin() const;
+
+        /// @brief Return if a write happened since @c readBegin returned
+        ///        a given version, i.e. the read must be retried.
+        /// @param version Version returned by @c readBegin.
+        bool readRetry(u32 version) const;
+
+        /// @brief Acquire the lock for writing.
+        void lock();
+
+        /// @brief Try to acquire the lock for writing without spinning.
+        bool tryLock();
+
+        /// @brief Release the lock.
+        void unlock();
+
+    private:
+        std::atomic<u32> ver{0};    ///< Version, odd while locked.
+
+        /// @brief Hint the CPU that we are spinning.
+        static void relax();
+    };
+}   // namespace sketch
+
+#include "seqlock_impl.hpp"
@@ -0,0 +1,43 @@
+#pragma once
+#include "seqlock.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sketch {
+    u32 SeqLock::readBegin() const {
+        u32 v;
+        while ((v = ver.load(std::memory_order_acquire)) & 1) {
+            relax();
+        }
+        return v;
+    }
+
+    bool SeqLock::readRetry(u32 version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return ver.load(std::memory_order_relaxed) != version;
+    }
+
+    void SeqLock::lock() {
+        while (!tryLock()) {
+            relax();
+        }
+    }
+
+    bool SeqLock::tryLock() {
+        u32 v = ver.load(std::memory_order_relaxed);
+        return (v & 1) == 0 && ver.compare_exchange_weak(
+            v, v + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void SeqLock::unlock() {
+        ver.store(ver.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+    }
+
+    void SeqLock::relax() {
+#ifdef __SSE2__
+        _mm_pause();
+#endif
+    }
+}   // namespace sketch
@@ -15,6 +15,7 @@ namespace sketch {
     using i32 = int32_t;
     using u32 = uint32_t;
     using u64 = uint64_t;
+    using i64 = int64_t;
     using f64 = double;
     using pair32 = std::pair<u8, u32>;
     using vec_f64 = vector<f64>;
@@ -33,17 +34,22 @@ namespace sketch {
     };
 
 
-    struct FlowItem {
-        u32 id;
+    /// @brief An item of a flow keyed by @p Key.
+    template <typename Key>
+    struct BasicFlowItem {
+        Key id;
         u32 value;
     };
 
+    using FlowItem = BasicFlowItem<u32>;
+
     // SketchModel is defined as enum not enum class
     // to allow for implicit conversion from/to u32.
     enum SketchModel {
         ANDOR,
         DLEFT,
         CUCKOO,
+        BCUCKOO,
         NUM_MODELS,
     };
 
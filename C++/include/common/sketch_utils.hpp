@@ -11,7 +11,8 @@
 #include <string>
 #include <sstream>
 #include "sketch_defs.hpp"
-#include "file_path.hpp"
+#include "trace_reader.hpp"
+#include "pcap_reader.hpp"
 
 struct Seattle_Tuple {
     uint64_t timestamp;
@@ -27,11 +28,12 @@ namespace sketch {
     // Random number generation.
 
     /// @brief Generate a random bit.
-    /// @warning This function is not thread-safe.
+    /// @details Every thread draws from its own generator, so sketches
+    ///          can be built on several threads at once.
     bool rand_bit() {
-        static std::random_device rd;
-        static std::default_random_engine gen(rd());
-        static std::bernoulli_distribution dis(0.5);
+        static thread_local std::random_device rd;
+        static thread_local std::default_random_engine gen(rd());
+        static thread_local std::bernoulli_distribution dis(0.5);
         return dis(gen);
     }
 
@@ -46,11 +48,49 @@ namespace sketch {
             return dis(gen);
         }
 
+        /// @brief Return the state in the standard text form of the
+        ///        engine and the distribution.
+        string state() const {
+            std::ostringstream out;
+            out << gen << ' ' << dis;
+            return out.str();
+        }
+
+        /// @brief Restore a state returned by @c state.
+        /// @throw std::runtime_error if it is malformed.
+        void setState(const string& state) {
+            std::istringstream in(state);
+            in >> gen >> dis;
+            if (!in || !(in >> std::ws).eof()) {
+                throw std::runtime_error("malformed generator state");
+            }
+        }
+
     private:
         std::default_random_engine gen;
         std::uniform_int_distribution<u32> dis;
     };
 
+    /// @brief Cheap xorshift32 generator for hot paths.
+    /// @details Unlike @c rand_u32_generator it carries a single word of
+    ///          state, so it can live inside a sketch and be stepped on
+    ///          every insertion without touching the standard library.
+    struct xorshift32 {
+        /// @brief Construct a generator with given seed.
+        explicit xorshift32(u32 seed = 0) : state(seed ? seed : 0x9e3779b9) { }
+
+        /// @brief Generate a random u32.
+        u32 operator()() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+    private:
+        u32 state;
+    };
+
     // Others.
 
     bool f64_equal(f64 a, f64 b) {
@@ -59,53 +99,33 @@ namespace sketch {
 
 
     vector<FlowItem> load_dataset(const string& dataset) {
-        const char* filename;
-        if(dataset=="caida") {
-            filename = caida_path;
-        } else if (dataset=="imc") {
-            filename = imc_path;
-        }
-        else if (dataset == "seattle") {
-            filename = seattle_path;
-        }
-        else if (dataset == "web") {
-            filename = web_path;
+        vector<FlowItem> vec;
+
+        if (TraceReader::streamable(dataset)) {
+            TraceReader reader(dataset);
+            FlowItem items[1024];
+            for (u32 n; (n = reader.read(items, 1024)) != 0; ) {
+                vec.insert(vec.end(), items, items + n);
+            }
+            return vec;
         }
-        else if (dataset == "criteo") {
-            filename = criteo_path;
+
+        const char* filename = dataset_path(dataset);
+        if (filename == pcap_path) {
+            PcapReader reader(filename);
+            FlowItem items[1024];
+            for (u32 n; (n = reader.read(items, 1024)) != 0; ) {
+                vec.insert(vec.end(), items, items + n);
+            }
+            return vec;
         }
-        else if (dataset=="MAWI") {
-            filename = mawi_path;
-        } else {
-            throw std::invalid_argument("unknown dataset");
-        }    
 
         FILE* pf = fopen(filename, "rb");
         if(!pf){
             throw std::runtime_error("cannot open file");
         }
 
-        vector<FlowItem> vec;
-        double ftime = -1;
-        long long fime = -1;
-        char trace[30];
-
-        if(filename == caida_path){
-            while(fread(trace, 1, 21, pf)){
-                uint32_t tkey = *(uint32_t*) (trace);
-                double ttime = *(double*) (trace+13);
-                if(ftime<0)ftime=ttime;
-                vec.emplace_back((FlowItem){tkey, u32((ttime-ftime)*10000000)+1});
-            }
-        }else if(filename == imc_path){
-            while(fread(trace, 1, 26, pf)){
-                uint32_t tkey = *(uint32_t*) (trace);
-                long long ttimee = *(long long*) (trace+18);
-                if(fime<0)fime=ttimee;
-                vec.emplace_back((FlowItem){tkey, u32((ttimee-fime)/100)+1});
-            }
-        }
-        else if (filename == criteo_path) {
+        if (filename == criteo_path) {
             int i = 0;
            // string temp1; 
            // string temp2;
@@ -216,14 +236,6 @@ namespace sketch {
                 vec.push_back(k);
             }
         }
-        else{
-            while(fread(trace, 1, 21, pf)){
-                uint32_t tkey = *(uint32_t*) (trace);
-                long long ttime = *(long long*) (trace+13);
-                if(fime<0)fime=ttime;
-                vec.emplace_back((FlowItem){tkey, u32((ttime-fime)*100000)+1});
-            }
-        }
         fclose(pf);
 
         return vec;
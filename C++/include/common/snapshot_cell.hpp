@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Publication point for immutable snapshots of a sketch.
+    /// @details The thread updating a sketch publishes snapshots, and any
+    ///          thread may pick up the latest one. Each publication starts
+    ///          a new epoch. Readers that need a fresher view than the
+    ///          latest ask for one, and the writer publishes it at its next
+    ///          safe point.
+    /// @tparam T Snapshot type.
+    template <typename T>
+    class SnapshotCell {
+    public:
+        using Snapshot = std::shared_ptr<const T>;
+
+        SnapshotCell() = default;
+
+        /// @brief Copies start with no snapshot, so a snapshot of a sketch
+        ///        does not keep its parent's publication state.
+        SnapshotCell(const SnapshotCell&) : SnapshotCell() { }
+        SnapshotCell& operator=(const SnapshotCell&) { return *this; }
+
+        /// @brief Make a snapshot the latest one and start a new epoch.
+        /// @warning Call from the writer thread only.
+        void publish(Snapshot snap);
+
+        /// @brief Return the latest snapshot, @c nullptr before the first.
+        Snapshot latest() const;
+
+        /// @brief Return the current epoch, i.e. the number of publications.
+        u64 epoch() const;
+
+        /// @brief Ask the writer to publish a snapshot at its next safe point.
+        /// @return The epoch whose snapshot will satisfy the request.
+        u64 request() const;
+
+        /// @brief Return if a reader is waiting for a snapshot.
+        bool pending() const {
+            return requested.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Wait until a given epoch is published and return the
+        ///        latest snapshot.
+        /// @warning Blocks forever if the writer never reaches a safe point.
+        Snapshot wait(u64 target) const;
+
+    private:
+        Snapshot snap;                              ///< Latest snapshot.
+        std::atomic<u64> cur_epoch{0};              ///< Current epoch.
+        mutable std::atomic<bool> requested{false}; ///< Pending request.
+    };
+}   // namespace sketch
+
+#include "snapshot_cell_impl.hpp"
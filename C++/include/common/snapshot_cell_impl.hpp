@@ -0,0 +1,38 @@
+#pragma once
+#include "snapshot_cell.hpp"
+#include <thread>
+
+namespace sketch {
+    template <typename T>
+    void SnapshotCell<T>::publish(Snapshot next) {
+        requested.store(false, std::memory_order_relaxed);
+        std::atomic_store_explicit(&snap, std::move(next),
+                                   std::memory_order_release);
+        cur_epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    template <typename T>
+    auto SnapshotCell<T>::latest() const -> Snapshot {
+        return std::atomic_load_explicit(&snap, std::memory_order_acquire);
+    }
+
+    template <typename T>
+    u64 SnapshotCell<T>::epoch() const {
+        return cur_epoch.load(std::memory_order_acquire);
+    }
+
+    template <typename T>
+    u64 SnapshotCell<T>::request() const {
+        u64 target = epoch() + 1;
+        requested.store(true, std::memory_order_relaxed);
+        return target;
+    }
+
+    template <typename T>
+    auto SnapshotCell<T>::wait(u64 target) const -> Snapshot {
+        while (epoch() < target) {
+            std::this_thread::yield();
+        }
+        return latest();
+    }
+}   // namespace sketch
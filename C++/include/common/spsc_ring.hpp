@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Bounded lock-free queue between one producer and one consumer.
+    /// @details The two indices live on separate cache lines, and each side
+    ///          caches the other side's index so that it only touches the
+    ///          shared line when the queue looks full or empty.
+    template <typename T>
+    class SpscRing {
+    public:
+        /// @brief Constructor.
+        /// @param capacity Minimum number of elements, rounded up to a power
+        ///                 of two.
+        explicit SpscRing(u32 capacity);
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /// @brief Push an element if there is room, producer only.
+        bool tryPush(const T& value);
+
+        /// @brief Pop an element if there is one, consumer only.
+        bool tryPop(T& value);
+
+        /// @brief Push an element, waiting while the queue is full.
+        void push(const T& value);
+
+        /// @brief Pop an element, waiting while the queue is empty.
+        void pop(T& value);
+
+        /// @brief Return number of queued elements. Exact only when called
+        ///        from one of the two sides.
+        u32 depth() const;
+
+        /// @brief Return maximum number of queued elements.
+        u32 capacity() const { return mask + 1; }
+
+        /// @brief Return number of pushes that found the queue full.
+        u64 pushStalls() const {
+            return pushStall.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Return number of pops that found the queue empty.
+        u64 popStalls() const {
+            return popStall.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr u32 CACHE_LINE = 64;   ///< Bytes per cache line.
+        static constexpr u32 SPIN_NUM = 64;     ///< Spins before yielding.
+
+        vector<T> buf;      ///< Elements.
+        u32 mask;           ///< Capacity minus one.
+
+        // Consumer side.
+        alignas(CACHE_LINE) std::atomic<u32> head{0};   ///< Next to pop.
+        u32 cachedTail = 0;                 ///< Last seen @c tail.
+        std::atomic<u64> popStall{0};       ///< Pops that had to wait.
+
+        // Producer side.
+        alignas(CACHE_LINE) std::atomic<u32> tail{0};   ///< Next to push.
+        u32 cachedHead = 0;                 ///< Last seen @c head.
+        std::atomic<u64> pushStall{0};      ///< Pushes that had to wait.
+
+        /// @brief Back off while waiting for the other side.
+        static void backoff(u32& spins);
+    };
+}   // namespace sketch
+
+#include "spsc_ring_impl.hpp"
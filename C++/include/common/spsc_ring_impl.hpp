@@ -0,0 +1,86 @@
+#pragma once
+#include "spsc_ring.hpp"
+#include <stdexcept>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sketch {
+    template <typename T>
+    SpscRing<T>::SpscRing(u32 capacity) {
+        if (capacity == 0 || capacity > (1u << 31)) {
+            throw std::invalid_argument("ring capacity out of range");
+        }
+        u32 cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        buf = vector<T>(cap);
+        mask = cap - 1;
+    }
+
+    template <typename T>
+    bool SpscRing<T>::tryPush(const T& value) {
+        u32 t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) {
+                return false;
+            }
+        }
+        buf[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename T>
+    bool SpscRing<T>::tryPop(T& value) {
+        u32 h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        value = buf[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename T>
+    void SpscRing<T>::push(const T& value) {
+        if (tryPush(value)) {
+            return;
+        }
+        pushStall.fetch_add(1, std::memory_order_relaxed);
+        for (u32 spins = 0; !tryPush(value); backoff(spins));
+    }
+
+    template <typename T>
+    void SpscRing<T>::pop(T& value) {
+        if (tryPop(value)) {
+            return;
+        }
+        popStall.fetch_add(1, std::memory_order_relaxed);
+        for (u32 spins = 0; !tryPop(value); backoff(spins));
+    }
+
+    template <typename T>
+    u32 SpscRing<T>::depth() const {
+        // Load head first, tail never falls behind a head seen earlier.
+        u32 h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+    template <typename T>
+    void SpscRing<T>::backoff(u32& spins) {
+        if (++spins < SPIN_NUM) {
+#ifdef __SSE2__
+            _mm_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}   // namespace sketch
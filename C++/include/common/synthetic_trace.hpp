@@ -0,0 +1,129 @@
+#pragma once
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Parameters of a synthetic trace.
+    /// @details A trace is named by a spec, @c synth optionally followed by
+    ///          a colon and comma-separated @c name=value overrides, e.g.
+    ///          <tt>synth:flows=1e8,items=1e10,value=pareto</tt>.
+    struct SyntheticConfig {
+        u64 flows = 1000000;        ///< Number of flow IDs, at most 2^32.
+        u64 items = 10000000;       ///< Number of items.
+        f64 skew = 1.0;             ///< Zipf exponent of flow sizes.
+        u32 seed = 0;               ///< Seed of IDs and randomness.
+
+        /// Value distribution of every flow.
+        enum ValueDist {
+            LOGNORMAL,  ///< exp(N(mu, sigma)).
+            PARETO,     ///< Pareto of scale xm and shape.
+            BIMODAL,    ///< Lognormal (mu, sigma) with probability weight,
+                        ///< else lognormal (mu2, sigma2).
+        } value = LOGNORMAL;
+        f64 mu = 7, sigma = 1;
+        f64 mu2 = 10, sigma2 = 0.5;
+        f64 weight = 0.9;
+        f64 xm = 100, shape = 1.5;
+        /// Sigma of the lognormal scale each flow multiplies its values
+        /// by, so that flows differ in their quantiles.
+        f64 flow_sigma = 0.5;
+        /// Relative change of values from the first to the last item.
+        f64 drift = 0;
+
+        /// How items of different flows interleave.
+        enum Arrival {
+            IID,        ///< Every item draws its flow afresh.
+            BURST,      ///< Flows come in runs of geometric length.
+            CHURN,      ///< Flow popularity slides over the ID space.
+        } arrival = IID;
+        f64 burst = 8;      ///< Mean run length of @c BURST.
+        /// Share of the flows whose popularity rank the whole trace of
+        /// @c CHURN shifts them by.
+        f64 churn = 1;
+
+        /// @brief Return whether a dataset name is a synthetic spec.
+        static bool isSpec(const string& dataset);
+
+        /// @brief Parse a synthetic spec.
+        /// @throw std::invalid_argument if it is malformed or describes
+        ///        an impossible trace.
+        static SyntheticConfig parse(const string& spec);
+
+        /// @brief Check the parameters.
+        /// @throw std::invalid_argument if they are out of range.
+        void validate() const;
+    };
+
+    /// @brief Deterministic generator of a synthetic trace, read in chunks
+    ///        like @c TraceReader so that it streams into the ingestion
+    ///        path without ever being stored.
+    /// @details Flow ranks follow a Zipf law, sampled by rejection-inversion
+    ///          in constant time and space whatever the number of flows,
+    ///          and map to IDs through a bijective mixer. The same config
+    ///          always yields the same items, on any platform, since the
+    ///          generator draws from its own splitmix64 stream.
+    class SyntheticTrace {
+    public:
+        explicit SyntheticTrace(const SyntheticConfig& config);
+
+        /// @brief Generate the next items of the trace.
+        /// @param items Output buffer.
+        /// @param n Capacity of @p items.
+        /// @return Number of generated items, 0 at the end of the trace.
+        u32 read(FlowItem* items, u32 n);
+
+        /// @brief Return number of items generated so far.
+        u64 position() const { return pos; }
+
+    private:
+        static constexpr u64 GOLDEN = 0x9e3779b97f4a7c15;
+
+        SyntheticConfig cfg;
+        u64 state;          ///< splitmix64 state.
+        u64 pos = 0;        ///< Items generated so far.
+        u32 idKey;          ///< Key mixed into flow IDs.
+        u64 flowKey;        ///< Key of the per-flow value scales.
+
+        // Rejection-inversion constants, see Hörmann and Derflinger,
+        // "Rejection-inversion to generate variates from monotone
+        // discrete distributions", 1996.
+        f64 hX1;            ///< H(1.5) - 1.
+        f64 hN;             ///< H(flows + 0.5).
+        f64 zipfS;          ///< Acceptance shortcut.
+
+        u64 runRank = 0;    ///< Rank of the current @c BURST run.
+        u64 runLeft = 0;    ///< Items left in the current run.
+        f64 geoDiv;         ///< log(1 - 1 / burst), for run lengths.
+
+        f64 spare = 0;          ///< Unused variate of @c normal.
+        bool hasSpare = false;  ///< Whether @c spare is set.
+
+        /// @brief Finalizer of splitmix64.
+        static u64 mix(u64 z);
+        /// @brief Map 64 random bits to a double in (0, 1].
+        static f64 toUnit(u64 bits);
+
+        u64 next();
+        /// @brief Return a uniform double in (0, 1].
+        f64 uniform();
+        /// @brief Return a standard normal variate.
+        f64 normal();
+        /// @brief Return an approximately standard normal variate fixed
+        ///        by a key.
+        static f64 hashNormal(u64 key);
+
+        /// @brief Sample a Zipf rank in [0, flows).
+        u64 zipf();
+        f64 h(f64 x) const;
+        f64 hIntegral(f64 x) const;
+        f64 hIntegralInverse(f64 x) const;
+
+        /// @brief Return the rank of the flow of the next item.
+        u64 nextRank();
+        /// @brief Return the ID of a flow rank.
+        u32 flowId(u64 rank) const;
+        /// @brief Draw a value of a given flow.
+        u32 value(u32 id);
+    };
+}   // namespace sketch
+
+#include "synthetic_trace_impl.hpp"
@@ -0,0 +1,253 @@
+#pragma once
+#include "synthetic_trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace sketch {
+    bool SyntheticConfig::isSpec(const string& dataset) {
+        return dataset == "synth" || dataset.rfind("synth:", 0) == 0;
+    }
+
+    SyntheticConfig SyntheticConfig::parse(const string& spec) {
+        if (!isSpec(spec)) {
+            throw std::invalid_argument("not a synthetic spec");
+        }
+
+        SyntheticConfig res;
+        u64 begin = spec.find(':');
+        while (begin != string::npos && begin + 1 < spec.size()) {
+            ++begin;
+            u64 end = std::min(spec.find(',', begin), spec.size());
+            string field = spec.substr(begin, end - begin);
+            u64 eq = field.find('=');
+            if (eq == string::npos) {
+                throw std::invalid_argument("malformed synthetic field");
+            }
+            string name = field.substr(0, eq);
+            string val = field.substr(eq + 1);
+
+            f64 num = 0;
+            bool numeric = true;
+            try {
+                u64 used;
+                num = std::stod(val, &used);
+                numeric = used == val.size();
+            } catch (const std::logic_error&) {
+                numeric = false;
+            }
+            auto number = [&]() {
+                if (!numeric) {
+                    throw std::invalid_argument("malformed synthetic value");
+                }
+                return num;
+            };
+
+            if (name == "flows") res.flows = number();
+            else if (name == "items") res.items = number();
+            else if (name == "skew") res.skew = number();
+            else if (name == "seed") res.seed = number();
+            else if (name == "mu") res.mu = number();
+            else if (name == "sigma") res.sigma = number();
+            else if (name == "mu2") res.mu2 = number();
+            else if (name == "sigma2") res.sigma2 = number();
+            else if (name == "weight") res.weight = number();
+            else if (name == "xm") res.xm = number();
+            else if (name == "shape") res.shape = number();
+            else if (name == "flow_sigma") res.flow_sigma = number();
+            else if (name == "drift") res.drift = number();
+            else if (name == "burst") res.burst = number();
+            else if (name == "churn") res.churn = number();
+            else if (name == "value") {
+                if (val == "lognormal") res.value = LOGNORMAL;
+                else if (val == "pareto") res.value = PARETO;
+                else if (val == "bimodal") res.value = BIMODAL;
+                else throw std::invalid_argument("unknown value distribution");
+            } else if (name == "arrival") {
+                if (val == "iid") res.arrival = IID;
+                else if (val == "burst") res.arrival = BURST;
+                else if (val == "churn") res.arrival = CHURN;
+                else throw std::invalid_argument("unknown arrival pattern");
+            } else {
+                throw std::invalid_argument("unknown synthetic field");
+            }
+            begin = end < spec.size() ? end : string::npos;
+        }
+        res.validate();
+        return res;
+    }
+
+    void SyntheticConfig::validate() const {
+        if (flows == 0 || flows > (u64(1) << 32)) {
+            throw std::invalid_argument("flows must be in [1, 2^32]");
+        }
+        if (!(skew >= 0)) {
+            throw std::invalid_argument("skew must be non-negative");
+        }
+        if (!(sigma > 0 && sigma2 > 0 && xm > 0 && shape > 0)) {
+            throw std::invalid_argument("value parameters must be positive");
+        }
+        if (!(weight >= 0 && weight <= 1)) {
+            throw std::invalid_argument("weight must be in [0, 1]");
+        }
+        if (!(flow_sigma >= 0 && drift > -1)) {
+            throw std::invalid_argument("flow sigma or drift out of range");
+        }
+        if (!(burst >= 1 && churn >= 0)) {
+            throw std::invalid_argument("arrival parameters out of range");
+        }
+    }
+
+    SyntheticTrace::SyntheticTrace(const SyntheticConfig& config)
+        : cfg(config), state(mix(config.seed)) {
+        cfg.validate();
+        idKey = static_cast<u32>(mix(state ^ 1));
+        flowKey = mix(state ^ 2) << 32;
+
+        hX1 = hIntegral(1.5) - 1;
+        hN = hIntegral(cfg.flows + 0.5);
+        zipfS = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+        geoDiv = cfg.burst > 1 ? std::log(1 - 1 / cfg.burst) : 0;
+    }
+
+    u32 SyntheticTrace::read(FlowItem* items, u32 n) {
+        u32 num = std::min<u64>(n, cfg.items - pos);
+        for (u32 i = 0; i < num; ++i) {
+            u32 id = flowId(nextRank());
+            items[i] = {id, value(id)};
+            ++pos;
+        }
+        return num;
+    }
+
+    u64 SyntheticTrace::mix(u64 z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    f64 SyntheticTrace::toUnit(u64 bits) {
+        return ((bits >> 11) + 1) * 0x1.0p-53;
+    }
+
+    u64 SyntheticTrace::next() {
+        return mix(state += GOLDEN);
+    }
+
+    f64 SyntheticTrace::uniform() {
+        return toUnit(next());
+    }
+
+    f64 SyntheticTrace::normal() {
+        // Box-Muller yields two variates, the second is kept for next call
+        if (hasSpare) {
+            hasSpare = false;
+            return spare;
+        }
+        f64 r = std::sqrt(-2 * std::log(uniform()));
+        f64 theta = 2 * M_PI * uniform();
+        spare = r * std::sin(theta);
+        hasSpare = true;
+        return r * std::cos(theta);
+    }
+
+    f64 SyntheticTrace::hashNormal(u64 key) {
+        // Irwin-Hall sum of four 16-bit uniforms of one hash, scaled to
+        // unit variance, is close enough for flow scales and needs no
+        // transcendental call
+        u64 bits = mix(key * GOLDEN);
+        f64 sum = 0;
+        for (u32 i = 0; i < 4; ++i, bits >>= 16) {
+            sum += static_cast<f64>(bits & 0xffff);
+        }
+        return (sum / 65536 - 2) * std::sqrt(3.0);
+    }
+
+    // h(x) = x^-s and its integral H, written with expm1 and log1p so
+    // that they stay accurate for s near 1.
+
+    f64 SyntheticTrace::h(f64 x) const {
+        return std::exp(-cfg.skew * std::log(x));
+    }
+
+    f64 SyntheticTrace::hIntegral(f64 x) const {
+        f64 log_x = std::log(x);
+        f64 t = (1 - cfg.skew) * log_x;
+        f64 helper = std::fabs(t) > 1e-8 ? std::expm1(t) / t : 1 + t / 2;
+        return helper * log_x;
+    }
+
+    f64 SyntheticTrace::hIntegralInverse(f64 x) const {
+        f64 t = std::max(x * (1 - cfg.skew), -1.0);
+        f64 helper = std::fabs(t) > 1e-8 ? std::log1p(t) / t : 1 - t / 2;
+        return std::exp(helper * x);
+    }
+
+    u64 SyntheticTrace::zipf() {
+        while (true) {
+            f64 u = hN + uniform() * (hX1 - hN);
+            f64 x = hIntegralInverse(u);
+            u64 k = std::clamp<f64>(x + 0.5, 1, cfg.flows);
+            if (k - x <= zipfS || u >= hIntegral(k + 0.5) - h(k)) {
+                return k - 1;
+            }
+        }
+    }
+
+    u64 SyntheticTrace::nextRank() {
+        switch (cfg.arrival) {
+        case SyntheticConfig::BURST:
+            if (runLeft == 0) {
+                runRank = zipf();
+                runLeft = geoDiv == 0 ? 1
+                          : 1 + static_cast<u64>(std::log(uniform()) / geoDiv);
+            }
+            --runLeft;
+            return runRank;
+        case SyntheticConfig::CHURN: {
+            u64 shift = cfg.churn * cfg.flows * (static_cast<f64>(pos)
+                                                 / cfg.items);
+            return (zipf() + shift) % cfg.flows;
+        }
+        default:
+            return zipf();
+        }
+    }
+
+    u32 SyntheticTrace::flowId(u64 rank) const {
+        // fmix32 of MurmurHash3 is a bijection, so distinct ranks keep
+        // distinct IDs
+        u32 x = static_cast<u32>(rank) ^ idKey;
+        x ^= x >> 16;
+        x *= 0x85ebca6b;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35;
+        x ^= x >> 16;
+        return x;
+    }
+
+    u32 SyntheticTrace::value(u32 id) {
+        // every distribution is drawn in log space, so that the flow scale
+        // costs no extra exp
+        f64 log_x = cfg.flow_sigma != 0
+                    ? cfg.flow_sigma * hashNormal(id ^ flowKey) : 0;
+        switch (cfg.value) {
+        case SyntheticConfig::PARETO:
+            log_x += std::log(cfg.xm) - std::log(uniform()) / cfg.shape;
+            break;
+        case SyntheticConfig::BIMODAL:
+            log_x += uniform() <= cfg.weight ? cfg.mu + cfg.sigma * normal()
+                                             : cfg.mu2 + cfg.sigma2 * normal();
+            break;
+        default:
+            log_x += cfg.mu + cfg.sigma * normal();
+            break;
+        }
+
+        f64 x = std::exp(log_x);
+        if (cfg.drift != 0) {
+            x *= 1 + cfg.drift * (static_cast<f64>(pos) / cfg.items);
+        }
+        return static_cast<u32>(std::clamp(x, 1.0, 4294967295.0));
+    }
+}   // namespace sketch
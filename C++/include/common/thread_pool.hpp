@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Fixed set of worker threads running parallel loops with work
+    ///        stealing.
+    /// @details A loop is cut into chunks, and every worker starts with an
+    ///          equal contiguous run of them. A worker takes chunks from the
+    ///          front of its own run; once it runs dry it steals the back
+    ///          half of another worker's run, so uneven chunks even out
+    ///          without a shared queue. The calling thread works as one of
+    ///          the workers.
+    class ThreadPool {
+    public:
+        /// @brief Constructor.
+        /// @param worker_num Number of workers including the calling thread,
+        ///                   by default one per hardware thread.
+        /// @param pin Whether to pin each worker to its own CPU, cycling
+        ///            through the CPUs the process may run on. The calling
+        ///            thread is pinned only while it runs a loop.
+        explicit ThreadPool(
+            u32 worker_num = std::thread::hardware_concurrency(),
+            bool pin = false);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /// @brief Return number of workers including the calling thread.
+        u32 size() const { return workerNum; }
+
+        /// @brief Call @p f(begin, end) on chunks of [0, @p n) in parallel
+        ///        and wait for all of them.
+        /// @details If a call throws, remaining chunks are skipped and the
+        ///          first exception is rethrown here.
+        /// @param n Number of items.
+        /// @param grain Number of items per chunk.
+        /// @param f Function run on each chunk.
+        /// @warning Only one thread may run loops on a pool at a time.
+        template <typename F>
+        void parallelFor(u64 n, u64 grain, F&& f);
+
+        /// @brief Call @p f on the calling thread, pinned to the CPU of
+        ///        worker 0 as during a loop if workers are pinned.
+        /// @details The other workers sleep meanwhile, so that the CPU is
+        ///          reserved to @p f, e.g. for timing.
+        template <typename F>
+        void runPinned(F&& f);
+
+        /// @brief Return number of successful steals since construction.
+        u64 steals() const { return stealNum.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr u32 CACHE_LINE = 64;   ///< Bytes per cache line.
+
+        /// Chunks not taken yet by a worker, packed as front in the low
+        /// half and back in the high half, so that the owner and thieves
+        /// agree on them with a single compare-and-swap.
+        struct alignas(CACHE_LINE) Run {
+            std::atomic<u64> range{0};
+        };
+
+        u32 workerNum;                  ///< Workers including the caller.
+        vector<u32> cpus;               ///< CPU of each worker, if pinned.
+        std::unique_ptr<Run[]> runs;    ///< Chunk run of each worker.
+        vector<std::thread> threads;    ///< Threads of workers 1+.
+
+        std::mutex lock;                    ///< Guards the fields below.
+        std::condition_variable wake;       ///< Signals a new loop.
+        std::condition_variable done;       ///< Signals a finished worker.
+        u64 generation = 0;                 ///< Number of loops started.
+        u32 active = 0;                     ///< Workers still in the loop.
+        bool stopping = false;              ///< Set by the destructor.
+        std::exception_ptr error;           ///< First exception of the loop.
+
+        std::function<void(u64, u64)> job;  ///< Body of the current loop.
+        u64 jobItems = 0;                   ///< Items of the current loop.
+        u64 jobGrain = 0;                   ///< Items per chunk.
+        std::atomic<bool> failed{false};    ///< Whether a chunk threw.
+        std::atomic<u64> stealNum{0};       ///< Successful steals.
+
+        /// @brief Body of the threads of workers 1+.
+        void loop(u32 self);
+
+        /// @brief Run @c work on the calling thread as worker 0, pinned
+        ///        to its CPU for the duration if workers are pinned.
+        void workPinned();
+
+        /// @brief Run chunks until none is left anywhere.
+        void work(u32 self);
+
+        /// @brief Take the front chunk of a worker's own run.
+        /// @return Whether a chunk was taken.
+        bool take(u32 self, u32& chunk);
+
+        /// @brief Move the back half of another worker's run into ours.
+        /// @return Whether anything was stolen.
+        bool steal(u32 self);
+
+        static u64 pack(u32 front, u32 back) {
+            return static_cast<u64>(back) << 32 | front;
+        }
+    };
+}   // namespace sketch
+
+#include "thread_pool_impl.hpp"
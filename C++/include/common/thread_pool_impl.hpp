@@ -0,0 +1,217 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+namespace sketch {
+    ThreadPool::ThreadPool(u32 worker_num, bool pin)
+        : workerNum(std::max(worker_num, 1u)), runs(new Run[workerNum]) {
+        if (pin) {
+            cpu_set_t allowed;
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+                throw std::runtime_error("cannot get CPU affinity");
+            }
+            vector<u32> usable;
+            for (u32 cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    usable.push_back(cpu);
+                }
+            }
+            for (u32 i = 0; i < workerNum; ++i) {
+                cpus.push_back(usable[i % usable.size()]);
+            }
+        }
+
+        threads.reserve(workerNum - 1);
+        for (u32 i = 1; i < workerNum; ++i) {
+            threads.emplace_back(&ThreadPool::loop, this, i);
+            if (pin) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[i], &set);
+                pthread_setaffinity_np(threads.back().native_handle(),
+                                       sizeof(set), &set);
+            }
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    template <typename F>
+    void ThreadPool::parallelFor(u64 n, u64 grain, F&& f) {
+        if (grain == 0) {
+            throw std::invalid_argument("chunks must not be empty");
+        }
+        if (n == 0) {
+            return;
+        }
+        // Chunk indices must fit in half of a packed run.
+        grain = std::max(grain, (n - 1) / UINT32_MAX + 1);
+        u64 chunks = (n - 1) / grain + 1;
+
+        // Pinned loops always go through the workers to run on their CPUs.
+        if ((workerNum == 1 || chunks == 1) && cpus.empty()) {
+            for (u64 begin = 0; begin < n; begin += grain) {
+                f(begin, std::min(n, begin + grain));
+            }
+            return;
+        }
+
+        for (u32 i = 0; i < workerNum; ++i) {
+            u32 front = chunks * i / workerNum;
+            u32 back = chunks * (i + 1) / workerNum;
+            runs[i].range.store(pack(front, back), std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = [&f](u64 begin, u64 end) { f(begin, end); };
+            jobItems = n;
+            jobGrain = grain;
+            failed.store(false, std::memory_order_relaxed);
+            active = workerNum - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        workPinned();
+
+        std::exception_ptr res;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [this] { return active == 0; });
+            job = nullptr;
+            std::swap(res, error);
+        }
+        if (res) {
+            std::rethrow_exception(res);
+        }
+    }
+
+    void ThreadPool::loop(u32 self) {
+        u64 seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] {
+                    return stopping || generation != seen;
+                });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            work(self);
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (--active == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::workPinned() {
+        runPinned([this] { work(0); });
+    }
+
+    template <typename F>
+    void ThreadPool::runPinned(F&& f) {
+        if (cpus.empty()) {
+            f();
+            return;
+        }
+
+        pthread_t self = pthread_self();
+        cpu_set_t saved, set;
+        bool restore = pthread_getaffinity_np(self, sizeof(saved), &saved) == 0;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[0], &set);
+        pthread_setaffinity_np(self, sizeof(set), &set);
+        struct Restore {
+            pthread_t self;
+            const cpu_set_t* saved;
+            ~Restore() {
+                if (saved) {
+                    pthread_setaffinity_np(self, sizeof(*saved), saved);
+                }
+            }
+        } guard{self, restore ? &saved : nullptr};
+        f();
+    }
+
+    void ThreadPool::work(u32 self) {
+        u32 chunk;
+        while (!failed.load(std::memory_order_relaxed)) {
+            if (!take(self, chunk)) {
+                if (steal(self)) {
+                    continue;
+                }
+                // Chunks a thief is moving into its own run are left to it.
+                return;
+            }
+
+            u64 begin = chunk * jobGrain;
+            try {
+                job(begin, std::min(jobItems, begin + jobGrain));
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool ThreadPool::take(u32 self, u32& chunk) {
+        auto& range = runs[self].range;
+        u64 cur = range.load(std::memory_order_acquire);
+        while (true) {
+            u32 front = cur, back = cur >> 32;
+            if (front >= back) {
+                return false;
+            }
+            if (range.compare_exchange_weak(cur, pack(front + 1, back),
+                                            std::memory_order_acq_rel)) {
+                chunk = front;
+                return true;
+            }
+        }
+    }
+
+    bool ThreadPool::steal(u32 self) {
+        // Our own run is empty, so no thief touches it while we refill it.
+        for (u32 i = 1; i < workerNum; ++i) {
+            auto& range = runs[(self + i) % workerNum].range;
+            u64 cur = range.load(std::memory_order_acquire);
+            while (true) {
+                u32 front = cur, back = cur >> 32;
+                if (front >= back) {
+                    break;
+                }
+                u32 mid = back - (back - front + 1) / 2;
+                if (range.compare_exchange_weak(cur, pack(front, mid),
+                                                std::memory_order_acq_rel)) {
+                    runs[self].range.store(pack(mid, back),
+                                           std::memory_order_release);
+                    stealNum.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}   // namespace sketch
@@ -1,5 +1,6 @@
 #pragma once
 #include "sketch_utils.hpp"
+#include "binary_io.hpp"
 
 namespace sketch {
     class TinyCnter {
@@ -30,6 +31,12 @@ namespace sketch {
         /// @brief Return number of bytes the counter uses.
         u32 memory() const;
 
+        /// @brief Write the counters and the maximum item.
+        void saveState(BinaryWriter& out) const;
+
+        /// @brief Read a counter written by @c saveState.
+        void loadState(BinaryReader& in);
+
     private:
         u8 cnt0: 2;     ///< Counter 0.
         u8 cnt1: 2;     ///< Counter 1.
@@ -53,4 +53,18 @@ namespace sketch {
             throw std::invalid_argument("tiny counter index out of range");
         }
     }
-}   // namespace sketch
\ No newline at end of file
+
+    void TinyCnter::saveState(BinaryWriter& out) const {
+        out.put<u8>(cnt0 | cnt1 << 2 | cnt2 << 4 | cnt3 << 6);
+        out.putCounter(maxItem, sizeof(u32));
+    }
+
+    void TinyCnter::loadState(BinaryReader& in) {
+        u8 cnt = in.get<u8>();
+        cnt0 = cnt;
+        cnt1 = cnt >> 2;
+        cnt2 = cnt >> 4;
+        cnt3 = cnt >> 6;
+        maxItem = in.getCounter(sizeof(u32));
+    }
+}   // namespace sketch
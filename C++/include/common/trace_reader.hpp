@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdio>
+#include <memory>
+#include "sketch_defs.hpp"
+#include "file_path.hpp"
+#include "synthetic_trace.hpp"
+
+namespace sketch {
+    /// @brief Return the trace file of a given dataset.
+    const char* dataset_path(const string& dataset);
+
+    /// @brief Chunked decoder of the fixed-size binary traces (caida, imc
+    ///        and MAWI), so that a trace can be consumed while it is read.
+    ///        Synthetic specs, see @c SyntheticConfig, are generated on the
+    ///        fly instead.
+    class TraceReader {
+    public:
+        /// @brief Open the trace of a given dataset.
+        /// @param dataset Dataset name, see @c streamable.
+        /// @param chunk Records fetched from the file per read.
+        TraceReader(const string& dataset, u32 chunk = 1 << 16);
+
+        ~TraceReader();
+
+        TraceReader(const TraceReader&) = delete;
+        TraceReader& operator=(const TraceReader&) = delete;
+
+        /// @brief Return whether a dataset is stored as a binary trace.
+        static bool streamable(const string& dataset);
+
+        /// @brief Decode the next items of the trace.
+        /// @param items Output buffer.
+        /// @param n Capacity of @p items.
+        /// @return Number of decoded items, 0 at the end of the trace.
+        u32 read(FlowItem* items, u32 n);
+
+    private:
+        enum Format {
+            CAIDA_TRACE,
+            IMC_TRACE,
+            MAWI_TRACE,
+            SYNTHETIC,
+        };
+
+        static constexpr u32 RECORD_SIZE[3] = {21, 26, 21};
+
+        FILE* pf = nullptr;     ///< Trace file.
+        std::unique_ptr<SyntheticTrace> synth;  ///< Generator of a spec.
+        Format format;          ///< Record layout.
+        u32 recordSize;         ///< Bytes per record.
+        vector<char> buf;       ///< Undecoded records.
+        u32 bufPos = 0;         ///< Next record in @c buf.
+        u32 bufNum = 0;         ///< Records in @c buf.
+        f64 ftime = -1;         ///< First timestamp of caida.
+        long long fime = -1;    ///< First timestamp of imc and MAWI.
+
+        /// @brief Decode a single record.
+        FlowItem decode(const char* rec);
+    };
+}   // namespace sketch
+
+#include "trace_reader_impl.hpp"
@@ -0,0 +1,113 @@
+#pragma once
+#include "trace_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace sketch {
+    const char* dataset_path(const string& dataset) {
+        if (dataset == "caida") {
+            return caida_path;
+        } else if (dataset == "imc") {
+            return imc_path;
+        } else if (dataset == "seattle") {
+            return seattle_path;
+        } else if (dataset == "web") {
+            return web_path;
+        } else if (dataset == "criteo") {
+            return criteo_path;
+        } else if (dataset == "MAWI") {
+            return mawi_path;
+        } else if (dataset == "pcap") {
+            if (!pcap_path) {
+                throw std::invalid_argument("no capture given for pcap");
+            }
+            return pcap_path;
+        }
+        throw std::invalid_argument("unknown dataset");
+    }
+
+    TraceReader::TraceReader(const string& dataset, u32 chunk) {
+        if (SyntheticConfig::isSpec(dataset)) {
+            format = SYNTHETIC;
+            synth.reset(new SyntheticTrace(SyntheticConfig::parse(dataset)));
+            return;
+        }
+        if (dataset == "caida") {
+            format = CAIDA_TRACE;
+        } else if (dataset == "imc") {
+            format = IMC_TRACE;
+        } else if (dataset == "MAWI") {
+            format = MAWI_TRACE;
+        } else {
+            throw std::invalid_argument("dataset is not a binary trace");
+        }
+        if (chunk == 0) {
+            throw std::invalid_argument("chunk must be positive");
+        }
+
+        pf = fopen(dataset_path(dataset), "rb");
+        if (!pf) {
+            throw std::runtime_error("cannot open file");
+        }
+        recordSize = RECORD_SIZE[format];
+        buf = vector<char>(static_cast<u64>(chunk) * recordSize);
+    }
+
+    TraceReader::~TraceReader() {
+        if (pf) {
+            fclose(pf);
+        }
+    }
+
+    bool TraceReader::streamable(const string& dataset) {
+        return dataset == "caida" || dataset == "imc" || dataset == "MAWI"
+               || SyntheticConfig::isSpec(dataset);
+    }
+
+    u32 TraceReader::read(FlowItem* items, u32 n) {
+        if (synth) {
+            return synth->read(items, n);
+        }
+
+        u32 res = 0;
+        while (res < n) {
+            if (bufPos == bufNum) {
+                bufPos = 0;
+                bufNum = fread(buf.data(), recordSize,
+                               buf.size() / recordSize, pf);
+                if (bufNum == 0) {
+                    break;
+                }
+            }
+            u32 num = std::min(n - res, bufNum - bufPos);
+            const char* rec = buf.data() + static_cast<u64>(bufPos) * recordSize;
+            for (u32 i = 0; i < num; ++i, rec += recordSize) {
+                items[res + i] = decode(rec);
+            }
+            res += num;
+            bufPos += num;
+        }
+        return res;
+    }
+
+    FlowItem TraceReader::decode(const char* rec) {
+        u32 key;
+        memcpy(&key, rec, sizeof(key));
+
+        if (format == CAIDA_TRACE) {
+            f64 ttime;
+            memcpy(&ttime, rec + 13, sizeof(ttime));
+            if (ftime < 0) ftime = ttime;
+            return {key, u32((ttime - ftime) * 10000000) + 1};
+        }
+
+        long long ttime;
+        memcpy(&ttime, rec + (format == IMC_TRACE ? 18 : 13), sizeof(ttime));
+        if (fime < 0) fime = ttime;
+        if (format == IMC_TRACE) {
+            return {key, u32((ttime - fime) / 100) + 1};
+        }
+        return {key, u32((ttime - fime) * 100000) + 1};
+    }
+}   // namespace sketch
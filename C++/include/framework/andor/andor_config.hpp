@@ -0,0 +1,42 @@
+#pragma once
+#include <climits>
+#include <ostream>
+#include "../../common/sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief Layout of an @c AndorSketch: the memory share and META
+    ///        parameters of each level.
+    /// @details Defaults are the values tuned for the CAIDA traces. A
+    ///          configuration is saved as text, one line per field with
+    ///          the field name followed by its value for each level, and
+    ///          fields missing from a file keep their defaults.
+    struct AndorConfig {
+        static constexpr u32 LEVELS = 4;    ///< Number of levels.
+
+        /// Share of the memory limit given to each level.
+        f64 mem_div[LEVELS] = {0.03, 0.60, 0.35, 0.02};
+        /// Capacity of a bucket of each level. lv0 holds 2-bit counters,
+        /// so its capacity is fixed.
+        u32 cap[LEVELS] = {3, UINT8_MAX, UINT16_MAX, UINT32_MAX};
+        f64 alpha[LEVELS] = {0, 0.5, 0.5, 0.3};     ///< DD accuracy.
+        u32 cmtor_cap[LEVELS] = {0, 2, 2, 4};       ///< mReq compactors.
+        u32 td_cap[LEVELS] = {0, 4, 8, 16};         ///< TDigest centroids.
+
+        /// @brief Check that the configuration describes a usable sketch.
+        /// @throw std::invalid_argument if it does not.
+        void validate() const;
+
+        /// @brief Write the configuration as text.
+        void write(std::ostream& out) const;
+
+        /// @brief Save the configuration to a file.
+        void save(const string& path) const;
+
+        /// @brief Load a configuration saved by @c save.
+        /// @throw std::runtime_error if the file cannot be read or holds
+        ///        an unknown field or a malformed value.
+        static AndorConfig load(const string& path);
+    };
+}   // namespace sketch
+
+#include "andor_config_impl.hpp"
@@ -0,0 +1,95 @@
+#pragma once
+#include "andor_config.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace sketch {
+    void AndorConfig::validate() const {
+        f64 total = 0;
+        for (u32 i = 0; i < LEVELS; ++i) {
+            if (!(mem_div[i] > 0)) {
+                throw std::invalid_argument("every level needs memory");
+            }
+            total += mem_div[i];
+        }
+        if (total > 1 + 1e-9) {
+            throw std::invalid_argument("memory shares exceed the limit");
+        }
+
+        if (cap[0] != 3) {
+            throw std::invalid_argument("lv0 capacity is fixed to 3");
+        }
+        for (u32 i = 1; i < LEVELS; ++i) {
+            if (cap[i] <= cap[i - 1]) {
+                throw std::invalid_argument("level capacities must increase");
+            }
+            if (!(alpha[i] > 0 && alpha[i] < 1)) {
+                throw std::invalid_argument("alpha out of range");
+            }
+            if (cmtor_cap[i] == 0 || td_cap[i] == 0) {
+                throw std::invalid_argument("META capacity must be positive");
+            }
+        }
+    }
+
+    void AndorConfig::write(std::ostream& out) const {
+        auto line = [&](const char* name, const auto& vals) {
+            out << name;
+            for (u32 i = 0; i < LEVELS; ++i) {
+                out << ' ' << vals[i];
+            }
+            out << '\n';
+        };
+
+        auto precision = out.precision(10);
+        line("mem_div", mem_div);
+        line("cap", cap);
+        line("alpha", alpha);
+        line("cmtor_cap", cmtor_cap);
+        line("td_cap", td_cap);
+        out.precision(precision);
+    }
+
+    void AndorConfig::save(const string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("cannot open file");
+        }
+        out << "# AndorSketch configuration, values per level 0-3\n";
+        write(out);
+    }
+
+    AndorConfig AndorConfig::load(const string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open file");
+        }
+
+        AndorConfig res;
+        auto parse = [](std::istringstream& line, auto& vals) {
+            for (u32 i = 0; i < LEVELS; ++i) {
+                if (!(line >> vals[i])) {
+                    throw std::runtime_error("malformed configuration");
+                }
+            }
+        };
+
+        string text;
+        while (std::getline(in, text)) {
+            std::istringstream line(text);
+            string name;
+            if (!(line >> name) || name[0] == '#') {
+                continue;
+            }
+            if (name == "mem_div") parse(line, res.mem_div);
+            else if (name == "cap") parse(line, res.cap);
+            else if (name == "alpha") parse(line, res.alpha);
+            else if (name == "cmtor_cap") parse(line, res.cmtor_cap);
+            else if (name == "td_cap") parse(line, res.td_cap);
+            else throw std::runtime_error("unknown configuration field");
+        }
+        res.validate();
+        return res;
+    }
+}   // namespace sketch
@@ -1,69 +1,208 @@
 #pragma once
-#include "../../common/BOBHash32.h"
+#include "../../common/flow_key.hpp"
 #include "../../common/tiny_counter.hpp"
 #include "../../common/histogram.hpp"
+#include "../../common/cow_vector.hpp"
+#include "../../common/snapshot_cell.hpp"
 #include "../framework.hpp"
+#include "andor_config.hpp"
+#ifdef ANDOR_STATS
+#include "andor_stats.hpp"
+#endif
 
 namespace sketch {
     template <typename META>
     class SketchSingleTest;
-
-    template <typename META>
-    class AndorSketch : public Framework {
-        using vec_tiny = std::vector<TinyCnter>;
-        using vec_meta = std::vector<META>;
+    template <typename Key>
+    class AndorView;
+
+    /// @tparam Key Flow key. Levels from @c KEY_LEVEL on keep whole keys,
+    ///             since taking over a bucket hashes its holder again.
+    template <typename META, typename Key = u32>
+    class AndorSketch final : public BasicFramework<Key> {
+        friend class AndorView<Key>;
+        using KeyArg = typename BasicFramework<Key>::KeyArg;
+        using vec_tiny = CowVector<TinyCnter, HugePageAllocator<TinyCnter>>;
+        using vec_meta = CowVector<META, HugePageAllocator<META>>;
+        using vec_key = CowVector<Key, HugePageAllocator<Key>>;
 
     public:
+        /// @brief Immutable view of the sketch, safe to query from any
+        ///        thread while the owner keeps appending.
+        using Snapshot = std::shared_ptr<const AndorSketch<META, Key>>;
+
         /// @brief Constructor.
         /// @param mem_limit Memory limit in bytes.
         /// @param hash_num Number of hash functions per level, by default 2.
         /// @param seed Seed for generating hash functions, by default 0.
-        AndorSketch(u64 mem_limit, u32 hash_num = 2, u32 seed = 0, double ddc_alpha = 0.1);
-
-        void append(u32 id, u32 value) override;
-        u32 size(u32 id) const override;
-        u32 memory() const override;
-        u32 quantile(u32 id, f64 nom_rank) const override;
-        FlowType type(u32 id) const override;
+        /// @param config Memory share and META parameters of each level.
+        /// @throw std::invalid_argument if the configuration is invalid or
+        ///        leaves a level without buckets.
+        AndorSketch(u64 mem_limit, u32 hash_num = 2, u32 seed = 0, double ddc_alpha = 0.1,
+                    const AndorConfig& config = AndorConfig());
+
+        /// @brief Return whether a memory limit leaves every level of a
+        ///        configuration at least one bucket, i.e. whether the
+        ///        constructor accepts them.
+        /// @throw std::invalid_argument if the configuration is invalid.
+        static bool fits(u64 mem_limit, const AndorConfig& config,
+                         double ddc_alpha = 0.1);
+
+        void append(KeyArg id, u32 value) override;
+        /// @brief Estimate the items of a flow, the least count among its
+        ///        buckets summed over the levels it reached.
+        u32 size(KeyArg id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        /// @brief Return the largest pages any level is backed by.
+        HugePages::Backing backing() const override;
+        u32 quantile(KeyArg id, f64 nom_rank) const override;
+        void quantiles(KeyArg id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(KeyArg id) const override;
+        void clear() override;
+        void save(const string& path, bool compact = false) const override;
+        void load(const string& path) override;
+        FlowType type(KeyArg id) const override;
+
+        /// @brief Return the flows that claimed a bucket in lv2 or lv3,
+        ///        i.e. the elephant flows.
+        /// @details A flow claims one of its buckets per level, taking
+        ///          it over from a flow that holds another one if all
+        ///          are claimed, so an elephant is missed only if every
+        ///          bucket of it belongs to a flow with no other.
+        vector<Key> flows() const override;
+
+        // Snapshots. Levels are stored as copy-on-write slabs, so taking a
+        // snapshot copies slab tables only, and later appends clone just
+        // the slabs they dirty.
+
+        /// @brief Publish a snapshot of the current state as a new epoch.
+        /// @warning Call from the appending thread only.
+        void publish();
+
+        /// @brief Return the latest published snapshot, @c nullptr if none.
+        Snapshot snapshot() const;
+
+        /// @brief Ask the appending thread to publish at its next append.
+        /// @return The epoch to pass to @c waitSnapshot.
+        u64 requestSnapshot() const;
+
+        /// @brief Wait for a requested epoch and return its snapshot.
+        Snapshot waitSnapshot(u64 epoch) const;
+
+        /// @brief Return the number of published snapshots.
+        u64 epoch() const;
+
+#ifdef ANDOR_STATS
+        // Statistics, compiled in with ANDOR_STATS only. Counters are
+        // relaxed atomics, so queries may share a snapshot meanwhile.
+
+        /// @brief Return the counters together with bucket occupancy,
+        ///        which is scanned on every call.
+        AndorStats stats() const;
+
+        /// @brief Reset the counters.
+        void resetStats();
+
+        /// @brief Dump @c stats to a stream every given number of appends.
+        /// @param appends Appends between dumps, 0 to stop dumping.
+        /// @param out Stream to dump to, which must outlive the sketch.
+        void dumpStatsEvery(u64 appends, std::ostream& out);
+#endif
 
     private:
         // MetaModel metaType; ///< Meta sketch type.
-        static constexpr u32 LEVELS = 4;      ///< Number of levels.
+        static constexpr u32 LEVELS = AndorConfig::LEVELS;  ///< Number of levels.
+        static constexpr u32 MAX_HASH_NUM = 8;  ///< Maximum hash functions per level.
 
-        static constexpr u32 cap[4] = {3, UINT8_MAX, UINT16_MAX, UINT32_MAX};
-        static constexpr f64 alpha[4] = {0, 0.5, 0.5, 0.3};
-        static constexpr u32 cmtor_cap[4] = {0, 2, 2, 4};
-        static constexpr u32 td_cap[4] = {0, 4, 8, 16};
-        static constexpr f64 mem_div[4] = {0.03, 0.60, 0.35, 0.02};
         static constexpr u32 ddc_size[4] = {0, 20, 20, 35};
+        static constexpr u32 KEY_LEVEL = 2;     ///< Lowest level with keys.
         
         vec_tiny lv0;   ///< Level 0.
         vec_meta lv1;   ///< Level 1.
         vec_meta lv2;   ///< Level 2.
         vec_meta lv3;   ///< Level 3.
-        std::vector<BOBHash32> hash[LEVELS];    ///< Hash functions.
-        mutable vec_u32 hashVal[LEVELS];        ///< Hash values.
+        META blank[LEVELS];     ///< Empty bucket of each META level.
+        /// Flow that claimed each bucket of a level from @c KEY_LEVEL on,
+        /// @c KeyTraits::empty if none.
+        vec_key keys[LEVELS];
+        /// Backing of the buckets and keys of each level, shared with
+        /// the slabs carved from it.
+        std::shared_ptr<HugeRegion> region[LEVELS];
+        std::vector<KeyHash<Key>> hash[LEVELS]; ///< Hash functions.
+        u32 hashNum;                            ///< Hash functions per level.
+        u32 hashSeed;                           ///< Seed of @c hash.
+        SnapshotCell<AndorSketch<META, Key>> snapshots; ///< Published snapshots.
+
+        /// Hash values of the last hashed flow. Kept per thread so that
+        /// readers may share one snapshot, and plain arrays so that
+        /// accessing them needs no thread-local initialization guard.
+        inline static thread_local u32 hashVal[LEVELS][MAX_HASH_NUM];
+
+#ifdef ANDOR_STATS
+        /// @brief Counters of a level, see @c AndorStats.
+        struct LevelCounters {
+            StatCounter appends, queries, appendTicks, queryTicks;
+            StatCounter promotions, ands, andCollisions;
+        };
+
+        mutable LevelCounters counters[LEVELS];     ///< Counters per level.
+        u64 dumpEvery = 0;              ///< Appends between dumps.
+        u64 sinceDump = 0;              ///< Appends since the last dump.
+        std::ostream* dumpOut = nullptr;    ///< Stream to dump to.
+
+        /// @brief Count a query answered from a given level.
+        /// @param start Timestamp taken when the query began.
+        void countQuery(u32 level, u64 start) const;
+#endif
+
+        /// @brief Generate hash functions from a given seed.
+        void initHash(u32 seed);
+
+        /// @brief Generate the hash functions of every level from a given
+        ///        seed, as @c initHash does.
+        static void makeHash(u32 seed, u32 hash_num,
+                             std::vector<KeyHash<Key>>* hash);
+
+        /// @brief Calculate the empty bucket and bucket number of each
+        ///        level.
+        /// @param blanks Empty META of each level but lv0.
+        /// @param bucket_num Bucket number of each level, 0 if the memory
+        ///                   share of the level holds no bucket.
+        static void layLevels(u64 mem_limit, const AndorConfig& config,
+                              double ddc_alpha, META* blanks, u32* bucket_num);
+
+        /// @brief Return a region for the buckets and keys of a level,
+        ///        see @c make_huge_region.
+        /// @param num Number of buckets of the level.
+        static std::shared_ptr<HugeRegion> makeRegion(u32 level, u64 num);
 
         /// @brief Calculate hash values for a given item.
-        void calcHash(u32 id) const;
+        void calcHash(KeyArg id) const;
 
         // Level granularity functions.
 
         /// @brief Append a given item into lv0 (tiny counter level).
-        void appendTiny(u32 id, u32 value);
+        void appendTiny(KeyArg id, u32 value);
         /// @brief Append a given item into lv1, 2, or 3 (dd level).
-        void appendMETA(u32 level, u32 id, u32 value);
+        void appendMETA(u32 level, KeyArg id, u32 value);
+        /// @brief Record a flow appended to lv2 or 3 in one of its
+        ///        buckets' keys.
+        void claimKey(u32 level, KeyArg id);
 
         /// @brief Estimate absolute rank in a given dd level.
-        u32 rank(u32 level, u32 id, u32 value, bool inclusive) const;
+        u32 rank(u32 level, KeyArg id, u32 value, bool inclusive) const;
 
         /// @brief Calculate the appending level of a given flow.
-        u32 calcAppendLevel(u32 id) const;
+        u32 calcAppendLevel(KeyArg id) const;
         /// @brief Calculate the query level of a given flow.
-        u32 calcQueryLevel(u32 id) const;
+        u32 calcQueryLevel(KeyArg id) const;
 
-        Histogram doAND(u32 level, u32 id) const;
-        Histogram doOR(u32 id) const;
+        Histogram doAND(u32 level, KeyArg id) const;
+        /// @brief Combine the levels a flow spans, starting from a given
+        ///        query level of it.
+        Histogram doOR(u32 level, KeyArg id) const;
 
         // Little helper functions.
 
@@ -74,13 +213,13 @@ namespace sketch {
 
         /// @brief Check if buckets of a given flow are all full
         ///        in a given level.
-        bool isAllFull(u32 level, u32 id) const;
+        bool isAllFull(u32 level, KeyArg id) const;
 
-        bool hasAnyFull(u32 level, u32 id) const;
+        bool hasAnyFull(u32 level, KeyArg id) const;
 
         /// @brief Check if any bucket of a given flow is empty
         ///        in a given level.
-        bool hasAnyEmpty(u32 level, u32 id) const;
+        bool hasAnyEmpty(u32 level, KeyArg id) const;
     };
 }   // namespace sketch
 
@@ -7,91 +7,235 @@
 #include "../framework_utils.hpp"
 
 namespace sketch {
-    template <typename META>
-    AndorSketch<META>::AndorSketch(u64 mem_limit, u32 hash_num, u32 seed, double ddc_alpha) {
-        // calculate bucket number per level
-        TinyCnter tmp_lv0;
-        META tmp[4];
-        for (u32 i = 1; i < 4; ++i) {
-            tmp[i] = createMeta(cap[i], alpha[i], cmtor_cap[i], td_cap[i], ddc_alpha);
+    template <typename META, typename Key>
+    AndorSketch<META, Key>::AndorSketch(u64 mem_limit, u32 hash_num, u32 seed, double ddc_alpha,
+                                   const AndorConfig& config)
+        : hashNum(hash_num) {
+        if (hash_num == 0 || hash_num > MAX_HASH_NUM) {
+            throw std::invalid_argument("unsupported number of hash functions");
         }
+        config.validate();
 
         u32 bucket_num[LEVELS];
-        bucket_num[0] = mem_limit * mem_div[0] / tmp_lv0.memory();
-        for (u32 i = 1; i < 4; ++i) {
-            bucket_num[i] = mem_limit * mem_div[i] / tmp[i].memory();
+        layLevels(mem_limit, config, ddc_alpha, blank, bucket_num);
+        for (u32 i = 0; i < LEVELS; ++i) {
+            if (bucket_num[i] == 0) {
+                throw std::invalid_argument("memory too small for the levels");
+            }
         }
 
         // allocate memory
-        lv0.reserve(bucket_num[0]);
-        lv1.reserve(bucket_num[1]);
-        lv2.reserve(bucket_num[2]);
-        lv3.reserve(bucket_num[3]);
+        for (u32 i = 0; i < LEVELS; ++i) {
+            region[i] = makeRegion(i, bucket_num[i]);
+        }
+        lv0 = vec_tiny(bucket_num[0], TinyCnter(),
+                       HugePageAllocator<TinyCnter>(region[0]));
+        for (u32 i = 1; i < LEVELS; ++i) {
+            getVecMETA(i) = vec_meta(bucket_num[i], blank[i],
+                                     HugePageAllocator<META>(region[i]));
+        }
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            keys[i] = vec_key(bucket_num[i], KeyTraits<Key>::empty(),
+                              HugePageAllocator<Key>(region[i]));
+        }
+
+        initHash(seed);
+    }
+
+    template <typename META, typename Key>
+    bool AndorSketch<META, Key>::fits(u64 mem_limit, const AndorConfig& config,
+                                      double ddc_alpha) {
+        config.validate();
+        META blanks[LEVELS];
+        u32 bucket_num[LEVELS];
+        layLevels(mem_limit, config, ddc_alpha, blanks, bucket_num);
+        return std::find(bucket_num, bucket_num + LEVELS, 0)
+               == bucket_num + LEVELS;
+    }
 
-        while (bucket_num[0]--) { lv0.emplace_back(); }
-        while (bucket_num[1]--) { lv1.push_back(tmp[1]); }
-        while (bucket_num[2]--) { lv2.push_back(tmp[2]); }
-        while (bucket_num[3]--) { lv3.push_back(tmp[3]); }
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::layLevels(u64 mem_limit,
+                                           const AndorConfig& config,
+                                           double ddc_alpha, META* blanks,
+                                           u32* bucket_num) {
+        for (u32 i = 1; i < LEVELS; ++i) {
+            blanks[i] = createMeta<META>(config.cap[i], config.alpha[i],
+                                         config.cmtor_cap[i],
+                                         config.td_cap[i], ddc_alpha);
+        }
 
-        // initialize hash
+        bucket_num[0] = mem_limit * config.mem_div[0] / TinyCnter().memory();
+        for (u32 i = 1; i < LEVELS; ++i) {
+            u32 key_size = i >= KEY_LEVEL ? sizeof(Key) : 0;
+            bucket_num[i] = mem_limit * config.mem_div[i]
+                            / (blanks[i].memory() + key_size);
+        }
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::initHash(u32 seed) {
+        hashSeed = seed;
+        makeHash(seed, hashNum, hash);
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::makeHash(u32 seed, u32 hash_num,
+                                          std::vector<KeyHash<Key>>* hash) {
         rand_u32_generator gen(seed, MAX_PRIME32 - 1);
         for (u32 i = 0; i < LEVELS; ++i) {
+            hash[i].clear();
             hash[i].reserve(hash_num);
-            hashVal[i].reserve(hash_num);
             for (u32 j = 0; j < hash_num; ++j) {
-                hash[i].emplace_back(gen());
-                hashVal[i].emplace_back(0);
+                hash[i].emplace_back(gen(), j);
+            }
+        }
+    }
+
+    template <typename META, typename Key>
+    std::shared_ptr<HugeRegion> AndorSketch<META, Key>::makeRegion(u32 level,
+                                                              u64 num) {
+        u64 size = level == 0 ? sizeof(TinyCnter) : sizeof(META);
+        if (level >= KEY_LEVEL) {
+            size += sizeof(Key);
+        }
+        // a cache line of alignment slack per slab of buckets and keys
+        u64 slabs = (num + 1023) / 1024;
+        return make_huge_region(num * size + slabs * 2 * 64);
+    }
+
+    template <typename META, typename Key>
+    HugePages::Backing AndorSketch<META, Key>::backing() const {
+        HugePages::Backing res = HugePages::NORMAL;
+        for (const auto& r : region) {
+            if (r) {
+                res = std::max(res, r->backing());
             }
         }
+        return res;
     }
 
-    template <typename META>
-    u32 AndorSketch<META>::memory() const {
-        u32 mem = 0;
+    template <typename META, typename Key>
+    u64 AndorSketch<META, Key>::memory() const {
+        u64 mem = 0;
         mem += lv0.size() * lv0.front().memory();
         mem += lv1.size() * lv1.front().memory();
         mem += lv2.size() * lv2.front().memory();
         mem += lv3.size() * lv3.front().memory();
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            mem += keys[i].size() * sizeof(Key);
+        }
+        return mem;
+    }
+
+    template <typename META, typename Key>
+    u64 AndorSketch<META, Key>::heapBytes() const {
+        // Slabs shared with published snapshots are counted in full, the
+        // snapshots themselves are not.
+        u64 mem = sizeof(*this) + lv0.heapBytes() + lv1.heapBytes()
+                  + lv2.heapBytes() + lv3.heapBytes();
+        for (u32 i = 0; i < LEVELS; ++i) {
+            mem += blank[i].heapBytes() + keys[i].heapBytes()
+                   + heap_bytes(hash[i]);
+        }
         return mem;
     }
 
-    template <typename META>
-    void AndorSketch<META>::append(u32 id, u32 value) {
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::append(KeyArg id, u32 value) {
+        if (snapshots.pending()) {
+            publish();
+        }
+
+#ifdef ANDOR_STATS
+        u64 start = CycleClock::start();
+#endif
         u32 level = calcAppendLevel(id);
         if (level == 0) {
             appendTiny(id, value);
         } else {
             appendMETA(level, id, value);
         }
+#ifdef ANDOR_STATS
+        counters[level].appends.add();
+        counters[level].appendTicks.add(CycleClock::stop() - start);
+        if (dumpEvery != 0 && ++sinceDump == dumpEvery) {
+            sinceDump = 0;
+            stats().dump(*dumpOut);
+        }
+#endif
     }
 
-    template <typename META>
-    void AndorSketch<META>::appendTiny(u32 id, u32 value) {
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::appendTiny(KeyArg id, u32 value) {
         const auto& hv = hashVal[0];
-        for (u32 i = 0; i < hv.size(); ++i) {
+        for (u32 i = 0; i < hashNum; ++i) {
             u32 pos = hv[i] / 4;
             u32 idx = hv[i] % 4;
             if (!lv0[pos].full(idx)) {
-                lv0[pos].append(value, idx);
+                lv0.mut(pos).append(value, idx);
+#ifdef ANDOR_STATS
+                if (lv0[pos].full(idx)) {
+                    counters[0].promotions.add();
+                }
+#endif
             }
         }
     }
 
-    template <typename META>
-    void AndorSketch<META>::appendMETA(u32 level, u32 id, u32 value) {
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::appendMETA(u32 level, KeyArg id, u32 value) {
         auto& vec = getVecMETA(level);
         const auto& hv = hashVal[level];
-        for (u32 i = 0; i < hv.size(); ++i) {
+        for (u32 i = 0; i < hashNum; ++i) {
             if (!vec[hv[i]].full()) {
-                vec[hv[i]].append(value);
+                vec.mut(hv[i]).append(value);
+#ifdef ANDOR_STATS
+                if (vec[hv[i]].full()) {
+                    counters[level].promotions.add();
+                }
+#endif
             }
         }
+
+        if (level >= KEY_LEVEL) {
+            claimKey(level, id);
+        }
     }
 
-    template <typename META>
-    Histogram AndorSketch<META>::doOR(u32 id) const {
-        u32 level = calcQueryLevel(id);
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::claimKey(u32 level, KeyArg id) {
+        auto& key = keys[level];
+        const auto& hv = hashVal[level];
+        const Key none = KeyTraits<Key>::empty();
+        u32 empty = UINT32_MAX;
+        for (u32 i = 0; i < hashNum; ++i) {
+            if (key[hv[i]] == id) {
+                return;
+            }
+            if (key[hv[i]] == none && empty == UINT32_MAX) {
+                empty = hv[i];
+            }
+        }
+        if (empty != UINT32_MAX) {
+            key.mut(empty) = id;
+            return;
+        }
 
+        // Take over a bucket whose flow holds another one in this level.
+        for (u32 i = 0; i < hashNum; ++i) {
+            Key other = key[hv[i]];
+            for (u32 j = 0; j < hashNum; ++j) {
+                u32 pos = hash[level][j].run(other) % key.size();
+                if (pos != hv[i] && key[pos] == other) {
+                    key.mut(hv[i]) = id;
+                    return;
+                }
+            }
+        }
+    }
+
+    template <typename META, typename Key>
+    Histogram AndorSketch<META, Key>::doOR(u32 level, KeyArg id) const {
         if (level == 0) {
             throw std::runtime_error("combine() is not supported in level 0");
         }
@@ -107,45 +251,186 @@ namespace sketch {
         return hist;
     }
 
-    template <typename META>
-    u32 AndorSketch<META>::quantile(u32 id, f64 nom_rank) const {
-        return doOR(id).quantile(nom_rank);
+    template <typename META, typename Key>
+    u32 AndorSketch<META, Key>::quantile(KeyArg id, f64 nom_rank) const {
+#ifdef ANDOR_STATS
+        u64 start = CycleClock::start();
+#endif
+        u32 level = calcQueryLevel(id);
+        u32 res = doOR(level, id).quantile(nom_rank);
+#ifdef ANDOR_STATS
+        countQuery(level, start);
+#endif
+        return res;
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::quantiles(KeyArg id, const f64* ranks, u32 n,
+                                      u32* out) const {
+#ifdef ANDOR_STATS
+        u64 start = CycleClock::start();
+#endif
+        u32 level = calcQueryLevel(id);
+        doOR(level, id).quantiles(ranks, n, out);
+#ifdef ANDOR_STATS
+        countQuery(level, start);
+#endif
     }
 
-    template <typename META>
-    Histogram AndorSketch<META>::doAND(u32 level, u32 id) const {
-        const auto& vec = getVecMETA(level);
-        const auto& hv = hashVal[level];
-        
-#ifdef TEST_DD
-        DDSketch res = vec[hv[0]];
+    template <typename META, typename Key>
+    Histogram AndorSketch<META, Key>::histogram(KeyArg id) const {
+#ifdef ANDOR_STATS
+        u64 start = CycleClock::start();
+#endif
+        // Tiny flows only leave a maximum in lv0, not a distribution.
+        u32 level = calcQueryLevel(id);
+        Histogram res = level == 0 ? Histogram() : doOR(level, id);
+#ifdef ANDOR_STATS
+        countQuery(level, start);
+#endif
+        return res;
+    }
 
-        auto& cnters = res.counters;
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::clear() {
+        lv0.fill(TinyCnter());
+        lv1.fill(blank[1]);
+        lv2.fill(blank[2]);
+        lv3.fill(blank[3]);
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            keys[i].fill(KeyTraits<Key>::empty());
+        }
+    }
 
-        for (u32 i = 1; i < hv.size(); ++i) {
-            const auto& temp = vec[hv[i]];
-            for (u32 j = 0; j < cnters.size(); ++j) {
-                cnters[j] = std::min(cnters[j], temp.counters[j]);
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::save(const string& path, bool compact) const {
+        BinaryWriter out(path, compact);
+        out.putHeader(ANDOR, META::MODEL, sizeof(Key));
+        out.put(hashNum);
+        out.put(hashSeed);
+
+        out.put<u64>(lv0.size());
+        for (u64 i = 0; i < lv0.size(); ++i) {
+            lv0[i].saveState(out);
+        }
+        for (u32 i = 1; i < LEVELS; ++i) {
+            save_level(out, blank[i], getVecMETA(i));
+        }
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            for (u64 j = 0; j < keys[i].size(); ++j) {
+                out.put(keys[i][j]);
             }
         }
+        out.close();
+    }
 
-        return static_cast<Histogram>(res);
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::load(const string& path) {
+        MappedFile file(path);
+        BinaryReader in(file.data(), file.size());
+        in.getHeader(ANDOR, META::MODEL, sizeof(Key));
+        u32 hash_num = in.get<u32>();
+        u32 seed = in.get<u32>();
+        if (hash_num == 0 || hash_num > MAX_HASH_NUM) {
+            throw std::runtime_error("corrupt sketch file");
+        }
 
-#else
-        Histogram hist = static_cast<Histogram>(vec[hv[0]]);
-        for (u32 i = 1; i < hv.size(); ++i) {
-            hist = hist & vec[hv[i]];
+        // Read into temporaries so that a bad file leaves us untouched.
+        u64 num = in.get<u64>();
+        if (num > in.remaining()) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        std::shared_ptr<HugeRegion> region_tmp[LEVELS];
+        region_tmp[0] = makeRegion(0, num);
+        vec_tiny tiny(num, TinyCnter(),
+                      HugePageAllocator<TinyCnter>(region_tmp[0]));
+        for (u64 i = 0; i < num; ++i) {
+            tiny.mut(i).loadState(in);
+        }
+
+        META proto[LEVELS];
+        vec_meta vec[LEVELS];
+        for (u32 i = 1; i < LEVELS; ++i) {
+            num = load_level_head(in, proto[i]);
+            region_tmp[i] = makeRegion(i, num);
+            vec[i] = vec_meta(num, proto[i],
+                              HugePageAllocator<META>(region_tmp[i]));
+            for (u64 j = 0; j < num; ++j) {
+                vec[i].mut(j).loadState(in);
+            }
+        }
+        vec_key key[LEVELS];
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            key[i] = vec_key(vec[i].size(), KeyTraits<Key>::empty(),
+                             HugePageAllocator<Key>(region_tmp[i]));
+            for (u64 j = 0; j < key[i].size(); ++j) {
+                key[i].mut(j) = in.get<Key>();
+            }
+        }
+        if (in.remaining() != 0) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        lv0 = std::move(tiny);
+        lv1 = std::move(vec[1]);
+        lv2 = std::move(vec[2]);
+        lv3 = std::move(vec[3]);
+        for (u32 i = 1; i < LEVELS; ++i) {
+            blank[i] = proto[i];
+        }
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            keys[i] = std::move(key[i]);
+        }
+        for (u32 i = 0; i < LEVELS; ++i) {
+            region[i] = std::move(region_tmp[i]);
+        }
+        hashNum = hash_num;
+        initHash(seed);
+    }
+
+    template <typename META, typename Key>
+    Histogram AndorSketch<META, Key>::doAND(u32 level, KeyArg id) const {
+        const auto& vec = getVecMETA(level);
+        const auto& hv = hashVal[level];
+
+#ifdef ANDOR_STATS
+        counters[level].ands.add();
+        for (u32 i = 1; i < hashNum; ++i) {
+            if (vec[hv[i]].size() != vec[hv[0]].size()) {
+                counters[level].andCollisions.add();
+                break;
+            }
         }
-        
-        return hist;
 #endif
+
+        if constexpr (std::is_same_v<META, DDSketch>) {
+            DDSketch res = vec[hv[0]];
+
+            auto& cnters = res.counters;
+
+            for (u32 i = 1; i < hashNum; ++i) {
+                const auto& temp = vec[hv[i]];
+                for (u32 j = 0; j < cnters.size(); ++j) {
+                    cnters[j] = std::min(cnters[j], temp.counters[j]);
+                }
+            }
+
+            return static_cast<Histogram>(res);
+        } else {
+            Histogram hist = static_cast<Histogram>(vec[hv[0]]);
+            for (u32 i = 1; i < hashNum; ++i) {
+                hist = hist & vec[hv[i]];
+            }
+
+            return hist;
+        }
     }
 
-    template <typename META>
-    void AndorSketch<META>::calcHash(u32 id) const {
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::calcHash(KeyArg id) const {
         // This function lies in hot path.
         // So we endure the verbose code to improve performance.
-        const u32 hash_num = hash[0].size();
+        const u32 hash_num = hashNum;
         u32 mod;
         
         mod = 4 * lv0.size();
@@ -166,10 +451,10 @@ namespace sketch {
         }
     }
 
-    template <typename META>
-    bool AndorSketch<META>::isAllFull(u32 level, u32 id) const {
+    template <typename META, typename Key>
+    bool AndorSketch<META, Key>::isAllFull(u32 level, KeyArg id) const {
         if (level == 0) {
-            for (u32 i = 0; i < hashVal[0].size(); ++i) {
+            for (u32 i = 0; i < hashNum; ++i) {
                 u32 pos = hashVal[0][i] / 4;
                 u32 idx = hashVal[0][i] % 4;
                 if (!lv0[pos].full(idx)) {
@@ -180,7 +465,7 @@ namespace sketch {
         }
 
         const auto& vec = getVecMETA(level);
-        for (u32 i = 0; i < hashVal[level].size(); ++i) {
+        for (u32 i = 0; i < hashNum; ++i) {
             if (!vec[hashVal[level][i]].full()) {
                 return false;
             }
@@ -188,10 +473,10 @@ namespace sketch {
         return true;
     }
 
-    template <typename META>
-    bool AndorSketch<META>::hasAnyFull(u32 level, u32 id) const {
+    template <typename META, typename Key>
+    bool AndorSketch<META, Key>::hasAnyFull(u32 level, KeyArg id) const {
         if (level == 0) {
-            for (u32 i = 0; i < hashVal[0].size(); ++i) {
+            for (u32 i = 0; i < hashNum; ++i) {
                 u32 pos = hashVal[0][i] / 4;
                 u32 idx = hashVal[0][i] % 4;
                 if (lv0[pos].full(idx)) {
@@ -202,7 +487,7 @@ namespace sketch {
         }
 
         const auto& vec = getVecMETA(level);
-        for (u32 i = 0; i < hashVal[level].size(); ++i) {
+        for (u32 i = 0; i < hashNum; ++i) {
             if (vec[hashVal[level][i]].full()) {
                 return true;
             }
@@ -210,10 +495,10 @@ namespace sketch {
         return false;
     }
 
-    template <typename META>
-    bool AndorSketch<META>::hasAnyEmpty(u32 level, u32 id) const {
+    template <typename META, typename Key>
+    bool AndorSketch<META, Key>::hasAnyEmpty(u32 level, KeyArg id) const {
         if (level == 0) {
-            for (u32 i = 0; i < hashVal[0].size(); ++i) {
+            for (u32 i = 0; i < hashNum; ++i) {
                 u32 pos = hashVal[0][i] / 4;
                 u32 idx = hashVal[0][i] % 4;
                 if (lv0[pos].empty(idx)) {
@@ -224,7 +509,7 @@ namespace sketch {
         }
 
         const auto& vec = getVecMETA(level);
-        for (u32 i = 0; i < hashVal[level].size(); ++i) {
+        for (u32 i = 0; i < hashNum; ++i) {
             if (vec[hashVal[level][i]].empty()) {
                 return true;
             }
@@ -232,8 +517,8 @@ namespace sketch {
         return false;
     }
 
-    template <typename META>
-    u32 AndorSketch<META>::calcAppendLevel(u32 id) const {
+    template <typename META, typename Key>
+    u32 AndorSketch<META, Key>::calcAppendLevel(KeyArg id) const {
         calcHash(id);
         for (u32 i = 0; i < LEVELS; ++i) {
             if (!hasAnyFull(i, id) || hasAnyEmpty(i, id)) {
@@ -244,8 +529,8 @@ namespace sketch {
         throw::runtime_error("the whole META DiffSketch is full");
     }
 
-    template <typename META>
-    u32 AndorSketch<META>::calcQueryLevel(u32 id) const {
+    template <typename META, typename Key>
+    u32 AndorSketch<META, Key>::calcQueryLevel(KeyArg id) const {
         calcHash(id);
         for (u32 i = 0; i < LEVELS; ++i) {
             if (i != 0 && hasAnyEmpty(i, id)) {
@@ -259,8 +544,112 @@ namespace sketch {
         throw::runtime_error("the whole META DiffSketch is full");
     }
 
-    template <typename META>
-    auto AndorSketch<META>::getVecMETA(u32 level) -> vec_meta& {
+    template <typename META, typename Key>
+    vector<Key> AndorSketch<META, Key>::flows() const {
+        const Key none = KeyTraits<Key>::empty();
+        vector<Key> res;
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            for (u64 j = 0; j < keys[i].size(); ++j) {
+                if (keys[i][j] != none) {
+                    res.push_back(keys[i][j]);
+                }
+            }
+        }
+
+        // A flow claims up to one bucket per hash function and level.
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+        return res;
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::publish() {
+        snapshots.publish(
+            std::make_shared<const AndorSketch<META, Key>>(*this));
+    }
+
+    template <typename META, typename Key>
+    auto AndorSketch<META, Key>::snapshot() const -> Snapshot {
+        return snapshots.latest();
+    }
+
+    template <typename META, typename Key>
+    u64 AndorSketch<META, Key>::requestSnapshot() const {
+        return snapshots.request();
+    }
+
+    template <typename META, typename Key>
+    auto AndorSketch<META, Key>::waitSnapshot(u64 epoch) const -> Snapshot {
+        return snapshots.wait(epoch);
+    }
+
+    template <typename META, typename Key>
+    u64 AndorSketch<META, Key>::epoch() const {
+        return snapshots.epoch();
+    }
+
+#ifdef ANDOR_STATS
+    template <typename META, typename Key>
+    AndorStats AndorSketch<META, Key>::stats() const {
+        AndorStats res;
+        for (u32 i = 0; i < LEVELS; ++i) {
+            const LevelCounters& cnt = counters[i];
+            res.appends[i] = cnt.appends.load();
+            res.queries[i] = cnt.queries.load();
+            res.appendTicks[i] = cnt.appendTicks.load();
+            res.queryTicks[i] = cnt.queryTicks.load();
+            res.promotions[i] = cnt.promotions.load();
+            res.ands[i] = cnt.ands.load();
+            res.andCollisions[i] = cnt.andCollisions.load();
+        }
+
+        res.buckets[0] = 4 * lv0.size();
+        for (u64 i = 0; i < lv0.size(); ++i) {
+            for (u32 idx = 0; idx < 4; ++idx) {
+                res.fullBuckets[0] += lv0[i].full(idx);
+                res.emptyBuckets[0] += lv0[i].empty(idx);
+            }
+        }
+        for (u32 i = 1; i < LEVELS; ++i) {
+            const auto& vec = getVecMETA(i);
+            res.buckets[i] = vec.size();
+            for (u64 j = 0; j < vec.size(); ++j) {
+                res.fullBuckets[i] += vec[j].full();
+                res.emptyBuckets[i] += vec[j].empty();
+            }
+        }
+        return res;
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::resetStats() {
+        for (auto& cnt : counters) {
+            for (StatCounter* c : {&cnt.appends, &cnt.queries,
+                                   &cnt.appendTicks, &cnt.queryTicks,
+                                   &cnt.promotions, &cnt.ands,
+                                   &cnt.andCollisions}) {
+                c->reset();
+            }
+        }
+        sinceDump = 0;
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::dumpStatsEvery(u64 appends, std::ostream& out) {
+        dumpEvery = appends;
+        dumpOut = &out;
+        sinceDump = 0;
+    }
+
+    template <typename META, typename Key>
+    void AndorSketch<META, Key>::countQuery(u32 level, u64 start) const {
+        counters[level].queries.add();
+        counters[level].queryTicks.add(CycleClock::stop() - start);
+    }
+#endif
+
+    template <typename META, typename Key>
+    auto AndorSketch<META, Key>::getVecMETA(u32 level) -> vec_meta& {
         switch (level) {
             case 1: return lv1;
             case 2: return lv2;
@@ -271,8 +660,8 @@ namespace sketch {
             "AndorSketch<META>::getVecMETA(): shouldn't reach here");
     }
 
-    template <typename META>
-    auto AndorSketch<META>::getVecMETA(u32 level) const -> const vec_meta& {
+    template <typename META, typename Key>
+    auto AndorSketch<META, Key>::getVecMETA(u32 level) const -> const vec_meta& {
         switch (level) {
             case 1: return lv1;
             case 2: return lv2;
@@ -283,15 +672,27 @@ namespace sketch {
             "AndorSketch<META>::getVecMETA(): shouldn't reach here");
     }
 
-    template <typename META>
-    u32 AndorSketch<META>::size(u32 id) const {
-        // This function will not be called.
-        assert(false);
-        return 0;
+    template <typename META, typename Key>
+    u32 AndorSketch<META, Key>::size(KeyArg id) const {
+        // Every level the flow reached holds part of its items, each
+        // bucket counting them with the collisions it shares, so the
+        // smallest bucket of a level bounds the flow's share there.
+        u32 level = calcQueryLevel(id);
+        u32 res = 0;
+        for (u32 i = 0; i <= level; ++i) {
+            const auto& hv = hashVal[i];
+            u32 least = UINT32_MAX;
+            for (u32 j = 0; j < hashNum; ++j) {
+                least = std::min(least, i == 0 ? lv0[hv[j] / 4].count(hv[j] % 4)
+                                               : getVecMETA(i)[hv[j]].size());
+            }
+            res += least;
+        }
+        return res;
     }
 
-    template <typename META>
-    FlowType AndorSketch<META>::type(u32 id) const {
+    template <typename META, typename Key>
+    FlowType AndorSketch<META, Key>::type(KeyArg id) const {
         u32 level = calcQueryLevel(id);
         switch (level) {
             case 0: return TINY;
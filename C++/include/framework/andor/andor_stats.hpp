@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+#include "../../common/sketch_defs.hpp"
+#include "../../common/cycle_clock.hpp"
+
+namespace sketch {
+    /// @brief Relaxed atomic counter that is copied along with its owner,
+    ///        so that snapshots carry the counts taken so far.
+    class StatCounter {
+    public:
+        StatCounter() = default;
+        StatCounter(const StatCounter& other) : val(other.load()) { }
+
+        StatCounter& operator=(const StatCounter& other) {
+            val.store(other.load(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        void add(u64 n = 1) { val.fetch_add(n, std::memory_order_relaxed); }
+        void reset() { val.store(0, std::memory_order_relaxed); }
+        u64 load() const { return val.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<u64> val{0};
+    };
+
+    /// @brief Runtime counters of an @c AndorSketch, a snapshot of them
+    ///        together with bucket occupancy.
+    /// @details Appends and queries count at the level they land on, with
+    ///          the timestamp ticks they took, which cover hashing and
+    ///          level selection too.
+    struct AndorStats {
+        static constexpr u32 LEVELS = 4;    ///< Number of levels.
+
+        u64 appends[LEVELS] = {};       ///< Appends landing at each level.
+        u64 queries[LEVELS] = {};       ///< Queries answered from each level.
+        u64 appendTicks[LEVELS] = {};   ///< Ticks spent in those appends.
+        u64 queryTicks[LEVELS] = {};    ///< Ticks spent in those queries.
+        /// Buckets (counters in lv0) that became full, from which on the
+        /// flows hashed to them are promoted to the next level.
+        u64 promotions[LEVELS] = {};
+        u64 ands[LEVELS] = {};          ///< Calls of @c doAND.
+        /// @c doAND calls whose buckets differ in size, i.e. at least one
+        /// of them also holds items of colliding flows.
+        u64 andCollisions[LEVELS] = {};
+
+        u64 buckets[LEVELS] = {};       ///< Buckets (counters in lv0).
+        u64 fullBuckets[LEVELS] = {};   ///< Full buckets.
+        u64 emptyBuckets[LEVELS] = {};  ///< Empty buckets.
+
+        /// @brief Write the counters as a table, one row per level, with
+        ///        derived fractions and ticks in ns.
+        void dump(std::ostream& out) const;
+    };
+}   // namespace sketch
+
+#include "andor_stats_impl.hpp"
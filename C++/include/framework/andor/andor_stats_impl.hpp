@@ -0,0 +1,36 @@
+#pragma once
+#include "andor_stats.hpp"
+#include <iomanip>
+
+namespace sketch {
+    void AndorStats::dump(std::ostream& out) const {
+        auto ratio = [](u64 a, u64 b) {
+            return b == 0 ? 0.0 : static_cast<f64>(a) / b;
+        };
+        f64 tick_ns = CycleClock::ticksPerNs();
+
+        auto flags = out.flags();
+        auto precision = out.precision(4);
+        out << std::left
+            << std::setw(6) << "level"
+            << std::setw(12) << "appends" << std::setw(12) << "ns/append"
+            << std::setw(12) << "queries" << std::setw(12) << "ns/query"
+            << std::setw(12) << "promotions" << std::setw(12) << "and-coll"
+            << std::setw(10) << "full" << std::setw(10) << "empty"
+            << endl;
+        for (u32 i = 0; i < LEVELS; ++i) {
+            out << std::setw(6) << i
+                << std::setw(12) << appends[i]
+                << std::setw(12) << ratio(appendTicks[i], appends[i]) / tick_ns
+                << std::setw(12) << queries[i]
+                << std::setw(12) << ratio(queryTicks[i], queries[i]) / tick_ns
+                << std::setw(12) << promotions[i]
+                << std::setw(12) << ratio(andCollisions[i], ands[i])
+                << std::setw(10) << ratio(fullBuckets[i], buckets[i])
+                << std::setw(10) << ratio(emptyBuckets[i], buckets[i])
+                << endl;
+        }
+        out.precision(precision);
+        out.flags(flags);
+    }
+}   // namespace sketch
@@ -0,0 +1,105 @@
+#pragma once
+#include "../../common/binary_io.hpp"
+#include "../../meta/dd/ddsketch.hpp"
+#include "andor_sketch.hpp"
+
+namespace sketch {
+    /// @brief Read-only @c AndorSketch of DDSketches, queried in place from
+    ///        a sketch file it saved.
+    /// @details Opening maps the file and reads the header and the
+    ///          parameters of each level only, so it takes the same time
+    ///          whatever the size of the sketch. Tiny counters, DDSketch
+    ///          states and keys have a fixed stride per level, and queries
+    ///          read the buckets they hash to straight from the mapping,
+    ///          faulting pages in as they go. Answers are those of an
+    ///          @c AndorSketch loading the same file.
+    ///
+    ///          Compact files vary in stride and must be loaded instead.
+    /// @tparam Key Flow key of the saved sketch.
+    template <typename Key = u32>
+    class AndorView final : public BasicFramework<Key> {
+        using KeyArg = typename BasicFramework<Key>::KeyArg;
+        using Sketch = AndorSketch<DDSketch, Key>;
+
+    public:
+        /// @brief Map a sketch file saved by @c AndorSketch::save.
+        /// @param path Path of the file.
+        /// @throw std::runtime_error if the file is not a sketch file of
+        ///        the same type, is compact, or its size does not match
+        ///        its levels.
+        explicit AndorView(const string& path);
+
+        AndorView(const AndorView&) = delete;
+        AndorView& operator=(const AndorView&) = delete;
+
+        /// @throw std::logic_error always, the view is read-only.
+        void append(KeyArg id, u32 value) override;
+        u32 size(KeyArg id) const override;
+        u64 memory() const override;
+        /// @brief Return the bytes of the object and its hashes, the
+        ///        mapping not being heap memory.
+        u64 heapBytes() const override;
+        u32 quantile(KeyArg id, f64 nom_rank) const override;
+        void quantiles(KeyArg id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(KeyArg id) const override;
+        /// @throw std::logic_error always, the view is read-only.
+        void clear() override;
+        vector<Key> flows() const override;
+        FlowType type(KeyArg id) const override;
+
+    private:
+        static constexpr u32 LEVELS = Sketch::LEVELS;
+        static constexpr u32 KEY_LEVEL = Sketch::KEY_LEVEL;
+        static constexpr u32 TINY_STRIDE = 1 + sizeof(u32); ///< Counts, max.
+
+        /// @brief Buckets of a level in the mapping.
+        struct Level {
+            const u8* data = nullptr;   ///< First bucket.
+            u64 num = 0;                ///< Number of buckets.
+            u64 stride = 0;             ///< Bytes per bucket.
+            u32 width = 0;              ///< Bytes per DDSketch counter.
+            DDSketch blank;             ///< Empty bucket, lv1 to lv3.
+        };
+
+        MappedFile file;                ///< Mapped sketch file.
+        Level level[LEVELS];            ///< Levels.
+        const u8* keys[LEVELS] = {};    ///< Keys from @c KEY_LEVEL on.
+        std::vector<KeyHash<Key>> hash[LEVELS]; ///< Hash functions.
+        u32 hashNum;                    ///< Hash functions per level.
+
+        /// Hash values of the last hashed flow, see @c AndorSketch.
+        inline static thread_local u32 hashVal[LEVELS][Sketch::MAX_HASH_NUM];
+
+        /// @brief Return the count of a tiny counter of lv0.
+        /// @param slot Bucket times 4 plus counter index.
+        u32 tinyCount(u32 slot) const;
+
+        /// @brief Return the items of a DDSketch bucket.
+        u32 items(u32 lv, u32 bucket) const;
+
+        /// @brief Return the largest counter of a DDSketch bucket.
+        u32 maxCount(u32 lv, u32 bucket) const;
+
+        /// @brief Return a counter of a DDSketch bucket.
+        u32 counter(u32 lv, u32 bucket, u32 idx) const;
+
+        /// @brief Return a key of a level from @c KEY_LEVEL on.
+        Key key(u32 lv, u64 bucket) const;
+
+        /// @brief Calculate hash values for a given flow.
+        void calcHash(KeyArg id) const;
+
+        bool hasAnyFull(u32 lv) const;
+        bool hasAnyEmpty(u32 lv) const;
+
+        /// @brief Calculate the query level of the hashed flow, see
+        ///        @c AndorSketch::calcQueryLevel.
+        u32 calcQueryLevel(KeyArg id) const;
+
+        Histogram doAND(u32 lv) const;
+        Histogram doOR(u32 lv) const;
+    };
+}   // namespace sketch
+
+#include "andor_view_impl.hpp"
@@ -0,0 +1,256 @@
+#pragma once
+#include "andor_view.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "../framework_utils.hpp"
+
+namespace sketch {
+    template <typename Key>
+    AndorView<Key>::AndorView(const string& path) : file(path, false) {
+        BinaryReader in(file.data(), file.size());
+        in.getHeader(ANDOR, DDSketch::MODEL, sizeof(Key));
+        if (in.compact()) {
+            throw std::runtime_error(
+                "compact sketch files cannot be queried in place");
+        }
+        hashNum = in.get<u32>();
+        u32 seed = in.get<u32>();
+        if (hashNum == 0 || hashNum > Sketch::MAX_HASH_NUM) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        // Only the geometry is read, the buckets are skipped over whole.
+        auto take = [&in](Level& lv) {
+            if (lv.num == 0 || lv.num > in.remaining() / lv.stride) {
+                throw std::runtime_error("corrupt sketch file");
+            }
+            lv.data = in.skip(lv.num * lv.stride);
+        };
+        level[0].num = in.get<u64>();
+        level[0].stride = TINY_STRIDE;
+        take(level[0]);
+        for (u32 i = 1; i < LEVELS; ++i) {
+            Level& lv = level[i];
+            lv.num = load_level_head(in, lv.blank);
+            lv.width = packed_width(lv.blank.cap);
+            if (lv.blank.counters.empty()) {
+                throw std::runtime_error("corrupt sketch file");
+            }
+            // items, the largest counter and the counters, see
+            // DDSketch::saveState
+            lv.stride = sizeof(u32) + lv.width
+                        + lv.width * lv.blank.counters.size();
+            take(lv);
+        }
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            if (level[i].num > in.remaining() / sizeof(Key)) {
+                throw std::runtime_error("corrupt sketch file");
+            }
+            keys[i] = in.skip(level[i].num * sizeof(Key));
+        }
+        if (in.remaining() != 0) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        Sketch::makeHash(seed, hashNum, hash);
+    }
+
+    template <typename Key>
+    void AndorView<Key>::append(KeyArg id, u32 value) {
+        UNUSED(id);
+        UNUSED(value);
+        throw std::logic_error("append to a read-only sketch");
+    }
+
+    template <typename Key>
+    void AndorView<Key>::clear() {
+        throw std::logic_error("clear of a read-only sketch");
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::tinyCount(u32 slot) const {
+        u8 cnt = level[0].data[u64(slot / 4) * TINY_STRIDE];
+        return (cnt >> (2 * (slot % 4))) & 3;
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::items(u32 lv, u32 bucket) const {
+        return read_packed(level[lv].data + bucket * level[lv].stride,
+                           sizeof(u32));
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::maxCount(u32 lv, u32 bucket) const {
+        return read_packed(level[lv].data + bucket * level[lv].stride
+                           + sizeof(u32), level[lv].width);
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::counter(u32 lv, u32 bucket, u32 idx) const {
+        const Level& l = level[lv];
+        return read_packed(l.data + bucket * l.stride + sizeof(u32)
+                           + (1 + idx) * l.width, l.width);
+    }
+
+    template <typename Key>
+    Key AndorView<Key>::key(u32 lv, u64 bucket) const {
+        Key res;
+        memcpy(&res, keys[lv] + bucket * sizeof(Key), sizeof(Key));
+        return res;
+    }
+
+    template <typename Key>
+    void AndorView<Key>::calcHash(KeyArg id) const {
+        for (u32 i = 0; i < LEVELS; ++i) {
+            u64 mod = i == 0 ? 4 * level[0].num : level[i].num;
+            for (u32 j = 0; j < hashNum; ++j) {
+                hashVal[i][j] = hash[i][j].run(id) % mod;
+            }
+        }
+    }
+
+    template <typename Key>
+    bool AndorView<Key>::hasAnyFull(u32 lv) const {
+        for (u32 i = 0; i < hashNum; ++i) {
+            u32 hv = hashVal[lv][i];
+            if (lv == 0 ? tinyCount(hv) == 3
+                        : maxCount(lv, hv) >= level[lv].blank.cap) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Key>
+    bool AndorView<Key>::hasAnyEmpty(u32 lv) const {
+        for (u32 i = 0; i < hashNum; ++i) {
+            u32 hv = hashVal[lv][i];
+            if (lv == 0 ? tinyCount(hv) == 0 : items(lv, hv) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::calcQueryLevel(KeyArg id) const {
+        calcHash(id);
+        for (u32 i = 0; i < LEVELS; ++i) {
+            if (i != 0 && hasAnyEmpty(i)) {
+                return i - 1;
+            }
+            if (!hasAnyFull(i)) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("the whole META DiffSketch is full");
+    }
+
+    template <typename Key>
+    Histogram AndorView<Key>::doAND(u32 lv) const {
+        DDSketch res = level[lv].blank;
+        auto& cnters = res.counters;
+        for (u32 j = 0; j < cnters.size(); ++j) {
+            u32 least = UINT32_MAX;
+            for (u32 i = 0; i < hashNum; ++i) {
+                least = std::min(least, counter(lv, hashVal[lv][i], j));
+            }
+            cnters[j] = least;
+        }
+        return static_cast<Histogram>(res);
+    }
+
+    template <typename Key>
+    Histogram AndorView<Key>::doOR(u32 lv) const {
+        if (lv == 0) {
+            throw std::runtime_error("combine() is not supported in level 0");
+        }
+
+        Histogram hist = doAND(lv);
+        for (u32 i = lv - 1; i >= 1; --i) {
+            if (hasAnyEmpty(i)) {
+                continue;
+            }
+            hist = hist | doAND(i);
+        }
+        return hist;
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::size(KeyArg id) const {
+        u32 lv = calcQueryLevel(id);
+        u32 res = 0;
+        for (u32 i = 0; i <= lv; ++i) {
+            u32 least = UINT32_MAX;
+            for (u32 j = 0; j < hashNum; ++j) {
+                u32 hv = hashVal[i][j];
+                least = std::min(least, i == 0 ? tinyCount(hv) : items(i, hv));
+            }
+            res += least;
+        }
+        return res;
+    }
+
+    template <typename Key>
+    u64 AndorView<Key>::memory() const {
+        u64 mem = level[0].num * TinyCnter().memory();
+        for (u32 i = 1; i < LEVELS; ++i) {
+            mem += level[i].num * level[i].blank.memory();
+        }
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            mem += level[i].num * sizeof(Key);
+        }
+        return mem;
+    }
+
+    template <typename Key>
+    u64 AndorView<Key>::heapBytes() const {
+        u64 mem = sizeof(*this);
+        for (u32 i = 0; i < LEVELS; ++i) {
+            mem += level[i].blank.heapBytes() + heap_bytes(hash[i]);
+        }
+        return mem;
+    }
+
+    template <typename Key>
+    u32 AndorView<Key>::quantile(KeyArg id, f64 nom_rank) const {
+        return doOR(calcQueryLevel(id)).quantile(nom_rank);
+    }
+
+    template <typename Key>
+    void AndorView<Key>::quantiles(KeyArg id, const f64* ranks, u32 n,
+                                   u32* out) const {
+        doOR(calcQueryLevel(id)).quantiles(ranks, n, out);
+    }
+
+    template <typename Key>
+    Histogram AndorView<Key>::histogram(KeyArg id) const {
+        u32 lv = calcQueryLevel(id);
+        return lv == 0 ? Histogram() : doOR(lv);
+    }
+
+    template <typename Key>
+    vector<Key> AndorView<Key>::flows() const {
+        const Key none = KeyTraits<Key>::empty();
+        vector<Key> res;
+        for (u32 i = KEY_LEVEL; i < LEVELS; ++i) {
+            for (u64 j = 0; j < level[i].num; ++j) {
+                Key k = key(i, j);
+                if (k != none) {
+                    res.push_back(k);
+                }
+            }
+        }
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+        return res;
+    }
+
+    template <typename Key>
+    FlowType AndorView<Key>::type(KeyArg id) const {
+        u32 lv = calcQueryLevel(id);
+        return lv == 0 ? TINY : lv == 1 ? MID : HUGE;
+    }
+}   // namespace sketch
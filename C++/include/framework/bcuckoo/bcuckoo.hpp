@@ -0,0 +1,123 @@
+#pragma once
+#include "../../common/flow_key.hpp"
+#include "../../common/sketch_defs.hpp"
+#include "../../common/sketch_utils.hpp"
+#include "../framework.hpp"
+
+namespace sketch {
+    /// @brief Set-associative cuckoo table.
+    /// @details Every flow has two candidate buckets of @c SLOTS slots each,
+    ///          plus a small overflow stash shared by the whole table, which
+    ///          lets the table fill far beyond the ~50% a one-slot cuckoo
+    ///          reaches under the same memory limit.
+    /// @tparam Key Flow key, kept in the slots as its @c KeyTraits::word,
+    ///             wider keys finding their second bucket as in @c Cuckoo.
+    template <typename META, typename Key = u32>
+    class BCuckoo final : public BasicFramework<Key> {
+        using KeyArg = typename BasicFramework<Key>::KeyArg;
+
+    public:
+        /// @brief Constructor.
+        /// @param mem_limit Memory limit in bytes.
+        /// @param seed Seed for generating hash functions, by default 0.
+        BCuckoo(u64 mem_limit, u32 seed = 0, double ddc_alpha = 0.1);
+
+        void append(KeyArg id, u32 value) override;
+        u32 size(KeyArg id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        u32 quantile(KeyArg id, f64 nom_rank) const override;
+        void quantiles(KeyArg id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(KeyArg id) const override;
+        bool has(KeyArg id) const override;
+        vector<Key> flows() const override;
+        void clear() override;
+        void save(const string& path, bool compact = false) const override;
+        void load(const string& path) override;
+
+        /// @brief Return the fraction of slots (stash included) in use.
+        f64 loadFactor() const;
+
+    private:
+        static constexpr u32 SLOTS = 4;         ///< Slots per bucket.
+        static constexpr u32 STASH_SIZE = 8;    ///< Overflow stash entries.
+        static constexpr u32 MAX_TURN_NUM = 5;  ///< Maximum kicks per path.
+        static constexpr u32 MAX_PATH_NODES = 16;   ///< Buckets searched.
+        static constexpr u32 HASH_NUM = 2;
+        static constexpr f64 alpha = 0.15;
+        static constexpr u32 cmtor_cap = 8;
+        static constexpr u32 td_cap = 32;
+
+        /// @brief A bucket, laid out so its IDs fill one SSE register.
+        struct alignas(32) Bucket {
+            u32 ids[SLOTS];     ///< Words of the flow keys, UINT32_MAX if empty.
+            u32 metas[SLOTS];   ///< Indices of the flows' METAs in @c metas.
+        };
+
+        /// @brief A stash entry.
+        struct Slot {
+            u32 id;     ///< Word of the flow key.
+            u32 meta;   ///< Index of the flow's META in @c metas, kept
+                        ///< clean by unused entries.
+            u32 bucket; ///< First candidate bucket of the flow.
+        };
+
+        /// @brief A node in the breadth-first displacement search.
+        struct PathNode {
+            u32 bucket;     ///< Bucket reached by this node.
+            u32 parent;     ///< Index of the parent node, UINT32_MAX for roots.
+            u32 pslot;      ///< Slot of the parent whose occupant moves here.
+            u32 depth;      ///< Number of kicks from the root.
+        };
+
+        /// Hash functions, only the first for keys wider than 32 bits.
+        KeyHash<Key> h[HASH_NUM];
+        u32 hashSeed;                   ///< Seed of @c h.
+        std::vector<Bucket> buckets;    ///< Buckets.
+        std::vector<META> metas;        ///< META pool, one per slot.
+        Slot stash[STASH_SIZE];         ///< Overflow stash.
+        u32 stash_num = 0;              ///< Entries used in @c stash.
+        u32 used = 0;                   ///< Occupied bucket slots.
+        META dft;
+        META blank;                     ///< Empty slot META.
+        double ddcAlpha;
+        xorshift32 rng;                 ///< Tie breaker for the search.
+
+        /// @brief Return a bit mask of slots in a bucket holding a given word.
+        static u32 match(const Bucket& b, u32 word);
+
+        /// @brief Return the META index of a flow, UINT32_MAX if not resident.
+        /// @param word Word of the flow key.
+        u32 find(u32 word, u32 b1, u32 b2) const;
+
+        /// @brief Make room in one of two full candidate buckets.
+        /// @param b1 The first candidate bucket.
+        /// @param b2 The second candidate bucket.
+        /// @param root Set to the bucket a slot was freed in on success.
+        /// @param slot Set to the freed slot on success.
+        bool displace(u32 b1, u32 b2, u32& root, u32& slot);
+
+        /// @brief Move stash entries back into their buckets where a
+        ///        displacement makes room.
+        void drainStash();
+
+        /// @brief Check if a bucket already lies on the path ending at a node.
+        bool onPath(const PathNode* path, u32 node, u32 bucket) const;
+
+        /// @brief Generate hash functions from a given seed.
+        void initHash(u32 seed);
+
+        /// @brief Return a candidate bucket of a flow.
+        /// @param id Flow key.
+        /// @param word Word of @p id.
+        /// @param h_idx Index of the candidate.
+        u32 pos(KeyArg id, u32 word, u32 h_idx) const;
+
+        /// @brief Return the candidate bucket of a flow other than a given
+        ///        one, from the word kept in the slot.
+        u32 altPos(u32 word, u32 bucket_idx) const;
+    };
+}   // namespace sketch
+
+#include "bcuckoo_impl.hpp"
@@ -0,0 +1,417 @@
+#pragma once
+#include "bcuckoo.hpp"
+#include "../framework_utils.hpp"
+#include "../../common/sketch_utils.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sketch {
+    template <typename META, typename Key>
+    BCuckoo<META, Key>::BCuckoo(u64 mem_limit, u32 seed, double ddc_alpha)
+        : ddcAlpha(ddc_alpha), rng(seed) {
+        initHash(seed);
+
+        // Same per-flow cost as Cuckoo, so both hold the same number of
+        // METAs under a given limit; the stash is carved out of it.
+        blank = createMeta<META>(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
+        u32 num = mem_limit / (sizeof(u32) + blank.memory());
+        u32 bucket_num = num > STASH_SIZE ? (num - STASH_SIZE) / SLOTS : 0;
+        if (bucket_num == 0) {
+            throw std::invalid_argument("memory limit too small for BCuckoo");
+        }
+
+        buckets.resize(bucket_num);
+        for (u32 i = 0; i < bucket_num; ++i) {
+            for (u32 j = 0; j < SLOTS; ++j) {
+                buckets[i].ids[j] = UINT32_MAX;
+                buckets[i].metas[j] = i * SLOTS + j;
+            }
+        }
+        for (u32 i = 0; i < STASH_SIZE; ++i) {
+            stash[i].meta = bucket_num * SLOTS + i;
+        }
+        metas = std::vector<META>(bucket_num * SLOTS + STASH_SIZE, blank);
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddc_alpha);
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::match(const Bucket& b, u32 word) {
+#ifdef __SSE2__
+        __m128i keys = _mm_load_si128(reinterpret_cast<const __m128i*>(b.ids));
+        __m128i eq = _mm_cmpeq_epi32(keys, _mm_set1_epi32(word));
+        return _mm_movemask_ps(_mm_castsi128_ps(eq));
+#else
+        u32 mask = 0;
+        for (u32 i = 0; i < SLOTS; ++i) {
+            mask |= static_cast<u32>(b.ids[i] == word) << i;
+        }
+        return mask;
+#endif
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::append(KeyArg id, u32 value) {
+        dft.append(value);
+
+        u32 word = KeyTraits<Key>::word(id);
+        u32 b1 = pos(id, word, 0), b2 = pos(id, word, 1);
+        u32 idx = find(word, b1, b2);
+        if (idx != UINT32_MAX) {
+            metas[idx].append(value);
+            return;
+        }
+
+        // Claim an empty slot in the emptier candidate bucket.
+        u32 e1 = match(buckets[b1], UINT32_MAX);
+        u32 e2 = match(buckets[b2], UINT32_MAX);
+        u32 b = 0, mask = 0;
+        bool kicked = false;
+        if (e1 != 0 || e2 != 0) {
+            bool first = __builtin_popcount(e1) >= __builtin_popcount(e2);
+            b = first ? b1 : b2;
+            mask = first ? e1 : e2;
+        } else if (used < buckets.size() * SLOTS && displace(b1, b2, b, mask)) {
+            mask = 1u << mask;
+            kicked = true;
+        }
+
+        if (mask != 0) {
+            u32 s = __builtin_ctz(mask);
+            buckets[b].ids[s] = word;
+            metas[buckets[b].metas[s]].append(value);
+            ++used;
+            if (kicked && stash_num != 0) {
+                drainStash();
+            }
+            return;
+        }
+
+        if (stash_num == STASH_SIZE) {
+            drainStash();
+        }
+        if (stash_num < STASH_SIZE) {
+            Slot& slot = stash[stash_num];
+            slot.id = word;
+            slot.bucket = b1;
+            ++stash_num;
+            metas[slot.meta].append(value);
+        }
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::drainStash() {
+        // Buckets never lose occupants, so an entry only gets back in by
+        // a displacement, which a kick-out elsewhere may have made
+        // possible. The entry takes its META along, and leaves the clean
+        // META of the freed slot to its stash entry.
+        for (u32 i = 0; i < stash_num && used < buckets.size() * SLOTS;) {
+            Slot& entry = stash[i];
+            u32 b1 = entry.bucket, b2 = altPos(entry.id, b1);
+            u32 e1 = match(buckets[b1], UINT32_MAX);
+            u32 e2 = match(buckets[b2], UINT32_MAX);
+            u32 b, s;
+            if (e1 != 0) {
+                b = b1;
+                s = __builtin_ctz(e1);
+            } else if (e2 != 0) {
+                b = b2;
+                s = __builtin_ctz(e2);
+            } else if (!displace(b1, b2, b, s)) {
+                ++i;
+                continue;
+            }
+
+            u32 clean = buckets[b].metas[s];
+            buckets[b].ids[s] = entry.id;
+            buckets[b].metas[s] = entry.meta;
+            ++used;
+            --stash_num;
+            std::swap(entry, stash[stash_num]);
+            stash[stash_num].meta = clean;
+        }
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::find(u32 word, u32 b1, u32 b2) const {
+        u32 mask = match(buckets[b1], word);
+        if (mask != 0) {
+            return buckets[b1].metas[__builtin_ctz(mask)];
+        }
+        mask = match(buckets[b2], word);
+        if (mask != 0) {
+            return buckets[b2].metas[__builtin_ctz(mask)];
+        }
+        for (u32 i = 0; i < stash_num; ++i) {
+            if (stash[i].id == word) {
+                return stash[i].meta;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::size(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        u32 idx = find(word, pos(id, word, 0), pos(id, word, 1));
+        return idx != UINT32_MAX ? metas[idx].size() : 0;
+    }
+
+    template <typename META, typename Key>
+    u64 BCuckoo<META, Key>::memory() const {
+        // the budget of the constructor, a flow ID and a META per slot
+        // or stash entry
+        u64 res = metas.size() * sizeof(u32);
+        for (const META& meta : metas) {
+            res += meta.memory();
+        }
+        return res;
+    }
+
+    template <typename META, typename Key>
+    u64 BCuckoo<META, Key>::heapBytes() const {
+        return sizeof(*this) + heap_bytes(buckets) + heap_bytes(metas)
+               + dft.heapBytes() + blank.heapBytes();
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::quantile(KeyArg id, f64 nom_rank) const {
+        u32 word = KeyTraits<Key>::word(id);
+        u32 idx = find(word, pos(id, word, 0), pos(id, word, 1));
+        return idx != UINT32_MAX ? metas[idx].quantile(nom_rank)
+                                 : dft.quantile(nom_rank);
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::quantiles(KeyArg id, const f64* ranks, u32 n,
+                                       u32* out) const {
+        u32 word = KeyTraits<Key>::word(id);
+        u32 idx = find(word, pos(id, word, 0), pos(id, word, 1));
+        const META& meta = idx != UINT32_MAX ? metas[idx] : dft;
+        meta.quantiles(ranks, n, out);
+    }
+
+    template <typename META, typename Key>
+    Histogram BCuckoo<META, Key>::histogram(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        u32 idx = find(word, pos(id, word, 0), pos(id, word, 1));
+        if (idx != UINT32_MAX) {
+            return static_cast<Histogram>(metas[idx]);
+        }
+        return dft.empty() ? Histogram() : static_cast<Histogram>(dft);
+    }
+
+    template <typename META, typename Key>
+    bool BCuckoo<META, Key>::has(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        return find(word, pos(id, word, 0), pos(id, word, 1)) != UINT32_MAX;
+    }
+
+    template <typename META, typename Key>
+    vector<Key> BCuckoo<META, Key>::flows() const {
+        if constexpr (!KeyTraits<Key>::exact) {
+            return BasicFramework<Key>::flows();
+        } else {
+            vector<Key> res;
+            for (const Bucket& b : buckets) {
+                for (u32 i = 0; i < SLOTS; ++i) {
+                    if (b.ids[i] != KeyTraits<Key>::EMPTY) {
+                        res.push_back(KeyTraits<Key>::key(b.ids[i]));
+                    }
+                }
+            }
+            for (u32 i = 0; i < stash_num; ++i) {
+                res.push_back(KeyTraits<Key>::key(stash[i].id));
+            }
+            return res;
+        }
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::clear() {
+        for (auto& bucket : buckets) {
+            for (u32 j = 0; j < SLOTS; ++j) {
+                bucket.ids[j] = UINT32_MAX;
+            }
+        }
+        std::fill(metas.begin(), metas.end(), blank);
+        stash_num = 0;
+        used = 0;
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddcAlpha);
+    }
+
+    template <typename META, typename Key>
+    f64 BCuckoo<META, Key>::loadFactor() const {
+        return static_cast<f64>(used + stash_num) / metas.size();
+    }
+
+    template <typename META, typename Key>
+    bool BCuckoo<META, Key>::displace(u32 b1, u32 b2, u32& root, u32& slot) {
+        // Breadth-first search over buckets: expanding a node looks at the
+        // alternative bucket of each of its occupants, and the search stops
+        // at the first one with a free slot, which gives the shortest path.
+        PathNode path[MAX_PATH_NODES];
+        u32 head = 0, tail = 0;
+        bool swap = rng() & 1;
+        path[tail++] = {swap ? b2 : b1, UINT32_MAX, 0, 0};
+        if (b1 != b2) {
+            path[tail++] = {swap ? b1 : b2, UINT32_MAX, 0, 0};
+        }
+
+        while (head < tail) {
+            u32 node = head++;
+            const Bucket& bucket = buckets[path[node].bucket];
+            u32 offset = rng();
+
+            for (u32 k = 0; k < SLOTS; ++k) {
+                u32 s = (offset + k) % SLOTS;
+                u32 next = altPos(bucket.ids[s], path[node].bucket);
+                if (next == path[node].bucket) {
+                    continue;
+                }
+
+                u32 empty = match(buckets[next], UINT32_MAX);
+                if (empty != 0) {
+                    // Shift occupants one step along the path towards the
+                    // free slot, which ends up in the root bucket together
+                    // with its clean META.
+                    u32 free_b = next, free_s = __builtin_ctz(empty);
+                    u32 free_meta = buckets[free_b].metas[free_s];
+                    u32 from_s = s;
+                    for (u32 n = node; n != UINT32_MAX; n = path[n].parent) {
+                        Bucket& src = buckets[path[n].bucket];
+                        buckets[free_b].ids[free_s] = src.ids[from_s];
+                        buckets[free_b].metas[free_s] = src.metas[from_s];
+                        free_b = path[n].bucket;
+                        free_s = from_s;
+                        from_s = path[n].pslot;
+                    }
+                    buckets[free_b].ids[free_s] = UINT32_MAX;
+                    buckets[free_b].metas[free_s] = free_meta;
+                    root = free_b;
+                    slot = free_s;
+                    return true;
+                }
+
+                if (tail < MAX_PATH_NODES && path[node].depth + 1 < MAX_TURN_NUM
+                    && !onPath(path, node, next)) {
+                    path[tail++] = {next, node, s, path[node].depth + 1};
+                }
+            }
+        }
+
+        return false;
+    }
+
+    template <typename META, typename Key>
+    bool BCuckoo<META, Key>::onPath(const PathNode* path, u32 node,
+                               u32 bucket) const {
+        for (u32 n = node; n != UINT32_MAX; n = path[n].parent) {
+            if (path[n].bucket == bucket) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::save(const string& path, bool compact) const {
+        BinaryWriter out(path, compact);
+        out.putHeader(BCUCKOO, META::MODEL, sizeof(Key));
+        out.put(hashSeed);
+        out.put(ddcAlpha);
+        out.put(rng);
+        out.put<u64>(buckets.size());
+        out.putArray(buckets.data(), buckets.size());
+        out.put(stash_num);
+        out.put(used);
+        out.putArray(stash, STASH_SIZE);
+        save_level(out, blank, metas);
+        save_meta(out, dft);
+        out.close();
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::load(const string& path) {
+        MappedFile file(path);
+        BinaryReader in(file.data(), file.size());
+        in.getHeader(BCUCKOO, META::MODEL, sizeof(Key));
+        u32 seed = in.get<u32>();
+        f64 ddc_alpha = in.get<f64>();
+        xorshift32 rng_tmp = in.get<xorshift32>();
+
+        // Read into temporaries so that a bad file leaves us untouched.
+        u64 num = in.get<u64>();
+        if (num == 0 || num > in.remaining() / sizeof(Bucket)) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        std::vector<Bucket> bucket_tmp(num);
+        in.getArray(bucket_tmp.data(), num);
+        u32 stash_tmp_num = in.get<u32>();
+        u32 used_tmp = in.get<u32>();
+        Slot stash_tmp[STASH_SIZE];
+        in.getArray(stash_tmp, STASH_SIZE);
+        META proto, dft_tmp;
+        std::vector<META> meta_tmp = load_level(in, proto);
+        load_meta(in, dft_tmp);
+
+        u64 meta_num = num * SLOTS + STASH_SIZE;
+        bool ok = in.remaining() == 0 && meta_tmp.size() == meta_num
+               && stash_tmp_num <= STASH_SIZE && used_tmp <= num * SLOTS;
+        for (u64 i = 0; ok && i < num; ++i) {
+            for (u32 j = 0; j < SLOTS; ++j) {
+                ok = ok && bucket_tmp[i].metas[j] < meta_num;
+            }
+        }
+        for (u32 i = 0; ok && i < STASH_SIZE; ++i) {
+            ok = stash_tmp[i].meta < meta_num && (i >= stash_tmp_num
+                                                  || stash_tmp[i].bucket < num);
+        }
+        if (!ok) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        buckets = std::move(bucket_tmp);
+        std::copy(stash_tmp, stash_tmp + STASH_SIZE, stash);
+        stash_num = stash_tmp_num;
+        used = used_tmp;
+        metas = std::move(meta_tmp);
+        blank = proto;
+        dft = std::move(dft_tmp);
+        ddcAlpha = ddc_alpha;
+        rng = rng_tmp;
+        initHash(seed);
+    }
+
+    template <typename META, typename Key>
+    void BCuckoo<META, Key>::initHash(u32 seed) {
+        hashSeed = seed;
+        rand_u32_generator gen(seed, MAX_PRIME32 - 1);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            h[i].initialize(gen(), i);
+        }
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::pos(KeyArg id, u32 word, u32 h_idx) const {
+        if constexpr (KeyTraits<Key>::exact) {
+            UNUSED(word);
+            return h[h_idx].run(id) % buckets.size();
+        } else {
+            u32 first = h[0].run(id) % buckets.size();
+            return h_idx == 0 ? first
+                              : alt_bucket(word, first, buckets.size());
+        }
+    }
+
+    template <typename META, typename Key>
+    u32 BCuckoo<META, Key>::altPos(u32 word, u32 bucket_idx) const {
+        if constexpr (KeyTraits<Key>::exact) {
+            // the word is the key, so both buckets are hashed again
+            u32 tmp = pos(word, word, 0);
+            return tmp != bucket_idx ? tmp : pos(word, word, 1); // Relies on HASH_NUM == 2.
+        } else {
+            return alt_bucket(word, bucket_idx, buckets.size());
+        }
+    }
+}   // namespace sketch
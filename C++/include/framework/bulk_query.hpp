@@ -0,0 +1,41 @@
+#pragma once
+#include <algorithm>
+#include "../common/thread_pool.hpp"
+#include "framework.hpp"
+
+namespace sketch {
+    /// Flows per chunk of a bulk query, enough to hide stealing overhead
+    /// while leaving room to balance heavy flows across workers.
+    constexpr u64 BULK_QUERY_GRAIN = 1024;
+
+    /// @brief Estimate quantile values of many flows in parallel.
+    /// @details Results are columnar, one column per rank: the value of
+    ///          @p ranks[r] for @p ids[i] lands in @p out[r * num + i].
+    ///          Each flow is answered with a single @c quantiles call.
+    ///          Queries only read the sketch, so it must not be appended
+    ///          meanwhile unless it is a concurrent framework or a snapshot.
+    /// @param pool Workers to run on.
+    /// @param sketch Sketch to query.
+    /// @param ids Flow IDs.
+    /// @param num Number of flows.
+    /// @param ranks Normalized ranks, ascending ones are cheapest.
+    /// @param rank_num Number of ranks.
+    /// @param out Results, @p rank_num * @p num of them.
+    /// @param grain Flows per chunk handed to a worker.
+    /// @throw The first exception a query threw, e.g. for a flow the
+    ///        sketch cannot answer; @p out is then partly written.
+    void bulk_quantiles(ThreadPool& pool, const Framework& sketch,
+                        const u32* ids, u64 num, const f64* ranks,
+                        u32 rank_num, u32* out,
+                        u64 grain = BULK_QUERY_GRAIN) {
+        pool.parallelFor(num, grain, [&](u64 begin, u64 end) {
+            vector<u32> res(rank_num);
+            for (u64 i = begin; i < end; ++i) {
+                sketch.quantiles(ids[i], ranks, rank_num, res.data());
+                for (u32 r = 0; r < rank_num; ++r) {
+                    out[r * num + i] = res[r];
+                }
+            }
+        });
+    }
+}   // namespace sketch
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include "../../common/flow_key.hpp"
+#include "../../common/sketch_utils.hpp"
+#include "../../common/seqlock.hpp"
+#include "../framework.hpp"
+#include "shared_meta.hpp"
+
+namespace sketch {
+    /// @brief Cuckoo that several threads may append to and query
+    ///        at the same time.
+    /// @details Flow IDs are atomics and every bucket has a SeqLock. Appends
+    ///          to a resident flow lock its one bucket, and inserts lock both
+    ///          candidate buckets in index order. Kick paths are searched by
+    ///          one thread at a time and applied one move at a time, each
+    ///          move locking the two buckets involved and bumping a global
+    ///          move version, so readers probe both buckets optimistically
+    ///          and retry only if a move raced with them. A reader copies
+    ///          the flow's ID, META index and META under the version of
+    ///          the bucket, and retries if a write ran meanwhile; METAs
+    ///          that reallocate while appending are read under the bucket
+    ///          lock instead, see @c has_fixed_storage. @c dft is a
+    ///          @c SharedMeta, so writers do not meet on its lock for
+    ///          every item.
+    template <typename META>
+    class ConcurrentCuckoo final : public Framework {
+    public:
+        /// @brief Constructor.
+        /// @param mem_limit Memory limit in bytes.
+        /// @param seed Seed for generating hash functions, by default 0.
+        ConcurrentCuckoo(u64 mem_limit, u32 seed = 0, double ddc_alpha = 0.1);
+
+        void append(u32 id, u32 value) override;
+        u32 size(u32 id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        u32 quantile(u32 id, f64 nom_rank) const override;
+        void quantiles(u32 id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(u32 id) const override;
+        vector<u32> flows() const override;
+
+        /// @warning Not thread-safe, callers must stop appending first.
+        void clear() override;
+
+        /// @brief Spill the values staged for @c dft, so that queries of
+        ///        absent flows see every item.
+        /// @warning Only while no thread appends.
+        void flush() { dft.flush(); }
+
+        /// @brief Append a batch of items, locking @c dft once.
+        /// @param items Items to append.
+        /// @param num Number of items.
+        void appendBatch(const FlowItem* items, u32 num);
+
+    private:
+        /// @brief A node in the breadth-first displacement search.
+        struct PathNode {
+            u32 bucket;     ///< Bucket whose occupant is to be kicked.
+            u32 id;         ///< The occupant seen during the search.
+            u32 parent;     ///< Index of the parent node, UINT32_MAX for roots.
+            u32 depth;      ///< Number of kicks from the root, inclusive.
+        };
+
+        static constexpr u32 MAX_TURN_NUM = 8;
+        static constexpr u32 HASH_NUM = 2;
+        static constexpr u32 MAX_PATH_NODES = MAX_TURN_NUM;
+        static constexpr f64 alpha = 0.15;
+        static constexpr u32 cmtor_cap = 8;
+        static constexpr u32 td_cap = 32;
+
+        KeyHash<u32> h[HASH_NUM];
+        vector<std::atomic<u32>> ids;   ///< Flow ID per bucket.
+        vector<u32> slots;              ///< META index per bucket.
+        vector<META> metas;             ///< META pool, one per bucket.
+        mutable vector<SeqLock> locks;  ///< Bucket locks.
+        SeqLock moves;                  ///< Odd while a kick path is applied.
+        std::mutex kick;                ///< Serializes displacement.
+        SharedMeta<META> dft;           ///< Default bucket.
+        META blank;                     ///< Empty bucket META.
+        xorshift32 rng;                 ///< Tie breaker, guarded by @c kick.
+
+        /// @brief Append an item to its bucket, leaving @c dft alone.
+        void appendTable(u32 id, u32 value);
+
+        /// @brief Apply a function to the META of a flow if resident.
+        /// @return Whether the flow is resident.
+        template <typename F>
+        bool withFlow(u32 id, F&& f) const;
+
+        /// @brief Apply a function to the META of a flow, or to @c dft
+        ///        if the flow is absent.
+        template <typename F>
+        auto withMeta(u32 id, F&& f) const;
+
+        /// @brief Under the locks of both candidate buckets, append to
+        ///        the flow if resident or claim an empty bucket for it.
+        /// @return Whether the item was appended.
+        bool appendLocked(u32 id, u32 value, const u32 (&idx)[HASH_NUM]);
+
+        /// @brief Search a kick path from the candidate buckets of a new
+        ///        flow to an empty bucket and apply it.
+        /// @return Whether a candidate bucket may have been emptied.
+        bool displace(const u32 (&idx)[HASH_NUM]);
+
+        /// @brief Move the occupant of one bucket into an empty one.
+        /// @return Whether both buckets were still as the search saw them.
+        bool move(u32 from, u32 to, u32 id);
+
+        /// @brief Check if a bucket already lies on the path ending at a node.
+        bool onPath(const PathNode* path, u32 node, u32 bucket) const;
+
+        void lockPair(u32 a, u32 b) const;
+        void unlockPair(u32 a, u32 b) const;
+
+        u32 pos(u32 id, u32 h_idx) const;
+
+        /// @brief Return the candidate bucket of a flow other than a given one.
+        u32 altPos(u32 id, u32 bucket_idx) const;
+    };
+}   // namespace sketch
+
+#include "concurrent_cuckoo_impl.hpp"
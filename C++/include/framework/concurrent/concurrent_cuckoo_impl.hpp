@@ -0,0 +1,336 @@
+#pragma once
+#include "concurrent_cuckoo.hpp"
+#include <algorithm>
+#include "../framework_utils.hpp"
+
+namespace sketch {
+    template <typename META>
+    ConcurrentCuckoo<META>::ConcurrentCuckoo(u64 mem_limit, u32 seed,
+                                             double ddc_alpha)
+        : dft(createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddc_alpha)), rng(seed) {
+        rand_u32_generator gen(seed, MAX_PRIME32 - 1);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            h[i].initialize(gen(), i);
+        }
+
+        blank = createMeta<META>(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
+        u32 num = mem_limit / (sizeof(u32) + blank.memory());
+        ids = vector<std::atomic<u32>>(num);
+        slots = vector<u32>(num);
+        locks = vector<SeqLock>(num);
+        for (u32 i = 0; i < num; ++i) {
+            ids[i].store(UINT32_MAX, std::memory_order_relaxed);
+            slots[i] = i;
+        }
+        metas = vector<META>(num, blank);
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::append(u32 id, u32 value) {
+        appendTable(id, value);
+        dft.append(value);
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::appendBatch(const FlowItem* items, u32 num) {
+        for (u32 i = 0; i < num; ++i) {
+            appendTable(items[i].id, items[i].value);
+        }
+        dft.appendBatch(items, num);
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::appendTable(u32 id, u32 value) {
+        u32 idx[HASH_NUM];
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            idx[i] = pos(id, i);
+        }
+        if (idx[0] == idx[1]) { // Relies on HASH_NUM == 2.
+            return;
+        }
+
+        // Fast path: the flow is resident, lock just its bucket. A miss
+        // here may be a race with a move; appendLocked settles it.
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            if (ids[idx[i]].load(std::memory_order_acquire) != id) {
+                continue;
+            }
+            locks[idx[i]].lock();
+            bool hit = ids[idx[i]].load(std::memory_order_relaxed) == id;
+            if (hit) {
+                metas[slots[idx[i]]].append(value);
+            }
+            locks[idx[i]].unlock();
+            if (hit) {
+                return;
+            }
+        }
+
+        if (appendLocked(id, value, idx)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(kick);
+        if (displace(idx)) {
+            appendLocked(id, value, idx);
+        }
+    }
+
+    template <typename META>
+    bool ConcurrentCuckoo<META>::appendLocked(u32 id, u32 value,
+                                              const u32 (&idx)[HASH_NUM]) {
+        // A flow only ever moves between its own two buckets, so with
+        // both locked its residency cannot change under us.
+        lockPair(idx[0], idx[1]);
+        u32 target = HASH_NUM;
+        for (u32 i = 0; i < HASH_NUM && target == HASH_NUM; ++i) {
+            if (ids[idx[i]].load(std::memory_order_relaxed) == id) {
+                target = i;
+            }
+        }
+        for (u32 i = 0; i < HASH_NUM && target == HASH_NUM; ++i) {
+            if (ids[idx[i]].load(std::memory_order_relaxed) == UINT32_MAX) {
+                ids[idx[i]].store(id, std::memory_order_release);
+                target = i;
+            }
+        }
+        if (target != HASH_NUM) {
+            metas[slots[idx[target]]].append(value);
+        }
+        unlockPair(idx[0], idx[1]);
+        return target != HASH_NUM;
+    }
+
+    template <typename META>
+    template <typename F>
+    bool ConcurrentCuckoo<META>::withFlow(u32 id, F&& f) const {
+        u32 idx[HASH_NUM];
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            idx[i] = pos(id, i);
+        }
+
+        while (true) {
+            u32 version = moves.readBegin();
+            for (u32 i = 0; i < HASH_NUM; ++i) {
+                u32 b = idx[i];
+                if (ids[b].load(std::memory_order_acquire) != id) {
+                    continue;
+                }
+                if constexpr (has_fixed_storage<META>) {
+                    // The META index moves with the flow under the bucket
+                    // lock, so one version covers the ID, index and META.
+                    thread_local META copy;
+                    bool hit;
+                    u32 bucket_version;
+                    do {
+                        bucket_version = locks[b].readBegin();
+                        hit = ids[b].load(std::memory_order_relaxed) == id;
+                        if (hit) {
+                            copy = metas[slots[b]];
+                        }
+                    } while (locks[b].readRetry(bucket_version));
+                    if (hit) {
+                        f(copy);
+                        return true;
+                    }
+                } else {
+                    locks[b].lock();
+                    bool hit = ids[b].load(std::memory_order_relaxed) == id;
+                    if (hit) {
+                        f(metas[slots[b]]);
+                    }
+                    locks[b].unlock();
+                    if (hit) {
+                        return true;
+                    }
+                }
+            }
+            if (!moves.readRetry(version)) {
+                return false;
+            }
+        }
+    }
+
+    template <typename META>
+    template <typename F>
+    auto ConcurrentCuckoo<META>::withMeta(u32 id, F&& f) const {
+        std::invoke_result_t<F&, const META&> res{};
+        if (!withFlow(id, [&](const META& meta) { res = f(meta); })) {
+            res = dft.read(f);
+        }
+        return res;
+    }
+
+    template <typename META>
+    u32 ConcurrentCuckoo<META>::quantile(u32 id, f64 nom_rank) const {
+        return withMeta(id, [nom_rank](const META& meta) {
+            return meta.quantile(nom_rank);
+        });
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::quantiles(u32 id, const f64* ranks, u32 n,
+                                           u32* out) const {
+        withMeta(id, [ranks, n, out](const META& meta) {
+            meta.quantiles(ranks, n, out);
+            return out;
+        });
+    }
+
+    template <typename META>
+    Histogram ConcurrentCuckoo<META>::histogram(u32 id) const {
+        return withMeta(id, [](const META& meta) {
+            return meta.empty() ? Histogram() : static_cast<Histogram>(meta);
+        });
+    }
+
+    template <typename META>
+    vector<u32> ConcurrentCuckoo<META>::flows() const {
+        // A flow being moved may show up in both of its buckets.
+        vector<u32> res;
+        for (const auto& slot : ids) {
+            u32 id = slot.load(std::memory_order_relaxed);
+            if (id != UINT32_MAX) {
+                res.push_back(id);
+            }
+        }
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+        return res;
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::clear() {
+        for (auto& id : ids) {
+            id.store(UINT32_MAX, std::memory_order_relaxed);
+        }
+        std::fill(metas.begin(), metas.end(), blank);
+        dft.clear();
+    }
+
+    template <typename META>
+    bool ConcurrentCuckoo<META>::displace(const u32 (&idx)[HASH_NUM]) {
+        // Same bounded breadth-first search as Cuckoo, run on a racy view
+        // of the table; every move re-validates what the search saw.
+        PathNode path[MAX_PATH_NODES];
+        u32 head = 0, tail = 0;
+        u32 first = rng() % HASH_NUM;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u32 b = idx[(first + i) % HASH_NUM];
+            u32 occupant = ids[b].load(std::memory_order_acquire);
+            if (occupant == UINT32_MAX) {
+                return true;
+            }
+            path[tail++] = {b, occupant, UINT32_MAX, 1};
+        }
+
+        while (head < tail) {
+            u32 node = head++;
+            u32 next = altPos(path[node].id, path[node].bucket);
+            u32 occupant = ids[next].load(std::memory_order_acquire);
+
+            if (occupant == UINT32_MAX) {
+                bool ok = true;
+                moves.lock();
+                for (u32 n = node; ok && n != UINT32_MAX; n = path[n].parent) {
+                    ok = move(path[n].bucket, next, path[n].id);
+                    next = path[n].bucket;
+                }
+                moves.unlock();
+                return ok;
+            }
+
+            if (tail < MAX_PATH_NODES && path[node].depth < MAX_TURN_NUM
+                && !onPath(path, node, next)) {
+                path[tail++] = {next, occupant, node, path[node].depth + 1};
+            }
+        }
+
+        return false;
+    }
+
+    template <typename META>
+    bool ConcurrentCuckoo<META>::move(u32 from, u32 to, u32 id) {
+        lockPair(from, to);
+        bool ok = ids[from].load(std::memory_order_relaxed) == id
+               && ids[to].load(std::memory_order_relaxed) == UINT32_MAX;
+        if (ok) {
+            // The empty bucket's clean META travels back to the source.
+            std::swap(slots[from], slots[to]);
+            ids[to].store(id, std::memory_order_release);
+            ids[from].store(UINT32_MAX, std::memory_order_release);
+        }
+        unlockPair(from, to);
+        return ok;
+    }
+
+    template <typename META>
+    bool ConcurrentCuckoo<META>::onPath(const PathNode* path, u32 node,
+                                        u32 bucket) const {
+        for (u32 n = node; n != UINT32_MAX; n = path[n].parent) {
+            if (path[n].bucket == bucket) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::lockPair(u32 a, u32 b) const {
+        locks[std::min(a, b)].lock();
+        if (a != b) {
+            locks[std::max(a, b)].lock();
+        }
+    }
+
+    template <typename META>
+    void ConcurrentCuckoo<META>::unlockPair(u32 a, u32 b) const {
+        if (a != b) {
+            locks[std::max(a, b)].unlock();
+        }
+        locks[std::min(a, b)].unlock();
+    }
+
+    template <typename META>
+    u32 ConcurrentCuckoo<META>::size(u32 id) const {
+        u32 res = 0;
+        withFlow(id, [&res](const META& meta) { res = meta.size(); });
+        return res;
+    }
+
+    template <typename META>
+    u64 ConcurrentCuckoo<META>::memory() const {
+        // the budget of the constructor, a flow ID and a META per bucket
+        u64 res = ids.size() * sizeof(u32);
+        for (u32 i = 0; i < ids.size(); ++i) {
+            locks[i].lock();
+            res += metas[slots[i]].memory();
+            locks[i].unlock();
+        }
+        return res;
+    }
+
+    template <typename META>
+    u64 ConcurrentCuckoo<META>::heapBytes() const {
+        u64 res = sizeof(*this) + heap_bytes(ids) + heap_bytes(slots)
+                  + heap_bytes(locks) + metas.capacity() * sizeof(META)
+                  + blank.heapBytes() + dft.heapBytes();
+        for (u32 i = 0; i < ids.size(); ++i) {
+            locks[i].lock();
+            res += metas[slots[i]].heapBytes();
+            locks[i].unlock();
+        }
+        return res;
+    }
+
+    template <typename META>
+    u32 ConcurrentCuckoo<META>::pos(u32 id, u32 h_idx) const {
+        return h[h_idx].run(id) % ids.size();
+    }
+
+    template <typename META>
+    u32 ConcurrentCuckoo<META>::altPos(u32 id, u32 bucket_idx) const {
+        u32 tmp = pos(id, 0);
+        return tmp != bucket_idx ? tmp : pos(id, 1); // Relies on HASH_NUM == 2.
+    }
+}   // namespace sketch
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include "../../common/flow_key.hpp"
+#include "../../common/sketch_utils.hpp"
+#include "../../common/seqlock.hpp"
+#include "../framework.hpp"
+#include "shared_meta.hpp"
+
+namespace sketch {
+    /// @brief DLeftSketch that several threads may append to and query
+    ///        at the same time.
+    /// @details Flow IDs are atomics probed without locking. Every bucket
+    ///          has a SeqLock held only while its META is touched: appends
+    ///          to a resident flow lock its one bucket, while inserts and
+    ///          evictions lock all candidate buckets of the flow in table
+    ///          order, so a flow can never become resident twice. Queries
+    ///          read optimistically: they copy the flow's ID and META,
+    ///          and retry if the bucket's version moved meanwhile. METAs
+    ///          that reallocate while appending cannot be copied racily,
+    ///          and are read under the bucket lock instead, see
+    ///          @c has_fixed_storage. @c dft is a @c SharedMeta, so
+    ///          writers do not meet on its lock for every item.
+    template <typename META>
+    class ConcurrentDLeftSketch final : public Framework {
+    public:
+        /// @brief Constructor.
+        /// @param mem_limit Memory limit in bytes.
+        /// @param seed Seed for generating hash functions, by default 0.
+        ConcurrentDLeftSketch(u64 mem_limit, u32 seed = 0,
+                              double ddc_alpha = 0.1);
+
+        void append(u32 id, u32 value) override;
+        u32 size(u32 id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        u32 quantile(u32 id, f64 nom_rank) const override;
+        void quantiles(u32 id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(u32 id) const override;
+        vector<u32> flows() const override;
+
+        /// @warning Not thread-safe, callers must stop appending first.
+        void clear() override;
+
+        /// @brief Spill the values staged for @c dft, so that queries of
+        ///        absent flows see every item.
+        /// @warning Only while no thread appends.
+        void flush() { dft.flush(); }
+
+        /// @brief Append a batch of items, locking @c dft once.
+        /// @param items Items to append.
+        /// @param num Number of items.
+        void appendBatch(const FlowItem* items, u32 num);
+
+    private:
+        static constexpr f64 alpha = 0.3;
+        static constexpr u32 cmtor_cap = 4;
+        static constexpr u32 td_cap = 16;
+
+        static constexpr u32 HASH_NUM = 3;
+
+        vector<META> buckets[HASH_NUM];                 ///< Buckets.
+        vector<std::atomic<u32>> ids[HASH_NUM];         ///< Flow IDs.
+        mutable vector<SeqLock> locks[HASH_NUM];        ///< Bucket locks.
+        META blank;                                     ///< Empty bucket META.
+        SharedMeta<META> dft;                           ///< Default bucket.
+        KeyHash<u32> hash[HASH_NUM];                    ///< Hash functions.
+
+        /// @brief Return the bucket position of a given item.
+        u32 pos(u32 bucket_id, u32 id) const;
+
+        /// @brief Append an item to its bucket, leaving @c dft alone.
+        void appendTable(u32 id, u32 value);
+
+        /// @brief Apply a function to the META of a flow if resident.
+        /// @return Whether the flow is resident.
+        template <typename F>
+        bool withFlow(u32 id, F&& f) const;
+
+        /// @brief Apply a function to the META of a flow, or to @c dft
+        ///        if the flow is absent.
+        template <typename F>
+        auto withMeta(u32 id, F&& f) const;
+    };
+}   // namespace sketch
+
+#include "concurrent_dleft_impl.hpp"
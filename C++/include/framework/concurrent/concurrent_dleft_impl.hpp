@@ -0,0 +1,235 @@
+#pragma once
+#include "concurrent_dleft.hpp"
+#include <thread>
+#include <functional>
+#include "../framework_utils.hpp"
+
+namespace sketch {
+    template <typename META>
+    ConcurrentDLeftSketch<META>::ConcurrentDLeftSketch(u64 mem_limit, u32 seed,
+                                                       double ddc_alpha)
+        : dft(createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddc_alpha)) {
+        blank = createMeta<META>(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
+        u32 bucket_num = mem_limit / (blank.memory() + sizeof(u32)) / HASH_NUM;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            buckets[i] = vector<META>(bucket_num, blank);
+            ids[i] = vector<std::atomic<u32>>(bucket_num);
+            locks[i] = vector<SeqLock>(bucket_num);
+            for (auto& id : ids[i]) {
+                id.store(UINT32_MAX, std::memory_order_relaxed);
+            }
+            hash[i].initialize(seed + i, i);
+        }
+
+    }
+
+    template <typename META>
+    void ConcurrentDLeftSketch<META>::append(u32 id, u32 value) {
+        appendTable(id, value);
+        dft.append(value);
+    }
+
+    template <typename META>
+    void ConcurrentDLeftSketch<META>::appendBatch(const FlowItem* items,
+                                                  u32 num) {
+        for (u32 i = 0; i < num; ++i) {
+            appendTable(items[i].id, items[i].value);
+        }
+        dft.appendBatch(items, num);
+    }
+
+    template <typename META>
+    void ConcurrentDLeftSketch<META>::appendTable(u32 id, u32 value) {
+        u32 tmp[HASH_NUM];
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            tmp[i] = pos(i, id);
+        }
+
+        // Fast path: the flow is resident, lock just its bucket.
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            if (ids[i][tmp[i]].load(std::memory_order_acquire) != id) {
+                continue;
+            }
+            locks[i][tmp[i]].lock();
+            bool hit = ids[i][tmp[i]].load(std::memory_order_relaxed) == id;
+            if (hit) {
+                buckets[i][tmp[i]].append(value);
+            }
+            locks[i][tmp[i]].unlock();
+            if (hit) {
+                return;
+            }
+            break;
+        }
+
+        // Slow path: lock every candidate bucket in table order.
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            locks[i][tmp[i]].lock();
+        }
+
+        u32 target = HASH_NUM;
+        for (u32 i = 0; i < HASH_NUM && target == HASH_NUM; ++i) {
+            if (ids[i][tmp[i]].load(std::memory_order_relaxed) == id) {
+                target = i;
+            }
+        }
+        for (u32 i = 0; i < HASH_NUM && target == HASH_NUM; ++i) {
+            if (ids[i][tmp[i]].load(std::memory_order_relaxed) == UINT32_MAX) {
+                ids[i][tmp[i]].store(id, std::memory_order_release);
+                target = i;
+            }
+        }
+        if (target == HASH_NUM) {
+            thread_local xorshift32 gen(
+                std::hash<std::thread::id>()(std::this_thread::get_id()));
+            target = gen() % HASH_NUM;
+            buckets[target][tmp[target]] = blank;
+            ids[target][tmp[target]].store(id, std::memory_order_release);
+        }
+        buckets[target][tmp[target]].append(value);
+
+        for (u32 i = HASH_NUM; i-- > 0; ) {
+            locks[i][tmp[i]].unlock();
+        }
+    }
+
+    template <typename META>
+    template <typename F>
+    bool ConcurrentDLeftSketch<META>::withFlow(u32 id, F&& f) const {
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u32 tmp = pos(i, id);
+            if (ids[i][tmp].load(std::memory_order_acquire) != id) {
+                continue;
+            }
+            if constexpr (has_fixed_storage<META>) {
+                // The copy is torn if a write ran meanwhile, and is then
+                // taken again.
+                thread_local META copy;
+                bool hit;
+                u32 version;
+                do {
+                    version = locks[i][tmp].readBegin();
+                    hit = ids[i][tmp].load(std::memory_order_relaxed) == id;
+                    if (hit) {
+                        copy = buckets[i][tmp];
+                    }
+                } while (locks[i][tmp].readRetry(version));
+                if (hit) {
+                    f(copy);
+                    return true;
+                }
+            } else {
+                locks[i][tmp].lock();
+                bool hit = ids[i][tmp].load(std::memory_order_relaxed) == id;
+                if (hit) {
+                    f(buckets[i][tmp]);
+                }
+                locks[i][tmp].unlock();
+                if (hit) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <typename META>
+    template <typename F>
+    auto ConcurrentDLeftSketch<META>::withMeta(u32 id, F&& f) const {
+        std::invoke_result_t<F&, const META&> res{};
+        if (!withFlow(id, [&](const META& meta) { res = f(meta); })) {
+            res = dft.read(f);
+        }
+        return res;
+    }
+
+    template <typename META>
+    u32 ConcurrentDLeftSketch<META>::quantile(u32 id, f64 nom_rank) const {
+        return withMeta(id, [nom_rank](const META& meta) {
+            return meta.quantile(nom_rank);
+        });
+    }
+
+    template <typename META>
+    void ConcurrentDLeftSketch<META>::quantiles(u32 id, const f64* ranks, u32 n,
+                                                u32* out) const {
+        withMeta(id, [ranks, n, out](const META& meta) {
+            meta.quantiles(ranks, n, out);
+            return out;
+        });
+    }
+
+    template <typename META>
+    Histogram ConcurrentDLeftSketch<META>::histogram(u32 id) const {
+        return withMeta(id, [](const META& meta) {
+            return meta.empty() ? Histogram() : static_cast<Histogram>(meta);
+        });
+    }
+
+    template <typename META>
+    vector<u32> ConcurrentDLeftSketch<META>::flows() const {
+        vector<u32> res;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            for (const auto& slot : ids[i]) {
+                u32 id = slot.load(std::memory_order_relaxed);
+                if (id != UINT32_MAX) {
+                    res.push_back(id);
+                }
+            }
+        }
+        return res;
+    }
+
+    template <typename META>
+    void ConcurrentDLeftSketch<META>::clear() {
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            std::fill(buckets[i].begin(), buckets[i].end(), blank);
+            for (auto& id : ids[i]) {
+                id.store(UINT32_MAX, std::memory_order_relaxed);
+            }
+        }
+        dft.clear();
+    }
+
+    template <typename META>
+    u32 ConcurrentDLeftSketch<META>::pos(u32 bucket_id, u32 id) const {
+        return hash[bucket_id].run(id) % buckets[bucket_id].size();
+    }
+
+    template <typename META>
+    u64 ConcurrentDLeftSketch<META>::memory() const {
+        // the budget of the constructor, a flow ID and a META per bucket
+        u64 res = 0;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            res += ids[i].size() * sizeof(u32);
+            for (u32 j = 0; j < buckets[i].size(); ++j) {
+                locks[i][j].lock();
+                res += buckets[i][j].memory();
+                locks[i][j].unlock();
+            }
+        }
+        return res;
+    }
+
+    template <typename META>
+    u64 ConcurrentDLeftSketch<META>::heapBytes() const {
+        u64 res = sizeof(*this) + blank.heapBytes() + dft.heapBytes();
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            res += buckets[i].capacity() * sizeof(META) + heap_bytes(ids[i])
+                   + heap_bytes(locks[i]);
+            for (u32 j = 0; j < buckets[i].size(); ++j) {
+                locks[i][j].lock();
+                res += buckets[i][j].heapBytes();
+                locks[i][j].unlock();
+            }
+        }
+        return res;
+    }
+
+    template <typename META>
+    u32 ConcurrentDLeftSketch<META>::size(u32 id) const {
+        u32 res = 0;
+        withFlow(id, [&res](const META& meta) { res = meta.size(); });
+        return res;
+    }
+}   // namespace sketch
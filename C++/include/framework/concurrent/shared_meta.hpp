@@ -0,0 +1,68 @@
+#pragma once
+#include <memory>
+#include "../../common/seqlock.hpp"
+#include "../../common/sketch_defs.hpp"
+
+namespace sketch {
+    /// @brief META that many threads append to, such as the default
+    ///        bucket of a concurrent framework, which sees every item.
+    /// @details Each thread stages its values in a buffer of its own and
+    ///          takes the lock of the META only to spill a full buffer, so
+    ///          writers meet on the lock once per @c STAGE_SIZE items
+    ///          rather than on every item. Reads see the values spilled so
+    ///          far, lagging by at most @c STAGE_SIZE values per thread.
+    template <typename META>
+    class SharedMeta {
+    public:
+        /// @brief Constructor.
+        /// @param blank_ Empty META, also restored by @c clear.
+        explicit SharedMeta(const META& blank_ = META());
+
+        /// @brief Append a value.
+        void append(u32 value);
+
+        /// @brief Append the values of a batch of items, locking once.
+        void appendBatch(const FlowItem* items, u32 num);
+
+        /// @brief Spill every staged value.
+        /// @warning Only while no thread appends.
+        void flush();
+
+        /// @brief Apply a function to the META, to an optimistic copy for
+        ///        METAs of fixed storage and under the lock otherwise.
+        template <typename F>
+        auto read(F&& f) const;
+
+        /// @brief Return the heap bytes of the META and the stages.
+        u64 heapBytes() const;
+
+        /// @brief Become empty.
+        /// @warning Not thread-safe.
+        void clear();
+
+    private:
+        static constexpr u32 STAGES = 16;       ///< Threads share them modulo.
+        static constexpr u32 STAGE_SIZE = 62;   ///< Values per stage.
+
+        /// @brief Values staged by the threads mapped to it, on its own
+        ///        cache lines.
+        struct alignas(64) Stage {
+            SeqLock lock;
+            u32 num = 0;
+            u32 values[STAGE_SIZE];
+        };
+
+        META meta;
+        META blank;                         ///< Empty @c meta.
+        mutable SeqLock lock;               ///< Lock of @c meta.
+        std::unique_ptr<Stage[]> stages;
+
+        /// @brief Append values to @c meta under its lock.
+        void spill(const u32* values, u32 num);
+
+        /// @brief Return a small index, fixed per thread.
+        static u32 threadIndex();
+    };
+}   // namespace sketch
+
+#include "shared_meta_impl.hpp"
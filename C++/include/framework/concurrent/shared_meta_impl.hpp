@@ -0,0 +1,90 @@
+#pragma once
+#include "shared_meta.hpp"
+#include <atomic>
+#include "../framework_utils.hpp"
+
+namespace sketch {
+    template <typename META>
+    SharedMeta<META>::SharedMeta(const META& blank_)
+        : meta(blank_), blank(blank_), stages(new Stage[STAGES]) { }
+
+    template <typename META>
+    void SharedMeta<META>::append(u32 value) {
+        Stage& stage = stages[threadIndex() % STAGES];
+        stage.lock.lock();
+        stage.values[stage.num++] = value;
+        if (stage.num == STAGE_SIZE) {
+            spill(stage.values, STAGE_SIZE);
+            stage.num = 0;
+        }
+        stage.lock.unlock();
+    }
+
+    template <typename META>
+    void SharedMeta<META>::appendBatch(const FlowItem* items, u32 num) {
+        lock.lock();
+        for (u32 i = 0; i < num; ++i) {
+            meta.append(items[i].value);
+        }
+        lock.unlock();
+    }
+
+    template <typename META>
+    void SharedMeta<META>::flush() {
+        for (u32 i = 0; i < STAGES; ++i) {
+            spill(stages[i].values, stages[i].num);
+            stages[i].num = 0;
+        }
+    }
+
+    template <typename META>
+    void SharedMeta<META>::spill(const u32* values, u32 num) {
+        lock.lock();
+        for (u32 i = 0; i < num; ++i) {
+            meta.append(values[i]);
+        }
+        lock.unlock();
+    }
+
+    template <typename META>
+    template <typename F>
+    auto SharedMeta<META>::read(F&& f) const {
+        if constexpr (has_fixed_storage<META>) {
+            thread_local META copy;
+            u32 version;
+            do {
+                version = lock.readBegin();
+                copy = meta;
+            } while (lock.readRetry(version));
+            return f(copy);
+        } else {
+            lock.lock();
+            auto res = f(meta);
+            lock.unlock();
+            return res;
+        }
+    }
+
+    template <typename META>
+    u64 SharedMeta<META>::heapBytes() const {
+        lock.lock();
+        u64 res = meta.heapBytes();
+        lock.unlock();
+        return res + blank.heapBytes() + STAGES * sizeof(Stage);
+    }
+
+    template <typename META>
+    void SharedMeta<META>::clear() {
+        meta = blank;
+        for (u32 i = 0; i < STAGES; ++i) {
+            stages[i].num = 0;
+        }
+    }
+
+    template <typename META>
+    u32 SharedMeta<META>::threadIndex() {
+        static std::atomic<u32> next{0};
+        thread_local u32 index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+}   // namespace sketch
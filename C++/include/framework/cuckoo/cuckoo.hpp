@@ -1,45 +1,102 @@
 #pragma once
-#include "../../common/BOBHash32.h"
+#include "../../common/flow_key.hpp"
 #include "../../common/sketch_defs.hpp"
+#include "../../common/sketch_utils.hpp"
 #include "../framework.hpp"
 
 namespace sketch {
-    template <typename META>
-    class Cuckoo : public Framework {
+    /// @tparam Key Flow key, kept in the buckets as its
+    ///             @c KeyTraits::word. Wider keys find their second
+    ///             bucket from the word, see @c alt_bucket, so that kicked
+    ///             flows can move without their keys.
+    template <typename META, typename Key = u32>
+    class Cuckoo final : public BasicFramework<Key> {
+        using KeyArg = typename BasicFramework<Key>::KeyArg;
+
     public:
         /// @brief Constructor.
         /// @param mem_limit Memory limit in bytes.
         /// @param seed Seed for generating hash functions, by default 0.
         Cuckoo(u64 mem_limit, u32 seed = 0, double ddc_alpha = 0.1);
 
-        void append(u32 id, u32 value) override;
-        u32 size(u32 id) const override;
-        u32 memory() const override;
-        u32 quantile(u32 id, f64 nom_rank) const override;
+        void append(KeyArg id, u32 value) override;
+        u32 size(KeyArg id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        HugePages::Backing backing() const override;
+        u32 quantile(KeyArg id, f64 nom_rank) const override;
+        void quantiles(KeyArg id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(KeyArg id) const override;
+        bool has(KeyArg id) const override;
+        vector<Key> flows() const override;
+        void clear() override;
+        void save(const string& path, bool compact = false) const override;
+        void load(const string& path) override;
 
     private:
-        class Cell {
-        public:
-            u32 id;
-            META meta;
-            u32 memory() const {
-                return sizeof(id) + meta.memory();
-            }
+        /// @brief A bucket of the table.
+        /// @details The META of a flow lives in @c metas and never moves;
+        ///          a bucket only refers to it by index, so kicking a flow
+        ///          out of its bucket copies eight bytes instead of a
+        ///          heap-owning sketch.
+        struct Slot {
+            u32 id;     ///< Word of the flow key, UINT32_MAX if empty.
+            u32 meta;   ///< Index of the flow's META in @c metas.
+        };
+
+        /// @brief A node in the breadth-first displacement search.
+        struct PathNode {
+            u32 bucket;     ///< Bucket whose occupant is to be kicked.
+            u32 parent;     ///< Index of the parent node, UINT32_MAX for roots.
+            u32 depth;      ///< Number of kicks from the root, inclusive.
         };
 
         static constexpr u32 MAX_TURN_NUM = 8;
         static constexpr u32 HASH_NUM = 2;
+        static constexpr u32 MAX_PATH_NODES = MAX_TURN_NUM;
         static constexpr f64 alpha = 0.15;
         static constexpr u32 cmtor_cap = 8;
         static constexpr u32 td_cap = 32;
         static constexpr u32 ddc_size = 68;
 
-        BOBHash32 h[HASH_NUM];
-        std::vector<Cell> buckets;
+        /// Hash functions, only the first for keys wider than 32 bits.
+        KeyHash<Key> h[HASH_NUM];
+        u32 hashSeed;                   ///< Seed of @c h.
+        huge_vector<Slot> slots;    ///< Buckets.
+        huge_vector<META> metas;    ///< META pool, one per bucket.
+        std::shared_ptr<HugeRegion> region; ///< Backing of the arrays.
         META dft;
+        META blank;                 ///< Empty bucket META.
+        double ddcAlpha;
+        xorshift32 rng;             ///< Tie breaker for the displacement search.
+
+        /// @brief Make room in one of the candidate buckets of a new flow
+        ///        by moving occupants along the shortest kick path.
+        /// @param idx Candidate buckets of the new flow, all occupied.
+        /// @param root Set to the bucket freed for the new flow on success.
+        /// @return Whether a path of at most @c MAX_TURN_NUM kicks exists.
+        bool displace(const u32 (&idx)[HASH_NUM], u32& root);
+
+        /// @brief Check if a bucket already lies on the path ending at a node.
+        bool onPath(const PathNode* path, u32 node, u32 bucket) const;
+
+        /// @brief Generate hash functions from a given seed.
+        void initHash(u32 seed);
+
+        /// @brief Return a region for the arrays of a given number of
+        ///        buckets, see @c make_huge_region.
+        static std::shared_ptr<HugeRegion> makeRegion(u64 num);
+
+        /// @brief Return a candidate bucket of a flow.
+        /// @param id Flow key.
+        /// @param word Word of @p id.
+        /// @param h_idx Index of the candidate.
+        u32 pos(KeyArg id, u32 word, u32 h_idx) const;
 
-        bool preempt(u32 id, u32 bucket_idx, u32 turns_left);
-        u32 pos(u32 id, u32 h_idx) const;
+        /// @brief Return the candidate bucket of a flow other than a given
+        ///        one, from the word kept in the bucket.
+        u32 altPos(u32 word, u32 bucket_idx) const;
     };
 }
 
@@ -4,113 +4,311 @@
 #include "../../common/sketch_utils.hpp"
 
 namespace sketch {
-    template <typename META>
-    Cuckoo<META>::Cuckoo(u64 mem_limit, u32 seed, double ddc_alpha) {
-        rand_u32_generator gen(seed, MAX_PRIME32 - 1);
-        for (u32 i = 0; i < HASH_NUM; ++i) {
-            h[i].initialize(gen());
-        }
+    template <typename META, typename Key>
+    Cuckoo<META, Key>::Cuckoo(u64 mem_limit, u32 seed, double ddc_alpha)
+        : ddcAlpha(ddc_alpha), rng(seed) {
+        initHash(seed);
 
-        META meta = createMeta(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
-        Cell cell{UINT32_MAX, meta};
-        u32 num = mem_limit / cell.memory();
-        buckets = std::vector<Cell>(num, cell);
-        dft = createMeta(UINT32_MAX, 0.5, 2, 4, ddc_alpha);
+        blank = createMeta<META>(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
+        u32 num = mem_limit / (sizeof(u32) + blank.memory());
+        region = makeRegion(num);
+        slots = huge_vector<Slot>(HugePageAllocator<Slot>(region));
+        slots.reserve(num);
+        for (u32 i = 0; i < num; ++i) {
+            slots.push_back({UINT32_MAX, i});
+        }
+        metas = huge_vector<META>(num, blank, HugePageAllocator<META>(region));
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddc_alpha);
     }
 
-    template <typename META>
-    void Cuckoo<META>::append(u32 id, u32 value) {
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::append(KeyArg id, u32 value) {
         dft.append(value);
 
+        u32 word = KeyTraits<Key>::word(id);
         u32 idx[HASH_NUM];
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            idx[i] = pos(id, i);
+            idx[i] = pos(id, word, i);
         }
         if (idx[0] == idx[1]) { // Relies on HASH_NUM == 2.
             return;
         }
 
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            u32 bucket_id = buckets[idx[i]].id;
-            if (bucket_id == id) {
-                buckets[idx[i]].meta.append(value);
+            const Slot& slot = slots[idx[i]];
+            if (slot.id == word) {
+                metas[slot.meta].append(value);
                 return;
             }
         }
 
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            u32& bucket_id = buckets[idx[i]].id;
-            if (bucket_id == UINT32_MAX) {
-                buckets[idx[i]].meta.append(value);
-                bucket_id = id;
+            Slot& slot = slots[idx[i]];
+            if (slot.id == UINT32_MAX) {
+                metas[slot.meta].append(value);
+                slot.id = word;
                 return;
             }
         }
 
-        rand_u32_generator gen(0, HASH_NUM - 1);
-        u32 bucket_idx = idx[gen()];
-        if (preempt(id, bucket_idx, MAX_TURN_NUM)) {
-            buckets[bucket_idx].meta.append(value);
-            buckets[bucket_idx].id = id;
+        u32 root;
+        if (displace(idx, root)) {
+            metas[slots[root].meta].append(value);
+            slots[root].id = word;
         }
     }
 
-    template <typename META>
-    u32 Cuckoo<META>::size(u32 id) const {
-        // This function will not be called.
-        assert(false);
+    template <typename META, typename Key>
+    u32 Cuckoo<META, Key>::size(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            const Slot& slot = slots[pos(id, word, i)];
+            if (slot.id == word) {
+                return metas[slot.meta].size();
+            }
+        }
+
         return 0;
     }
 
-    template <typename META>
-    u32 Cuckoo<META>::memory() const {
-        // This function will not be called.
-        assert(false);
-        return 0;
+    template <typename META, typename Key>
+    u64 Cuckoo<META, Key>::memory() const {
+        // the budget of the constructor, a flow ID and a META per bucket
+        u64 res = slots.size() * sizeof(u32);
+        for (const META& meta : metas) {
+            res += meta.memory();
+        }
+        return res;
+    }
+
+    template <typename META, typename Key>
+    u64 Cuckoo<META, Key>::heapBytes() const {
+        return sizeof(*this) + heap_bytes(slots) + heap_bytes(metas)
+               + dft.heapBytes() + blank.heapBytes();
     }
 
-    template <typename META>
-    u32 Cuckoo<META>::quantile(u32 id, f64 nom_rank) const {
+    template <typename META, typename Key>
+    HugePages::Backing Cuckoo<META, Key>::backing() const {
+        return region ? region->backing() : HugePages::NORMAL;
+    }
+
+    template <typename META, typename Key>
+    u32 Cuckoo<META, Key>::quantile(KeyArg id, f64 nom_rank) const {
+        u32 word = KeyTraits<Key>::word(id);
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            u32 tmp = pos(id, i);
-            if (buckets[tmp].id == id) {
-                return buckets[tmp].meta.quantile(nom_rank);
+            const Slot& slot = slots[pos(id, word, i)];
+            if (slot.id == word) {
+                return metas[slot.meta].quantile(nom_rank);
             }
         }
 
         return dft.quantile(nom_rank);
     }
 
-    template <typename META>
-    bool Cuckoo<META>::preempt(u32 id, u32 bucket_idx, u32 turns_left) {
-        if (turns_left == 0) {
-            return false;
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::quantiles(KeyArg id, const f64* ranks, u32 n,
+                                      u32* out) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            const Slot& slot = slots[pos(id, word, i)];
+            if (slot.id == word) {
+                metas[slot.meta].quantiles(ranks, n, out);
+                return;
+            }
         }
 
-        u32 kick_id = buckets[bucket_idx].id;
-        u32 another_bucket_idx = 0;
+        dft.quantiles(ranks, n, out);
+    }
+
+    template <typename META, typename Key>
+    Histogram Cuckoo<META, Key>::histogram(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            u32 tmp = pos(kick_id, i);
-            if (tmp != bucket_idx) { // Relies on HASH_NUM == 2.
-                assert(buckets[tmp].id != kick_id);
-                another_bucket_idx = tmp;
-                break;
+            const Slot& slot = slots[pos(id, word, i)];
+            if (slot.id == word) {
+                return static_cast<Histogram>(metas[slot.meta]);
             }
         }
 
+        return dft.empty() ? Histogram() : static_cast<Histogram>(dft);
+    }
 
-        bool success = buckets[another_bucket_idx].id == UINT32_MAX
-            || preempt(kick_id, another_bucket_idx, turns_left - 1);
+    template <typename META, typename Key>
+    bool Cuckoo<META, Key>::has(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            if (slots[pos(id, word, i)].id == word) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        if (success) {
-            std::swap(buckets[bucket_idx], buckets[another_bucket_idx]);
+    template <typename META, typename Key>
+    vector<Key> Cuckoo<META, Key>::flows() const {
+        if constexpr (!KeyTraits<Key>::exact) {
+            return BasicFramework<Key>::flows();
+        } else {
+            vector<Key> res;
+            for (const Slot& slot : slots) {
+                if (slot.id != KeyTraits<Key>::EMPTY) {
+                    res.push_back(KeyTraits<Key>::key(slot.id));
+                }
+            }
+            return res;
         }
+    }
 
-        return success;
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::clear() {
+        for (auto& slot : slots) {
+            slot.id = UINT32_MAX;
+        }
+        std::fill(metas.begin(), metas.end(), blank);
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddcAlpha);
     }
 
-    template <typename META>
-    u32 Cuckoo<META>::pos(u32 id, u32 h_idx) const {
-        return h[h_idx].run(id) % buckets.size();
+    template <typename META, typename Key>
+    bool Cuckoo<META, Key>::displace(const u32 (&idx)[HASH_NUM], u32& root) {
+        // Breadth-first search over kick paths rooted at every candidate
+        // bucket, so the shortest path wins and no META is touched until
+        // one is found. The queue lives on the stack, and the total number
+        // of examined kicks is bounded by MAX_TURN_NUM as before, so an
+        // overloaded table pays no more per failed insertion than it used to.
+        PathNode path[MAX_PATH_NODES];
+        u32 head = 0, tail = 0;
+        u32 first = rng() % HASH_NUM;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            path[tail++] = {idx[(first + i) % HASH_NUM], UINT32_MAX, 1};
+        }
+
+        while (head < tail) {
+            u32 node = head++;
+            u32 next = altPos(slots[path[node].bucket].id, path[node].bucket);
+
+            if (slots[next].id == UINT32_MAX) {
+                // Shift every occupant on the path one step towards the
+                // empty bucket, then hand its clean META to the root.
+                Slot empty = slots[next];
+                for (u32 n = node; n != UINT32_MAX; n = path[n].parent) {
+                    slots[next] = slots[path[n].bucket];
+                    next = path[n].bucket;
+                }
+                slots[next] = empty;
+                root = next;
+                return true;
+            }
+
+            if (tail < MAX_PATH_NODES && path[node].depth < MAX_TURN_NUM
+                && !onPath(path, node, next)) {
+                path[tail++] = {next, node, path[node].depth + 1};
+            }
+        }
+
+        return false;
+    }
+
+    template <typename META, typename Key>
+    bool Cuckoo<META, Key>::onPath(const PathNode* path, u32 node,
+                              u32 bucket) const {
+        for (u32 n = node; n != UINT32_MAX; n = path[n].parent) {
+            if (path[n].bucket == bucket) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::save(const string& path, bool compact) const {
+        BinaryWriter out(path, compact);
+        out.putHeader(CUCKOO, META::MODEL, sizeof(Key));
+        out.put(hashSeed);
+        out.put(ddcAlpha);
+        out.put(rng);
+        out.put<u64>(slots.size());
+        out.putArray(slots.data(), slots.size());
+        save_level(out, blank, metas);
+        save_meta(out, dft);
+        out.close();
+    }
+
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::load(const string& path) {
+        MappedFile file(path);
+        BinaryReader in(file.data(), file.size());
+        in.getHeader(CUCKOO, META::MODEL, sizeof(Key));
+        u32 seed = in.get<u32>();
+        f64 ddc_alpha = in.get<f64>();
+        xorshift32 rng_tmp = in.get<xorshift32>();
+
+        // Read into temporaries so that a bad file leaves us untouched.
+        u64 num = in.get<u64>();
+        if (num > in.remaining() / sizeof(Slot)) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        auto region_tmp = makeRegion(num);
+        huge_vector<Slot> slot_tmp(num, Slot(),
+                                   HugePageAllocator<Slot>(region_tmp));
+        in.getArray(slot_tmp.data(), num);
+        META proto, dft_tmp;
+        huge_vector<META> meta_tmp = load_level<META, huge_vector<META>>(
+            in, proto, HugePageAllocator<META>(region_tmp));
+        load_meta(in, dft_tmp);
+        if (in.remaining() != 0 || meta_tmp.size() != num) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        for (const Slot& slot : slot_tmp) {
+            if (slot.meta >= num) {
+                throw std::runtime_error("corrupt sketch file");
+            }
+        }
+
+        slots = std::move(slot_tmp);
+        metas = std::move(meta_tmp);
+        region = std::move(region_tmp);
+        blank = proto;
+        dft = std::move(dft_tmp);
+        ddcAlpha = ddc_alpha;
+        rng = rng_tmp;
+        initHash(seed);
+    }
+
+    template <typename META, typename Key>
+    std::shared_ptr<HugeRegion> Cuckoo<META, Key>::makeRegion(u64 num) {
+        // one cache line of alignment slack per array
+        return make_huge_region(num * (sizeof(Slot) + sizeof(META)) + 128);
+    }
+
+    template <typename META, typename Key>
+    void Cuckoo<META, Key>::initHash(u32 seed) {
+        hashSeed = seed;
+        rand_u32_generator gen(seed, MAX_PRIME32 - 1);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            h[i].initialize(gen(), i);
+        }
+    }
+
+    template <typename META, typename Key>
+    u32 Cuckoo<META, Key>::pos(KeyArg id, u32 word, u32 h_idx) const {
+        if constexpr (KeyTraits<Key>::exact) {
+            UNUSED(word);
+            return h[h_idx].run(id) % slots.size();
+        } else {
+            u32 first = h[0].run(id) % slots.size();
+            return h_idx == 0 ? first
+                              : alt_bucket(word, first, slots.size());
+        }
+    }
+
+    template <typename META, typename Key>
+    u32 Cuckoo<META, Key>::altPos(u32 word, u32 bucket_idx) const {
+        if constexpr (KeyTraits<Key>::exact) {
+            // the word is the key, so both buckets are hashed again
+            u32 tmp = pos(word, word, 0);
+            return tmp != bucket_idx ? tmp : pos(word, word, 1); // Relies on HASH_NUM == 2.
+        } else {
+            return alt_bucket(word, bucket_idx, slots.size());
+        }
     }
 }
@@ -1,21 +1,35 @@
 #pragma once
-#include "../../common/BOBHash32.h"
+#include "../../common/flow_key.hpp"
 #include "../../common/sketch_utils.hpp"
 #include "../framework.hpp"
 
 namespace sketch {
-    template <typename META>
-    class DLeftSketch : public Framework {
+    /// @tparam Key Flow key, kept in the buckets as its
+    ///             @c KeyTraits::word.
+    template <typename META, typename Key = u32>
+    class DLeftSketch final : public BasicFramework<Key> {
+        using KeyArg = typename BasicFramework<Key>::KeyArg;
+
     public:
         /// @brief Constructor.
         /// @param mem_limit Memory limit in bytes.
         /// @param seed Seed for generating hash functions, by default 0.
         DLeftSketch(u64 mem_limit, u32 seed = 0, double ddc_alpha = 0.1);
 
-        void append(u32 id, u32 value) override;
-        u32 size(u32 id) const override;
-        u32 memory() const override;
-        u32 quantile(u32 id, f64 nom_rank) const override;
+        void append(KeyArg id, u32 value) override;
+        u32 size(KeyArg id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        HugePages::Backing backing() const override;
+        u32 quantile(KeyArg id, f64 nom_rank) const override;
+        void quantiles(KeyArg id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(KeyArg id) const override;
+        bool has(KeyArg id) const override;
+        vector<Key> flows() const override;
+        void clear() override;
+        void save(const string& path, bool compact = false) const override;
+        void load(const string& path) override;
 
     private:
         double ddcAlpha = 0.1;
@@ -26,10 +40,13 @@ namespace sketch {
 
         static constexpr u32 HASH_NUM = 3;
 
-        vector<META> buckets[HASH_NUM];          ///< Buckets.
+        huge_vector<META> buckets[HASH_NUM];     ///< Buckets.
         META dft;                                ///< Default bucket.
-        vector<u32> ids[HASH_NUM];               ///< Flow IDs.
-        BOBHash32 hash[HASH_NUM];                ///< Hash functions.
+        META blank;                              ///< Empty bucket.
+        huge_vector<u32> ids[HASH_NUM];          ///< Words of the flow keys.
+        std::shared_ptr<HugeRegion> region;      ///< Backing of the arrays.
+        KeyHash<Key> hash[HASH_NUM];             ///< Hash functions.
+        u32 hashSeed;                            ///< Seed of @c hash.
         rand_u32_generator gen{0, HASH_NUM - 1}; ///< Random number generator.
 
         u32 min_item = UINT32_MAX;               ///< Minimum item.
@@ -38,9 +55,13 @@ namespace sketch {
 
         /// @brief Return the bucket position of a given item.
         /// @param id Item ID.
-        u32 pos(u32 bucket_id, u32 id) const;
+        u32 pos(u32 bucket_id, KeyArg id) const;
 
         void evict(u32 bucket_id, u32 pos);
+
+        /// @brief Return a region for the arrays of a given number of
+        ///        buckets per table, see @c make_huge_region.
+        static std::shared_ptr<HugeRegion> makeRegion(u64 bucket_num);
     };
 }   // namespace sketch
 
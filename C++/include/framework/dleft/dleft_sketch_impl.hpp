@@ -5,32 +5,33 @@
 #include "../framework_utils.hpp"
 
 namespace sketch {
-    template <typename META>
-    DLeftSketch<META>::DLeftSketch(u64 mem_limit, u32 seed, double ddc_alpha) {
+    template <typename META, typename Key>
+    DLeftSketch<META, Key>::DLeftSketch(u64 mem_limit, u32 seed, double ddc_alpha) {
         ddcAlpha = ddc_alpha;
-        dft = createMeta(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
-        u32 bucket_num = mem_limit / (dft.memory() + sizeof(u32)) / HASH_NUM;
+        blank = createMeta<META>(UINT32_MAX, alpha, cmtor_cap, td_cap, ddc_alpha);
+        u32 bucket_num = mem_limit / (blank.memory() + sizeof(u32)) / HASH_NUM;
+        region = makeRegion(bucket_num);
         for (u32 i = 0; i < HASH_NUM; ++i) {
-            buckets[i] = vector<META>(bucket_num);
-            ids[i] = vector<u32>(bucket_num);
-            for (u32 j = 0; j < bucket_num; ++j) {
-                evict(i, j);
-            }
-            hash[i].initialize(seed + i);
+            buckets[i] = huge_vector<META>(bucket_num, blank,
+                                           HugePageAllocator<META>(region));
+            ids[i] = huge_vector<u32>(bucket_num, UINT32_MAX,
+                                      HugePageAllocator<u32>(region));
+            hash[i].initialize(seed + i, i);
         }
+        hashSeed = seed;
 
-        dft = createMeta(UINT32_MAX, 0.5, 2, 4, ddc_alpha);
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddc_alpha);
     }
 
-    template <typename META>
-    void DLeftSketch<META>::evict(u32 bucket_id, u32 pos) {
-        auto& sketch = buckets[bucket_id][pos];
-        sketch = createMeta(UINT32_MAX, alpha, cmtor_cap, td_cap, ddcAlpha);
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::evict(u32 bucket_id, u32 pos) {
+        buckets[bucket_id][pos] = blank;
         ids[bucket_id][pos] = UINT32_MAX;
     }
 
-    template <typename META>
-    void DLeftSketch<META>::append(u32 id, u32 value) {
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::append(KeyArg id, u32 value) {
+        u32 word = KeyTraits<Key>::word(id);
         min_item = std::min(min_item, value);
         max_item = std::max(max_item, value);
         dft.append(value);
@@ -38,7 +39,7 @@ namespace sketch {
         u32 tmp[HASH_NUM];
         for (u32 i = 0; i < HASH_NUM; ++i) {
             tmp[i] = pos(i, id);
-            if (ids[i][tmp[i]] == id) {
+            if (ids[i][tmp[i]] == word) {
                 buckets[i][tmp[i]].append(value);
                 return;
             }
@@ -46,7 +47,7 @@ namespace sketch {
 
         for (u32 i = 0; i < HASH_NUM; ++i) {
             if (ids[i][tmp[i]] == UINT32_MAX) {
-                ids[i][tmp[i]] = id;
+                ids[i][tmp[i]] = word;
                 buckets[i][tmp[i]].append(value);
                 return;
             }
@@ -55,15 +56,16 @@ namespace sketch {
         u32 bucket_id = gen();
         u32 tmp_id = tmp[bucket_id];
         evict(bucket_id, tmp_id);
-        ids[bucket_id][tmp_id] = id;
+        ids[bucket_id][tmp_id] = word;
         buckets[bucket_id][tmp_id].append(value);
     }
 
-    template <typename META>
-    u32 DLeftSketch<META>::quantile(u32 id, f64 nom_rank) const {
+    template <typename META, typename Key>
+    u32 DLeftSketch<META, Key>::quantile(KeyArg id, f64 nom_rank) const {
+        u32 word = KeyTraits<Key>::word(id);
         for (u32 i = 0; i < HASH_NUM; ++i) {
             u32 tmp = pos(i, id);
-            if (ids[i][tmp] == id) {
+            if (ids[i][tmp] == word) {
                 return buckets[i][tmp].quantile(nom_rank);
             }
         }
@@ -71,22 +73,202 @@ namespace sketch {
         return dft.quantile(nom_rank);
     }
 
-    template <typename META>
-    u32 DLeftSketch<META>::pos(u32 bucket_id, u32 id) const {
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::quantiles(KeyArg id, const f64* ranks,
+                                           u32 n, u32* out) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u32 tmp = pos(i, id);
+            if (ids[i][tmp] == word) {
+                buckets[i][tmp].quantiles(ranks, n, out);
+                return;
+            }
+        }
+
+        dft.quantiles(ranks, n, out);
+    }
+
+    template <typename META, typename Key>
+    Histogram DLeftSketch<META, Key>::histogram(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u32 tmp = pos(i, id);
+            if (ids[i][tmp] == word) {
+                return static_cast<Histogram>(buckets[i][tmp]);
+            }
+        }
+
+        return dft.empty() ? Histogram() : static_cast<Histogram>(dft);
+    }
+
+    template <typename META, typename Key>
+    bool DLeftSketch<META, Key>::has(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            if (ids[i][pos(i, id)] == word) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename META, typename Key>
+    vector<Key> DLeftSketch<META, Key>::flows() const {
+        if constexpr (!KeyTraits<Key>::exact) {
+            return BasicFramework<Key>::flows();
+        } else {
+            vector<Key> res;
+            for (u32 i = 0; i < HASH_NUM; ++i) {
+                for (u32 word : ids[i]) {
+                    if (word != KeyTraits<Key>::EMPTY) {
+                        res.push_back(KeyTraits<Key>::key(word));
+                    }
+                }
+            }
+            return res;
+        }
+    }
+
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::clear() {
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            std::fill(buckets[i].begin(), buckets[i].end(), blank);
+            std::fill(ids[i].begin(), ids[i].end(), UINT32_MAX);
+        }
+        dft = createMeta<META>(UINT32_MAX, 0.5, 2, 4, ddcAlpha);
+        min_item = UINT32_MAX;
+        max_item = 0;
+    }
+
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::save(const string& path, bool compact) const {
+        BinaryWriter out(path, compact);
+        out.putHeader(DLEFT, META::MODEL, sizeof(Key));
+        out.put(hashSeed);
+        out.put(ddcAlpha);
+        out.put(min_item);
+        out.put(max_item);
+        string gen_state = gen.state();
+        out.put(static_cast<u32>(gen_state.size()));
+        out.putArray(gen_state.data(), gen_state.size());
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            save_level(out, blank, buckets[i]);
+            out.putArray(ids[i].data(), ids[i].size());
+        }
+        save_meta(out, dft);
+        out.close();
+    }
+
+    template <typename META, typename Key>
+    void DLeftSketch<META, Key>::load(const string& path) {
+        MappedFile file(path);
+        BinaryReader in(file.data(), file.size());
+        in.getHeader(DLEFT, META::MODEL, sizeof(Key));
+        u32 seed = in.get<u32>();
+        f64 ddc_alpha = in.get<f64>();
+        u32 min_value = in.get<u32>();
+        u32 max_value = in.get<u32>();
+        u32 gen_len = in.get<u32>();
+        if (gen_len > in.remaining()) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        string gen_state(gen_len, '\0');
+        in.getArray(&gen_state[0], gen_len);
+        rand_u32_generator gen_tmp;
+        try {
+            gen_tmp.setState(gen_state);
+        } catch (const std::runtime_error&) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        // Read into temporaries so that a bad file leaves us untouched.
+        META proto, dft_tmp;
+        huge_vector<META> bucket_tmp[HASH_NUM];
+        huge_vector<u32> id_tmp[HASH_NUM];
+        std::shared_ptr<HugeRegion> region_tmp;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u64 num = load_level_head(in, proto);
+            if (i == 0) {
+                region_tmp = makeRegion(num);
+            }
+            bucket_tmp[i] = huge_vector<META>(
+                num, proto, HugePageAllocator<META>(region_tmp));
+            for (META& meta : bucket_tmp[i]) {
+                meta.loadState(in);
+            }
+            id_tmp[i] = huge_vector<u32>(num, 0,
+                                         HugePageAllocator<u32>(region_tmp));
+            in.getArray(id_tmp[i].data(), id_tmp[i].size());
+        }
+        load_meta(in, dft_tmp);
+        if (in.remaining() != 0) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            buckets[i] = std::move(bucket_tmp[i]);
+            ids[i] = std::move(id_tmp[i]);
+            hash[i].initialize(seed + i, i);
+        }
+        region = std::move(region_tmp);
+        blank = proto;
+        dft = std::move(dft_tmp);
+        hashSeed = seed;
+        ddcAlpha = ddc_alpha;
+        min_item = min_value;
+        max_item = max_value;
+        gen = gen_tmp;
+    }
+
+    template <typename META, typename Key>
+    std::shared_ptr<HugeRegion> DLeftSketch<META, Key>::makeRegion(u64 bucket_num) {
+        // one cache line of alignment slack per array
+        return make_huge_region(HASH_NUM * (bucket_num * (sizeof(META)
+                                                          + sizeof(u32))
+                                            + 128));
+    }
+
+    template <typename META, typename Key>
+    HugePages::Backing DLeftSketch<META, Key>::backing() const {
+        return region ? region->backing() : HugePages::NORMAL;
+    }
+
+    template <typename META, typename Key>
+    u32 DLeftSketch<META, Key>::pos(u32 bucket_id, KeyArg id) const {
         return hash[bucket_id].run(id) % buckets[bucket_id].size();
     }
 
-    template <typename META>
-    u32 DLeftSketch<META>::memory() const {
-        // This function will not be called.
-        assert(false);
-        return 0;
+    template <typename META, typename Key>
+    u64 DLeftSketch<META, Key>::memory() const {
+        // the budget of the constructor, a flow ID and a META per bucket
+        u64 res = 0;
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            res += ids[i].size() * sizeof(u32);
+            for (const META& meta : buckets[i]) {
+                res += meta.memory();
+            }
+        }
+        return res;
     }
 
-    template <typename META>
-    u32 DLeftSketch<META>::size(u32 id) const {
-        // This function will not be called.
-        assert(false);
+    template <typename META, typename Key>
+    u64 DLeftSketch<META, Key>::heapBytes() const {
+        u64 res = sizeof(*this) + dft.heapBytes() + blank.heapBytes();
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            res += heap_bytes(buckets[i]) + heap_bytes(ids[i]);
+        }
+        return res;
+    }
+
+    template <typename META, typename Key>
+    u32 DLeftSketch<META, Key>::size(KeyArg id) const {
+        u32 word = KeyTraits<Key>::word(id);
+        for (u32 i = 0; i < HASH_NUM; ++i) {
+            u32 tmp = pos(i, id);
+            if (ids[i][tmp] == word) {
+                return buckets[i][tmp].size();
+            }
+        }
         return 0;
     }
 }   // namespace sketch
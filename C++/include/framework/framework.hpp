@@ -1,32 +1,143 @@
 #pragma once
 #include "../common/sketch_defs.hpp"
+#include "../common/flow_key.hpp"
+#include "../common/histogram.hpp"
+#include "../common/mem_usage.hpp"
+#include "../common/huge_pages.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
 
 namespace sketch {
-    class Framework {
+    /// @brief Per-flow quantile sketch.
+    /// @tparam Key Flow key, a 32-bit ID or any fixed-width key that
+    ///             @c KeyHash accepts, e.g. a 64-bit ID or a @c FiveTuple.
+    template <typename Key = u32>
+    class BasicFramework {
     public:
+        /// @brief Type a key is passed as, by value if it fits a register.
+        using KeyArg = std::conditional_t<sizeof(Key) <= sizeof(u64),
+                                          Key, const Key&>;
+
         /// @brief Destructor.
-        virtual ~Framework() = default;
+        virtual ~BasicFramework() = default;
 
         /// @brief Append a given item into the sketch.
         /// @param id Item ID.
         /// @param value Item value.
-        virtual void append(u32 id, u32 value) = 0;
+        virtual void append(KeyArg id, u32 value) = 0;
 
         /// @brief Estimate the size of a given flow.
         /// @param id Flow ID.
-        virtual u32 size(u32 id) const = 0;
+        virtual u32 size(KeyArg id) const = 0;
+
+        /// @brief Return number of bytes the whole sketch uses, as modeled
+        ///        by the memory budget, i.e. with counters packed to the
+        ///        bits they need.
+        virtual u64 memory() const = 0;
 
-        /// @brief Return number of bytes the whole sketch uses.
-        virtual u32 memory() const = 0;
+        /// @brief Return number of bytes the sketch actually occupies, the
+        ///        object and the heap memory it owns.
+        virtual u64 heapBytes() const = 0;
+
+        /// @brief Return the pages the bucket arrays are backed by, see
+        ///        @c HugePages.
+        virtual HugePages::Backing backing() const {
+            return HugePages::NORMAL;
+        }
 
         /// @brief Estimate the quantile value of a given normalized rank.
         /// @param id Item ID.
         /// @param nom_rank Normalized rank.
-        virtual u32 quantile(u32 id, f64 nom_rank) const = 0;
+        virtual u32 quantile(KeyArg id, f64 nom_rank) const = 0;
+
+        /// @brief Estimate the quantile values of several normalized ranks
+        ///        of a given flow, same as calling @c quantile for each.
+        /// @details Frameworks override this to locate the flow and build
+        ///          its distribution only once for all ranks.
+        /// @param id Item ID.
+        /// @param ranks Normalized ranks, ascending ones are cheapest.
+        /// @param n Number of ranks.
+        /// @param out Quantile values, @p n of them.
+        virtual void quantiles(KeyArg id, const f64* ranks, u32 n,
+                               u32* out) const {
+            for (u32 i = 0; i < n; ++i) {
+                out[i] = quantile(id, ranks[i]);
+            }
+        }
+
+        /// @brief Return the estimated value distribution of a given flow,
+        ///        an empty histogram if the sketch cannot tell.
+        /// @param id Flow ID.
+        virtual Histogram histogram(KeyArg id) const = 0;
+
+        /// @brief Return whether the sketch keeps a given flow itself,
+        ///        rather than answering it from the distribution of all
+        ///        traffic as flow tables do for flows they lack.
+        /// @param id Flow ID.
+        virtual bool has(KeyArg id) const {
+            UNUSED(id);
+            return true;
+        }
+
+        /// @brief Reset the sketch to its freshly constructed state
+        ///        without reallocating it.
+        virtual void clear() = 0;
+
+        /// @brief Write the sketch to a sketch file.
+        /// @param path Path of the file.
+        /// @param compact Whether to varint-encode counters, which shrinks
+        ///                sparse sketches but makes loading slower.
+        virtual void save(const string& path, bool compact = false) const {
+            UNUSED(path);
+            UNUSED(compact);
+            throw std::logic_error("sketch files not supported");
+        }
+
+        /// @brief Replace the sketch by a sketch file written by @c save,
+        ///        including its geometry. The sketch is left unchanged if
+        ///        loading fails.
+        /// @details The file is mapped, but every bucket is decoded into
+        ///          its META, which owns heap storage, so loading takes
+        ///          time linear in the sketch. @c AndorView queries a
+        ///          non-compact @c AndorSketch file of DDSketches in place
+        ///          instead, right after mapping it.
+        /// @param path Path of the file.
+        virtual void load(const string& path) {
+            UNUSED(path);
+            throw std::logic_error("sketch files not supported");
+        }
+
+        /// @brief Return every flow whose key the sketch keeps, each once
+        ///        and in no particular order.
+        virtual vector<Key> flows() const {
+            throw std::logic_error("flow enumeration not supported");
+        }
+
+        /// @brief Return up to @p k flows of @c flows with the largest
+        ///        quantile values of a given rank, largest first.
+        /// @param k Number of flows.
+        /// @param nom_rank Normalized rank, e.g. 0.99 for the worst p99.
+        /// @return Flow IDs with their quantile values.
+        virtual vector<BasicFlowItem<Key>> topK(u32 k, f64 nom_rank) const {
+            vector<BasicFlowItem<Key>> res;
+            for (KeyArg id : flows()) {
+                res.push_back({id, quantile(id, nom_rank)});
+            }
+
+            auto larger = [](const BasicFlowItem<Key>& a,
+                             const BasicFlowItem<Key>& b) {
+                return a.value != b.value ? a.value > b.value : a.id < b.id;
+            };
+            k = std::min<u64>(k, res.size());
+            std::partial_sort(res.begin(), res.begin() + k, res.end(), larger);
+            res.resize(k);
+            return res;
+        }
 
         /// @brief Return the type of a given flow.
         /// @param id Flow ID.
-        virtual FlowType type(u32 id) const {
+        virtual FlowType type(KeyArg id) const {
             u32 sz = size(id);
             if (sz <= 3) {
                 return FlowType::TINY;
@@ -37,4 +148,7 @@ namespace sketch {
             }
         }
     };
+
+    /// @brief Framework of 32-bit flow IDs, as the datasets key flows.
+    using Framework = BasicFramework<u32>;
 } // namespace sketch
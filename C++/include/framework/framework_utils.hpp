@@ -1,4 +1,5 @@
 #pragma once
+#include <type_traits>
 #include "../common/sketch_defs.hpp"
 #include "../meta/dd/ddsketch.hpp"
 #include "../meta/mreq/mreq_sketch.hpp"
@@ -6,21 +7,83 @@
 #include "../meta/dd_collapse/ddsketch_collapse.hpp"
 
 namespace sketch {
-#ifdef TEST_DD
-    DDSketch createMeta(u32 cap, f64 alpha, u32, u32, double) {
-        return DDSketch(cap, alpha);
+    /// @brief Create an empty META of a given type, each type taking
+    ///        only the parameters it uses.
+    template <typename META>
+    META createMeta(u32 cap, f64 alpha, u32 cmtor_cap, u32 td_cap,
+                    double ddc_alpha) {
+        if constexpr (std::is_same_v<META, DDSketch>) {
+            return DDSketch(cap, alpha);
+        } else if constexpr (std::is_same_v<META, mReqSketch>) {
+            return mReqSketch(cap, cmtor_cap);
+        } else if constexpr (std::is_same_v<META, TDigest>) {
+            return TDigest(cap, td_cap);
+        } else {
+            static_assert(std::is_same_v<META, DDCSketch>, "unknown META");
+            return DDCSketch(cap, alpha, ddc_alpha);
+        }
     }
-#elif defined(TEST_MREQ)
-    mReqSketch createMeta(u32 cap, f64, u32 cmtor_cap, u32, double) {
-        return mReqSketch(cap, cmtor_cap);
+
+    /// @brief Whether a META keeps its storage in place while appending,
+    ///        so that a reader racing with appends may copy it and check
+    ///        the copy afterwards with a @c SeqLock. The other METAs
+    ///        reallocate, and a racy copy could follow a freed pointer.
+    template <typename META>
+    constexpr bool has_fixed_storage = std::is_same_v<META, DDSketch>;
+
+    // Sketch files.
+
+    /// @brief Write a level of METAs, the parameters once and then the
+    ///        state of each META.
+    /// @param proto An empty META of the level.
+    template <typename META, typename Vec>
+    void save_level(BinaryWriter& out, const META& proto, const Vec& vec) {
+        proto.saveParams(out);
+        out.put<u64>(vec.size());
+        for (u64 i = 0; i < vec.size(); ++i) {
+            vec[i].saveState(out);
+        }
     }
-#elif defined(TEST_TD)
-    TDigest createMeta(u32 cap, f64, u32, u32 delta, double) {
-        return TDigest(cap, delta);
+
+    /// @brief Read the parameters and size of a level written by
+    ///        @c save_level, the states are left to the caller.
+    /// @param proto Set to an empty META of the level.
+    /// @return Number of METAs in the level.
+    template <typename META>
+    u64 load_level_head(BinaryReader& in, META& proto) {
+        proto.loadParams(in);
+        u64 num = in.get<u64>();
+        // Every state takes at least one byte.
+        if (num > in.remaining()) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        return num;
     }
-#elif defined(TEST_DDC)
-    DDCSketch createMeta(u32 cap, f64 alpha, u32, u32, double ddc_alpha) {
-        return DDCSketch(cap, alpha, ddc_alpha);
+
+    /// @brief Read a level written by @c save_level.
+    /// @param proto Set to an empty META of the level.
+    /// @param alloc Allocator of the returned vector.
+    template <typename META, typename Vec = vector<META>>
+    Vec load_level(BinaryReader& in, META& proto,
+                   const typename Vec::allocator_type& alloc = {}) {
+        Vec vec(load_level_head(in, proto), proto, alloc);
+        for (META& meta : vec) {
+            meta.loadState(in);
+        }
+        return vec;
+    }
+
+    /// @brief Write a single META with its parameters.
+    template <typename META>
+    void save_meta(BinaryWriter& out, const META& meta) {
+        meta.saveParams(out);
+        meta.saveState(out);
+    }
+
+    /// @brief Read a META written by @c save_meta.
+    template <typename META>
+    void load_meta(BinaryReader& in, META& meta) {
+        meta.loadParams(in);
+        meta.loadState(in);
     }
-#endif
 }   // namespace sketch
@@ -0,0 +1,166 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "../../common/numa_topology.hpp"
+#include "../../common/spsc_ring.hpp"
+#include "../framework.hpp"
+
+namespace sketch {
+    /// @brief Counters of the shards placed on one NUMA node.
+    struct NodeStats {
+        u32 node;           ///< System ID of the node.
+        u32 shards;         ///< Shards placed on the node.
+        u64 items;          ///< Items appended to them.
+        f64 seconds;        ///< Time their owners spent appending.
+        u64 heap;           ///< Their @c Framework::heapBytes.
+        u64 resident;       ///< Resident bytes of the process on the node.
+    };
+
+    /// @brief Sketch split by flow into shards, each an ordinary framework
+    ///        that a worker thread owns on one NUMA node.
+    /// @details Shards go round-robin over the nodes. The owner of a shard
+    ///          is pinned to the CPUs of its node and prefers its memory,
+    ///          then builds the shard, so that first touch places the whole
+    ///          shard there, and applies every append to it. The ingestion
+    ///          thread calling @c append only routes items into per-shard
+    ///          batches, handed over through lock-free queues. On a single
+    ///          node nothing is pinned, and only the sharding remains.
+    class ShardedSketch final : public Framework {
+    public:
+        /// @brief Builds a shard, called on the shard's owner.
+        using Factory = std::function<Framework*(u32 shard)>;
+
+        /// @brief Constructor.
+        /// @param shard_num Number of shards, each with an owner thread.
+        /// @param create Builds each shard.
+        /// @param topology Nodes to place the shards on.
+        /// @param batch_size Items per batch handed to an owner.
+        /// @param depth Batches in flight per shard.
+        /// @throw What @p create throws for any shard.
+        ShardedSketch(u32 shard_num, const Factory& create,
+                      const NumaTopology& topology = NumaTopology(),
+                      u32 batch_size = 1024, u32 depth = 8);
+
+        ~ShardedSketch();
+
+        ShardedSketch(const ShardedSketch&) = delete;
+        ShardedSketch& operator=(const ShardedSketch&) = delete;
+
+        /// @brief Route an item to the batch of its shard.
+        /// @warning Call from one ingestion thread only.
+        void append(u32 id, u32 value) override;
+
+        /// @brief Hand over partial batches and wait until every item
+        ///        appended so far is in its shard.
+        void flush();
+
+        // Queries run on the owners, after the batches queued before them,
+        // so they see every item appended so far: one of a single flow on
+        // the owner of its shard, the others on every owner. Like append,
+        // they hand over partial batches, so call them from the ingestion
+        // thread too.
+
+        u32 size(u32 id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        HugePages::Backing backing() const override;
+        u32 quantile(u32 id, f64 nom_rank) const override;
+        void quantiles(u32 id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(u32 id) const override;
+        bool has(u32 id) const override;
+        vector<u32> flows() const override;
+        void clear() override;
+
+        /// @brief Estimate the quantile of many flows, each answered by the
+        ///        owner of its shard on the shard's node.
+        /// @param ids Flow IDs.
+        /// @param n Number of flows.
+        /// @param nom_rank Normalized rank.
+        /// @param out Quantile values, @p n of them.
+        void quantileBatch(const u32* ids, u32 n, f64 nom_rank, u32* out);
+
+        /// @brief Return number of shards.
+        u32 shards() const { return shardNum; }
+
+        /// @brief Return the shard a flow belongs to.
+        u32 shardOf(u32 id) const;
+
+        /// @brief Return counters per node, after the batches queued
+        ///        before.
+        vector<NodeStats> nodeStats() const;
+
+    private:
+        /// Queue messages besides batch indices.
+        static constexpr u32 RUN_JOB = UINT32_MAX - 1;
+        static constexpr u32 STOP = UINT32_MAX;
+        /// Batch index of a shard with no batch being filled.
+        static constexpr u32 NO_BATCH = UINT32_MAX;
+        /// Shard argument of @c runOnShards that stands for all of them.
+        static constexpr u32 ALL_SHARDS = UINT32_MAX;
+
+        struct Batch {
+            vector<FlowItem> items;
+            u32 num = 0;    ///< Valid items.
+        };
+
+        /// @brief State of a shard, touched by its owner.
+        struct Shard {
+            std::unique_ptr<Framework> sketch;
+            vector<Batch> pool;         ///< Batch storage.
+            SpscRing<u32> filled;       ///< Messages for the owner.
+            SpscRing<u32> drained;      ///< Batches free for ingestion.
+            u32 node = 0;               ///< Node index of the owner.
+            u32 current = NO_BATCH;      ///< Batch being filled, if any.
+            u64 items = 0;              ///< Items appended by the owner.
+            f64 seconds = 0;            ///< Time spent appending.
+            std::thread owner;
+
+            explicit Shard(u32 depth) : filled(depth + 2), drained(depth) { }
+        };
+
+        NumaTopology topo;
+        u32 shardNum;
+        u32 batchSize;
+        vector<std::unique_ptr<Shard>> shardSet;
+
+        // Queries post jobs too, hence mutable.
+        mutable std::mutex lock;            ///< Guards the fields below.
+        mutable std::condition_variable done;   ///< Signals a finished owner.
+        mutable u32 pending = 0;            ///< Owners still busy.
+        mutable std::exception_ptr error;   ///< First error of an owner.
+        mutable std::function<void(u32, Framework&)> job;   ///< Job to run.
+
+        /// @brief Body of the owner of a shard.
+        void own(u32 s, const Factory& create, u32 depth);
+
+        /// @brief Stop and join every owner.
+        void stop();
+
+        /// @brief Apply a batch to a shard, on its owner.
+        void apply(Shard& shard, u32 idx);
+
+        /// @brief Run a function on every owner with its shard, after the
+        ///        batches queued before, and wait for all of them.
+        /// @param only Shard to run on alone, or @c ALL_SHARDS.
+        /// @throw The first exception the function threw on an owner.
+        void runOnShards(std::function<void(u32, Framework&)> f,
+                         u32 only = ALL_SHARDS) const;
+
+        /// @brief Hand over partial batches without waiting.
+        /// @param only Shard whose batch to hand over, or @c ALL_SHARDS.
+        void handOver(u32 only = ALL_SHARDS) const;
+
+        /// @brief Report an owner as done, with its error if any.
+        void finish(std::exception_ptr err = nullptr);
+
+        /// @brief Wait for every owner to finish and rethrow an error.
+        void wait() const;
+    };
+}   // namespace sketch
+
+#include "sharded_sketch_impl.hpp"
@@ -0,0 +1,285 @@
+#pragma once
+#include "sharded_sketch.hpp"
+#include <numeric>
+#include <stdexcept>
+
+namespace sketch {
+    ShardedSketch::ShardedSketch(u32 shard_num, const Factory& create,
+                                 const NumaTopology& topology, u32 batch_size,
+                                 u32 depth)
+        : topo(topology), shardNum(shard_num), batchSize(batch_size) {
+        if (shard_num == 0 || batch_size == 0 || depth == 0) {
+            throw std::invalid_argument(
+                "shards, batch size and depth must be positive");
+        }
+
+        for (u32 s = 0; s < shardNum; ++s) {
+            shardSet.push_back(std::make_unique<Shard>(depth));
+            shardSet[s]->node = s % topo.nodes();
+        }
+        pending = shardNum;
+        for (u32 s = 0; s < shardNum; ++s) {
+            shardSet[s]->owner = std::thread(
+                [this, s, &create, depth] { own(s, create, depth); });
+        }
+
+        try {
+            wait();
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ShardedSketch::~ShardedSketch() {
+        stop();
+    }
+
+    void ShardedSketch::stop() {
+        for (auto& shard : shardSet) {
+            if (shard->owner.joinable()) {
+                shard->filled.push(STOP);
+                shard->owner.join();
+            }
+        }
+    }
+
+    void ShardedSketch::own(u32 s, const Factory& create, u32 depth) {
+        Shard& shard = *shardSet[s];
+        try {
+            // pinned and preferring the node before the shard is built, so
+            // that it is first touched there
+            topo.pinToNode(shard.node);
+            topo.preferNode(shard.node);
+            shard.sketch.reset(create(s));
+            shard.pool = vector<Batch>(depth,
+                                       Batch{vector<FlowItem>(batchSize), 0});
+            for (u32 i = 0; i < depth; ++i) {
+                shard.drained.push(i);
+            }
+        } catch (...) {
+            finish(std::current_exception());
+            return;
+        }
+        finish();
+
+        while (true) {
+            u32 msg;
+            shard.filled.pop(msg);
+            if (msg == STOP) {
+                break;
+            } else if (msg == RUN_JOB) {
+                try {
+                    job(s, *shard.sketch);
+                    finish();
+                } catch (...) {
+                    finish(std::current_exception());
+                }
+            } else {
+                apply(shard, msg);
+            }
+        }
+        // freed by the owner, back to the arena of its node
+        shard.sketch.reset();
+    }
+
+    void ShardedSketch::apply(Shard& shard, u32 idx) {
+        Batch& batch = shard.pool[idx];
+        auto start = steady_clock::now();
+        for (u32 i = 0; i < batch.num; ++i) {
+            shard.sketch->append(batch.items[i].id, batch.items[i].value);
+        }
+        shard.seconds += duration<f64>(steady_clock::now() - start).count();
+        shard.items += batch.num;
+        batch.num = 0;
+        shard.drained.push(idx);
+    }
+
+    u32 ShardedSketch::shardOf(u32 id) const {
+        // fmix32 of MurmurHash3, independent of the hashes of the shards,
+        // then a multiply-shift onto [0, shardNum)
+        id ^= id >> 16;
+        id *= 0x85ebca6b;
+        id ^= id >> 13;
+        id *= 0xc2b2ae35;
+        id ^= id >> 16;
+        return static_cast<u64>(id) * shardNum >> 32;
+    }
+
+    void ShardedSketch::append(u32 id, u32 value) {
+        Shard& shard = *shardSet[shardOf(id)];
+        if (shard.current == NO_BATCH) {
+            shard.drained.pop(shard.current);
+        }
+        Batch& batch = shard.pool[shard.current];
+        batch.items[batch.num++] = {id, value};
+        if (batch.num == batchSize) {
+            shard.filled.push(shard.current);
+            shard.current = NO_BATCH;
+        }
+    }
+
+    void ShardedSketch::handOver(u32 only) const {
+        for (u32 s = 0; s < shardNum; ++s) {
+            Shard& shard = *shardSet[s];
+            if ((only == ALL_SHARDS || s == only) && shard.current != NO_BATCH
+                && shard.pool[shard.current].num != 0) {
+                shard.filled.push(shard.current);
+                shard.current = NO_BATCH;
+            }
+        }
+    }
+
+    void ShardedSketch::runOnShards(std::function<void(u32, Framework&)> f,
+                                    u32 only) const {
+        handOver(only);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = std::move(f);
+            pending = only == ALL_SHARDS ? shardNum : 1;
+        }
+        for (u32 s = 0; s < shardNum; ++s) {
+            if (only == ALL_SHARDS || s == only) {
+                shardSet[s]->filled.push(RUN_JOB);
+            }
+        }
+        wait();
+    }
+
+    void ShardedSketch::finish(std::exception_ptr err) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (err && !error) {
+            error = err;
+        }
+        if (--pending == 0) {
+            done.notify_all();
+        }
+    }
+
+    void ShardedSketch::wait() const {
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [this] { return pending == 0; });
+        if (error) {
+            std::exception_ptr err = error;
+            error = nullptr;
+            std::rethrow_exception(err);
+        }
+    }
+
+    void ShardedSketch::flush() {
+        runOnShards([](u32, Framework&) { });
+    }
+
+    u32 ShardedSketch::size(u32 id) const {
+        u32 res = 0;
+        runOnShards([&](u32, Framework& fw) { res = fw.size(id); },
+                    shardOf(id));
+        return res;
+    }
+
+    u64 ShardedSketch::memory() const {
+        vector<u64> part(shardNum);
+        runOnShards([&](u32 s, Framework& fw) { part[s] = fw.memory(); });
+        return std::accumulate(part.begin(), part.end(), u64(0));
+    }
+
+    u64 ShardedSketch::heapBytes() const {
+        vector<u64> part(shardNum);
+        runOnShards([&](u32 s, Framework& fw) { part[s] = fw.heapBytes(); });
+        u64 res = sizeof(*this) + heap_bytes(shardSet);
+        for (u32 s = 0; s < shardNum; ++s) {
+            const Shard& shard = *shardSet[s];
+            res += sizeof(Shard) + part[s] + heap_bytes(shard.pool)
+                   + (shard.filled.capacity() + shard.drained.capacity())
+                     * sizeof(u32);
+            for (const Batch& batch : shard.pool) {
+                res += heap_bytes(batch.items);
+            }
+        }
+        return res;
+    }
+
+    HugePages::Backing ShardedSketch::backing() const {
+        // fixed once the shards are built
+        return shardSet[0]->sketch->backing();
+    }
+
+    u32 ShardedSketch::quantile(u32 id, f64 nom_rank) const {
+        u32 res = 0;
+        runOnShards([&](u32, Framework& fw) {
+            res = fw.quantile(id, nom_rank);
+        }, shardOf(id));
+        return res;
+    }
+
+    void ShardedSketch::quantiles(u32 id, const f64* ranks, u32 n,
+                                  u32* out) const {
+        runOnShards([&](u32, Framework& fw) {
+            fw.quantiles(id, ranks, n, out);
+        }, shardOf(id));
+    }
+
+    Histogram ShardedSketch::histogram(u32 id) const {
+        Histogram res;
+        runOnShards([&](u32, Framework& fw) { res = fw.histogram(id); },
+                    shardOf(id));
+        return res;
+    }
+
+    bool ShardedSketch::has(u32 id) const {
+        bool res = false;
+        runOnShards([&](u32, Framework& fw) { res = fw.has(id); },
+                    shardOf(id));
+        return res;
+    }
+
+    vector<u32> ShardedSketch::flows() const {
+        vector<vector<u32>> part(shardNum);
+        runOnShards([&](u32 s, Framework& fw) { part[s] = fw.flows(); });
+        vector<u32> res;
+        for (const vector<u32>& ids : part) {
+            res.insert(res.end(), ids.begin(), ids.end());
+        }
+        return res;
+    }
+
+    void ShardedSketch::clear() {
+        runOnShards([this](u32 s, Framework& fw) {
+            fw.clear();
+            shardSet[s]->items = 0;
+            shardSet[s]->seconds = 0;
+        });
+    }
+
+    void ShardedSketch::quantileBatch(const u32* ids, u32 n, f64 nom_rank,
+                                      u32* out) {
+        vector<vector<u32>> part(shardNum);
+        for (u32 i = 0; i < n; ++i) {
+            part[shardOf(ids[i])].push_back(i);
+        }
+        runOnShards([&](u32 s, Framework& fw) {
+            for (u32 i : part[s]) {
+                out[i] = fw.quantile(ids[i], nom_rank);
+            }
+        });
+    }
+
+    vector<NodeStats> ShardedSketch::nodeStats() const {
+        vector<u64> heap(shardNum);
+        runOnShards([&](u32 s, Framework& fw) { heap[s] = fw.heapBytes(); });
+        vector<u64> resident = topo.residentBytes();
+        vector<NodeStats> res(topo.nodes());
+        for (u32 i = 0; i < topo.nodes(); ++i) {
+            res[i] = {topo.id(i), 0, 0, 0, 0, resident[i]};
+        }
+        for (u32 s = 0; s < shardNum; ++s) {
+            const Shard& shard = *shardSet[s];
+            NodeStats& stats = res[shard.node];
+            ++stats.shards;
+            stats.items += shard.items;
+            stats.seconds += shard.seconds;
+            stats.heap += heap[s];
+        }
+        return res;
+    }
+}   // namespace sketch
@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "../framework.hpp"
+
+namespace sketch {
+    /// @brief Per-flow quantiles over the most recent items, kept as a ring
+    ///        of sub-sketches of which the oldest is recycled on rotation.
+    /// @details Appends go to the head sub-sketch only, queries merge the
+    ///          histograms of the sub-sketches that keep the flow. The
+    ///          window therefore covers between @c windows - 1 and
+    ///          @c windows rotation periods.
+    ///
+    ///          Appends check the clock only now and then, and rotate once
+    ///          per period elapsed, so a quiet stream expires all its
+    ///          sub-sketches at once. Queries skip the sub-sketches whose
+    ///          periods have passed without waiting for the next append.
+    ///
+    ///          Rotation swaps a spare, already cleared sub-sketch in for
+    ///          the oldest one, which a cleaner thread then clears in the
+    ///          background to become the next spare. Only when rotations
+    ///          come faster than a clear does @c rotate wait for it.
+    template <typename FW>
+    class SlidingWindow final : public Framework {
+        using clock = std::chrono::steady_clock;
+
+    public:
+        /// @brief Constructor.
+        /// @param windows Number of sub-sketches, at least 2.
+        /// @param rotate_items Rotate after this many appends, 0 to disable.
+        /// @param rotate_period Rotate after this much time, 0 to disable.
+        /// @param args Arguments of each sub-sketch, e.g. its memory limit.
+        template <typename... Args>
+        SlidingWindow(u32 windows, u64 rotate_items,
+                      clock::duration rotate_period, Args&&... args);
+
+        ~SlidingWindow();
+
+        SlidingWindow(const SlidingWindow&) = delete;
+        SlidingWindow& operator=(const SlidingWindow&) = delete;
+
+        void append(u32 id, u32 value) override;
+        u32 size(u32 id) const override;
+        u64 memory() const override;
+        u64 heapBytes() const override;
+        u32 quantile(u32 id, f64 nom_rank) const override;
+        void quantiles(u32 id, const f64* ranks, u32 n,
+                       u32* out) const override;
+        Histogram histogram(u32 id) const override;
+        bool has(u32 id) const override;
+        /// @brief Return the flows kept by any sub-sketch.
+        vector<u32> flows() const override;
+        void clear() override;
+
+        /// @brief Retire the oldest sub-sketch and swap the cleared spare
+        ///        in as the head, in constant time.
+        void rotate();
+
+    private:
+        /// Appends between two checks of the clock.
+        static constexpr u32 CLOCK_CHECK_MASK = 1024 - 1;
+
+        std::vector<std::unique_ptr<FW>> ring;  ///< Sub-sketches.
+        std::vector<u64> itemNum;       ///< Appends seen by each sub-sketch.
+        u32 head;                       ///< Sub-sketch receiving appends.
+        u64 rotateItems;                ///< Appends per sub-sketch.
+        clock::duration rotatePeriod;   ///< Lifetime of a sub-sketch.
+        clock::time_point deadline;     ///< Time of the next rotation.
+
+        std::unique_ptr<FW> spare;      ///< Sub-sketch to rotate in next.
+        mutable std::mutex lock;        ///< Guards the fields below.
+        mutable std::condition_variable cleaned;    ///< Signals a change.
+        bool dirty = false;             ///< Spare not cleared yet.
+        bool stopping = false;          ///< Cleaner asked to exit.
+        std::thread cleaner;            ///< Clears retired sub-sketches.
+
+        /// @brief Return the number of sub-sketches, from the head back,
+        ///        whose periods have not passed by now.
+        u32 live() const;
+
+        /// @brief Return the sub-sketch @p age rotations older than the
+        ///        head.
+        const FW& slot(u32 age) const;
+
+        /// @brief Body of the cleaner thread.
+        void clean();
+
+        /// @brief Wait until the spare is cleared.
+        void waitCleaned() const;
+    };
+}   // namespace sketch
+
+#include "sliding_window_impl.hpp"
@@ -0,0 +1,226 @@
+#pragma once
+#include "sliding_window.hpp"
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+namespace sketch {
+    template <typename FW>
+    template <typename... Args>
+    SlidingWindow<FW>::SlidingWindow(u32 windows, u64 rotate_items,
+            clock::duration rotate_period, Args&&... args)
+        : itemNum(windows, 0), head(0), rotateItems(rotate_items),
+          rotatePeriod(rotate_period) {
+        if (windows < 2) {
+            throw std::invalid_argument("at least two windows required");
+        }
+        for (u32 i = 0; i < windows; ++i) {
+            ring.emplace_back(std::make_unique<FW>(args...));
+        }
+        spare = std::make_unique<FW>(args...);
+        deadline = clock::now() + rotatePeriod;
+        cleaner = std::thread([this] { clean(); });
+    }
+
+    template <typename FW>
+    SlidingWindow<FW>::~SlidingWindow() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        cleaned.notify_all();
+        cleaner.join();
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::clean() {
+        // batch scheduling, so that waking the cleaner does not preempt
+        // ingestion on a shared CPU; best effort, a failure leaves the
+        // default policy
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_BATCH, &param);
+
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            cleaned.wait(guard, [this] { return dirty || stopping; });
+            if (stopping) {
+                return;
+            }
+            // the ingestion thread leaves the spare alone while it is dirty
+            guard.unlock();
+            spare->clear();
+            guard.lock();
+            dirty = false;
+            cleaned.notify_all();
+        }
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::waitCleaned() const {
+        std::unique_lock<std::mutex> guard(lock);
+        cleaned.wait(guard, [this] { return !dirty; });
+    }
+
+    template <typename FW>
+    u32 SlidingWindow<FW>::live() const {
+        if (rotatePeriod == clock::duration::zero()) {
+            return ring.size();
+        }
+        clock::time_point now = clock::now();
+        if (now < deadline) {
+            return ring.size();
+        }
+        u64 due = 1 + (now - deadline) / rotatePeriod;
+        return due >= ring.size() ? 0 : ring.size() - due;
+    }
+
+    template <typename FW>
+    const FW& SlidingWindow<FW>::slot(u32 age) const {
+        return *ring[(head + ring.size() - age) % ring.size()];
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::append(u32 id, u32 value) {
+        u64 num = itemNum[head];
+        if (rotateItems != 0 && num >= rotateItems) {
+            rotate();
+        } else if (rotatePeriod != clock::duration::zero()
+                && (num & CLOCK_CHECK_MASK) == 0) {
+            clock::time_point now = clock::now();
+            if (now >= deadline) {
+                // one rotation per elapsed period, and past a whole
+                // window every sub-sketch has expired
+                u64 due = 1 + (now - deadline) / rotatePeriod;
+                for (u64 i = 0; i < std::min<u64>(due, ring.size()); ++i) {
+                    rotate();
+                }
+            }
+        }
+
+        ring[head]->append(id, value);
+        ++itemNum[head];
+    }
+
+    template <typename FW>
+    u32 SlidingWindow<FW>::size(u32 id) const {
+        u32 res = 0;
+        for (u32 age = 0, n = live(); age < n; ++age) {
+            res += slot(age).size(id);
+        }
+        return res;
+    }
+
+    template <typename FW>
+    u64 SlidingWindow<FW>::memory() const {
+        waitCleaned();
+        u64 res = spare->memory();
+        for (const auto& fw : ring) {
+            res += fw->memory();
+        }
+        return res;
+    }
+
+    template <typename FW>
+    u64 SlidingWindow<FW>::heapBytes() const {
+        waitCleaned();
+        u64 res = sizeof(*this) + heap_bytes(ring) + heap_bytes(itemNum)
+                  + spare->heapBytes();
+        for (const auto& fw : ring) {
+            res += fw->heapBytes();
+        }
+        return res;
+    }
+
+    template <typename FW>
+    u32 SlidingWindow<FW>::quantile(u32 id, f64 nom_rank) const {
+        Histogram hist = histogram(id);
+        return hist.empty() ? 0 : hist.quantile(nom_rank);
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::quantiles(u32 id, const f64* ranks, u32 n,
+                                      u32* out) const {
+        Histogram hist = histogram(id);
+        if (hist.empty()) {
+            std::fill(out, out + n, 0);
+            return;
+        }
+        hist.quantiles(ranks, n, out);
+    }
+
+    template <typename FW>
+    Histogram SlidingWindow<FW>::histogram(u32 id) const {
+        // Sub-sketches lacking the flow answer with all their traffic, so
+        // that only counts when none of them keeps it.
+        u32 n = live();
+        bool kept = false;
+        for (u32 age = 0; age < n && !kept; ++age) {
+            kept = slot(age).has(id);
+        }
+        Histogram res;
+        for (u32 age = 0; age < n; ++age) {
+            const FW& fw = slot(age);
+            if (kept && !fw.has(id)) {
+                continue;
+            }
+            Histogram hist = fw.histogram(id);
+            if (hist.empty()) {
+                continue;
+            }
+            res = res.empty() ? hist : (res | hist);
+        }
+        return res;
+    }
+
+    template <typename FW>
+    bool SlidingWindow<FW>::has(u32 id) const {
+        for (u32 age = 0, n = live(); age < n; ++age) {
+            if (slot(age).has(id)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename FW>
+    vector<u32> SlidingWindow<FW>::flows() const {
+        vector<u32> res;
+        for (u32 age = 0, n = live(); age < n; ++age) {
+            vector<u32> ids = slot(age).flows();
+            res.insert(res.end(), ids.begin(), ids.end());
+        }
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+        return res;
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::clear() {
+        waitCleaned();
+        for (u32 i = 0; i < ring.size(); ++i) {
+            ring[i]->clear();
+            itemNum[i] = 0;
+        }
+        head = 0;
+        deadline = clock::now() + rotatePeriod;
+    }
+
+    template <typename FW>
+    void SlidingWindow<FW>::rotate() {
+        // The slot after the head is the oldest one. Clearing it here would
+        // stall appends for the whole sketch, so the cleared spare takes
+        // its place and the cleaner recycles it.
+        head = (head + 1) % ring.size();
+        if (itemNum[head] != 0) {
+            waitCleaned();
+            std::swap(ring[head], spare);
+            itemNum[head] = 0;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                dirty = true;
+            }
+            cleaned.notify_all();
+        }
+        deadline = clock::now() + rotatePeriod;
+    }
+}   // namespace sketch
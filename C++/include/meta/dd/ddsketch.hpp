@@ -1,13 +1,23 @@
 #pragma once
 #include "../../common/sketch_defs.hpp"
 #include "../../common/histogram.hpp"
+#include "../../common/binary_io.hpp"
 
 namespace sketch {
-        template <typename META>
-        class AndorSketch;
+    template <typename META, typename Key>
+    class AndorSketch;
+    template <typename Key>
+    class AndorView;
+
     class DDSketch {
-        friend class AndorSketch<DDSketch>;
+        template <typename META, typename Key>
+        friend class AndorSketch;
+        template <typename Key>
+        friend class AndorView;
     public:
+        /// @brief META model tag written into sketch files.
+        static constexpr MetaModel MODEL = DD;
+
         /// @brief Default constructor.
         /// @warning Members are potential uninitialized after construction.
         ///          Make sure you know what you are doing.
@@ -35,6 +45,10 @@ namespace sketch {
         /// @brief Return the number of bytes the DDSketch uses.
         u32 memory() const;
 
+        /// @brief Return the heap bytes the DDSketch owns, excluding the
+        ///        object itself.
+        u64 heapBytes() const;
+
         /// @brief Append an item to the DDSketch.
         /// @param item The item to append.
         void append(u32 item);
@@ -42,9 +56,32 @@ namespace sketch {
         /// @brief Estimate the quantile value of a given normalized rank.
         u32 quantile(f64 nom_rank) const;
 
+        /// @brief Estimate the quantile values of several normalized ranks
+        ///        in one scan over the counters if they are ascending.
+        /// @param ranks Normalized ranks.
+        /// @param n Number of ranks.
+        /// @param out Quantile values, @p n of them.
+        void quantiles(const f64* ranks, u32 n, u32* out) const;
+
         /// @brief Convert the DDSketch to a histogram.
         operator Histogram() const;
 
+        // Serialization.
+
+        /// @brief Write the parameters, shared by all DDSketches of a level.
+        void saveParams(BinaryWriter& out) const;
+
+        /// @brief Become an empty DDSketch with parameters written by
+        ///        @c saveParams.
+        void loadParams(BinaryReader& in);
+
+        /// @brief Write the items, excluding the parameters.
+        void saveState(BinaryWriter& out) const;
+
+        /// @brief Read items written by @c saveState into a DDSketch
+        ///        with the same parameters.
+        void loadState(BinaryReader& in);
+
     private:
         vec_u32 counters;       ///< Counters.
         u32 totalSize = 0;      ///< Total number of items.
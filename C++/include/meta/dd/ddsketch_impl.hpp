@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include "../../common/mem_usage.hpp"
 
 namespace sketch {
     DDSketch::DDSketch(u32 cap_, f64 alpha_)
@@ -37,6 +38,10 @@ namespace sketch {
         return (counter_bits * counters.size() + 7) / 8;
     }
 
+    u64 DDSketch::heapBytes() const {
+        return heap_bytes(counters);
+    }
+
     u32 DDSketch::pos(u32 item) const {
         u32 tmp = std::ceil(std::log2(item) / std::log2(gamma));
         u32 maxp = counters.size() - 1;
@@ -62,17 +67,32 @@ namespace sketch {
     }
 
     u32 DDSketch::quantile(f64 nom_rank) const {
-        if (nom_rank < 0.0 || nom_rank > 1.0) {
-            throw std::invalid_argument("normalized rank out of range");
-        }
-
-        u32 rank = nom_rank * (totalSize - 1);
-        u32 idx = 0;
+        u32 res;
+        quantiles(&nom_rank, 1, &res);
+        return res;
+    }
 
-        for (u32 sum = counters[0]; sum <= rank; sum += counters[++idx]);
+    void DDSketch::quantiles(const f64* ranks, u32 n, u32* out) const {
+        for (u32 k = 0; k < n; ++k) {
+            if (ranks[k] < 0.0 || ranks[k] > 1.0) {
+                throw std::invalid_argument("normalized rank out of range");
+            }
+        }
 
-        f64 res = idx == 0 ? 1 : 2 * std::pow(gamma, idx) / (gamma + 1);
-        return std::lrint(res);
+        // Resume the scan from the previous bucket if the rank grows.
+        u32 idx = 0, sum = 0, last_rank = 0;
+        for (u32 k = 0; k < n; ++k) {
+            u32 rank = ranks[k] * (totalSize - 1);
+            if (k == 0 || rank < last_rank) {
+                idx = 0;
+                sum = counters[0];
+            }
+            last_rank = rank;
+            for (; sum <= rank; sum += counters[++idx]);
+
+            f64 res = idx == 0 ? 1 : 2 * std::pow(gamma, idx) / (gamma + 1);
+            out[k] = std::lrint(res);
+        }
     }
 
     DDSketch::operator Histogram() const {
@@ -86,4 +106,66 @@ namespace sketch {
         }
         return Histogram(split, height);
     }
+
+    void DDSketch::saveParams(BinaryWriter& out) const {
+        out.put(cap);
+        out.put(alpha);
+        out.put(gamma);
+        out.put<u32>(counters.size());
+    }
+
+    void DDSketch::loadParams(BinaryReader& in) {
+        cap = in.get<u32>();
+        alpha = in.get<f64>();
+        gamma = in.get<f64>();
+        counters = vec_u32(in.get<u32>(), 0);
+        totalSize = 0;
+        maxCnt = 0;
+    }
+
+    void DDSketch::saveState(BinaryWriter& out) const {
+        // Counters never exceed the capacity, but their sum may.
+        u32 width = packed_width(cap);
+        out.putCounter(totalSize, sizeof(u32));
+        out.putCounter(maxCnt, width);
+
+        if (!out.compact()) {
+            // Fixed stride, so that loading is a plain copy.
+            out.putPackedArray(counters.data(), counters.size(), width);
+            return;
+        }
+
+        // Most counters are zero, write the others as (gap, count) pairs.
+        u32 nonzero = counters.size() - std::count(counters.begin(),
+                                                   counters.end(), 0u);
+        out.putVarint(nonzero);
+        for (u32 i = 0, last = 0; i < counters.size(); ++i) {
+            if (counters[i] != 0) {
+                out.putVarint(i - last);
+                out.putVarint(counters[i]);
+                last = i;
+            }
+        }
+    }
+
+    void DDSketch::loadState(BinaryReader& in) {
+        u32 width = packed_width(cap);
+        totalSize = in.getCounter(sizeof(u32));
+        maxCnt = in.getCounter(width);
+
+        if (!in.compact()) {
+            in.getPackedArray(counters.data(), counters.size(), width);
+            return;
+        }
+
+        std::fill(counters.begin(), counters.end(), 0);
+        u64 nonzero = in.getVarint();
+        for (u64 i = 0, idx = 0; i < nonzero; ++i) {
+            idx += in.getVarint();
+            if (idx >= counters.size()) {
+                throw std::runtime_error("corrupt sketch file");
+            }
+            counters[idx] = in.getVarint();
+        }
+    }
 }   // namespace sketch
@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include "../../common/mem_usage.hpp"
 
 namespace sketch {
     DDCSketch::DDCSketch(u32 cap_, f64 alpha_, double ddc_alpha)
@@ -52,6 +53,10 @@ namespace sketch {
         return (counter_bits * max_counter_num + 7) / 8;
     }
 
+    u64 DDCSketch::heapBytes() const {
+        return heap_bytes(counters);
+    }
+
     u8 DDCSketch::pos(u32 item) const {
         return std::ceil(std::log2(item) / std::log2(gamma));
     }
@@ -100,17 +105,32 @@ namespace sketch {
     // }
 
     u32 DDCSketch::quantile(f64 nom_rank) const {
-        if (nom_rank < 0.0 || nom_rank > 1.0) {
-            throw std::invalid_argument("normalized rank out of range");
-        }
+        u32 res;
+        quantiles(&nom_rank, 1, &res);
+        return res;
+    }
 
-        u32 rank = nom_rank * (totalSize - 1);
-        u32 idx = 0;
+    void DDCSketch::quantiles(const f64* ranks, u32 n, u32* out) const {
+        for (u32 k = 0; k < n; ++k) {
+            if (ranks[k] < 0.0 || ranks[k] > 1.0) {
+                throw std::invalid_argument("normalized rank out of range");
+            }
+        }
 
-        for (u32 sum = counters[0].second; sum <= rank; sum += counters[++idx].second);
+        // Resume the scan from the previous counter if the rank grows.
+        u32 idx = 0, sum = 0, last_rank = 0;
+        for (u32 k = 0; k < n; ++k) {
+            u32 rank = ranks[k] * (totalSize - 1);
+            if (k == 0 || rank < last_rank) {
+                idx = 0;
+                sum = counters[0].second;
+            }
+            last_rank = rank;
+            for (; sum <= rank; sum += counters[++idx].second);
 
-        f64 res = counters[idx].first == 0 ? 1 : 2 * std::pow(gamma, counters[idx].first) / (gamma + 1);
-        return std::lrint(res);
+            f64 res = counters[idx].first == 0 ? 1 : 2 * std::pow(gamma, counters[idx].first) / (gamma + 1);
+            out[k] = std::lrint(res);
+        }
     }
 
     DDCSketch::operator Histogram() const {
@@ -137,4 +157,47 @@ namespace sketch {
     return Histogram(split, height);
 }
 
+
+    void DDCSketch::saveParams(BinaryWriter& out) const {
+        out.put(cap);
+        out.put(alpha);
+        out.put(gamma);
+        out.put(max_counter_num);
+    }
+
+    void DDCSketch::loadParams(BinaryReader& in) {
+        cap = in.get<u32>();
+        alpha = in.get<f64>();
+        gamma = in.get<f64>();
+        max_counter_num = in.get<u32>();
+        counters.clear();
+        totalSize = 0;
+        maxCnt = 0;
+    }
+
+    void DDCSketch::saveState(BinaryWriter& out) const {
+        // Collapsing merges counters beyond the capacity, so they are
+        // written in full.
+        out.putCounter(totalSize, sizeof(u32));
+        out.putCounter(maxCnt, sizeof(u32));
+        out.put<u8>(counters.size());
+        for (const pair32& c : counters) {
+            out.put(c.first);
+            out.putCounter(c.second, sizeof(u32));
+        }
+    }
+
+    void DDCSketch::loadState(BinaryReader& in) {
+        totalSize = in.getCounter(sizeof(u32));
+        maxCnt = in.getCounter(sizeof(u32));
+        u32 num = in.get<u8>();
+        if (num > max_counter_num) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        counters.resize(num);
+        for (pair32& c : counters) {
+            c.first = in.get<u8>();
+            c.second = in.getCounter(sizeof(u32));
+        }
+    }
 }   // namespace sketch
@@ -1,5 +1,6 @@
 #pragma once
 #include "../../common/sketch_utils.hpp"
+#include "../../common/binary_io.hpp"
 
 namespace sketch {
     class mReqCmtor {
@@ -24,6 +25,8 @@ namespace sketch {
         u32 weight() const;
         /// @brief Return number of bytes the compactor uses.
         u32 memory() const;
+        /// @brief Return the heap bytes the compactor owns.
+        u64 heapBytes() const;
 
         /// @brief Return begin iterator.
         u32_const_iter begin() const;
@@ -53,6 +56,12 @@ namespace sketch {
         /// @param inclusive If the given item is included in the rank.
         u32 weightedRank(u32 item, bool inclusive = true) const;
 
+        /// @brief Write the items of the compactor.
+        void saveState(BinaryWriter& out) const;
+
+        /// @brief Read items written by @c saveState.
+        void loadState(BinaryReader& in);
+
 
     private:
         u32     lg_w;      ///< Log2 of the weight of the compactor.
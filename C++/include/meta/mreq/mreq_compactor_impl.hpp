@@ -1,6 +1,7 @@
 #pragma once
 #include "mreq_compactor.hpp"
 #include <algorithm>
+#include "../../common/mem_usage.hpp"
 #include "../../common/vec_ops.hpp"
 
 namespace sketch {
@@ -33,6 +34,10 @@ namespace sketch {
         return sizeof(u32) * capacity();
     }
 
+    u64 mReqCmtor::heapBytes() const {
+        return heap_bytes(items);
+    }
+
     u32_const_iter mReqCmtor::begin() const {
         return items.begin();
     }
@@ -78,4 +83,31 @@ namespace sketch {
     u32 mReqCmtor::weightedRank(u32 item, bool inclusive) const {
         return rank(item, inclusive) * weight();
     }
-} // namespace sketch
\ No newline at end of file
+
+    void mReqCmtor::saveState(BinaryWriter& out) const {
+        out.putCounter(items.size(), sizeof(u32));
+        if (!out.compact()) {
+            out.putArray(items.data(), items.size());
+            return;
+        }
+        // Items are kept sorted, so their deltas are small.
+        for (u32 i = 0, prev = 0; i < items.size(); prev = items[i++]) {
+            out.putVarint(items[i] - prev);
+        }
+    }
+
+    void mReqCmtor::loadState(BinaryReader& in) {
+        u32 num = in.getCounter(sizeof(u32));
+        if (num > cap) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        items.resize(num);
+        if (!in.compact()) {
+            in.getArray(items.data(), num);
+            return;
+        }
+        for (u32 i = 0, prev = 0; i < num; prev = items[i++]) {
+            items[i] = prev + in.getVarint();
+        }
+    }
+} // namespace sketch
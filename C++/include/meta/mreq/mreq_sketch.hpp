@@ -2,11 +2,15 @@
 #include "mreq_compactor.hpp"
 #include "../../common/sorted_view.hpp"
 #include "../../common/histogram.hpp"
+#include "../../common/binary_io.hpp"
 
 namespace sketch {
     class mReqSketch {
         using vec_cmtor = vector<mReqCmtor>;
     public:
+        /// @brief META model tag written into sketch files.
+        static constexpr MetaModel MODEL = MREQ;
+
         /// @brief Constructor.
         /// @param sketch_cap_ Capacity of the sketch. 
         /// @param cmtor_cap_ Capacity of each compactor.
@@ -28,6 +32,9 @@ namespace sketch {
         bool full() const;
         /// @brief Return number of bytes the sketch uses.
         u32 memory() const;
+        /// @brief Return the heap bytes the sketch owns, excluding the
+        ///        object itself.
+        u64 heapBytes() const;
 
         /// @brief Append a given item into the sketch.
         /// @param item Appended item.
@@ -48,9 +55,34 @@ namespace sketch {
         /// @param inclusive If the given rank is included.
         u32 quantile(f64 nom_rank, bool inclusive = true) const;
 
+        /// @brief Estimate the quantile values of several normalized ranks,
+        ///        setting up the sorted view only once.
+        /// @param ranks Normalized ranks.
+        /// @param n Number of ranks.
+        /// @param out Quantile values, @p n of them.
+        /// @param inclusive If the given ranks are included.
+        void quantiles(const f64* ranks, u32 n, u32* out,
+                       bool inclusive = true) const;
+
         /// @brief Convert the sketch into a histogram.
         operator Histogram() const;
 
+        // Serialization.
+
+        /// @brief Write the parameters, shared by all sketches of a level.
+        void saveParams(BinaryWriter& out) const;
+
+        /// @brief Become an empty sketch with parameters written by
+        ///        @c saveParams.
+        void loadParams(BinaryReader& in);
+
+        /// @brief Write the items, excluding the parameters.
+        void saveState(BinaryWriter& out) const;
+
+        /// @brief Read items written by @c saveState into a sketch
+        ///        with the same parameters.
+        void loadState(BinaryReader& in);
+
     private:
         u32 itemNum;               ///< Number of items in the sketch.
         u32 sketchCap;             ///< Capacity of the sketch.
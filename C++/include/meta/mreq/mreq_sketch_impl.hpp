@@ -39,6 +39,10 @@ namespace sketch {
         return cmtors.capacity() * cmtors.front().memory();
     }
 
+    u64 mReqSketch::heapBytes() const {
+        return heap_bytes(cmtors);
+    }
+
     void mReqSketch::append(u32 item) {
         if (full()) {
             throw std::logic_error("append to a full mreq sketch");
@@ -91,6 +95,23 @@ namespace sketch {
         return view.quantile(nom_rank, inclusive);
     }
 
+    void mReqSketch::quantiles(const f64* ranks, u32 n, u32* out,
+                               bool inclusive) const {
+        if (empty()) {
+            throw std::runtime_error("get quantile on empty mreq sketch");
+        }
+        for (u32 k = 0; k < n; ++k) {
+            if (ranks[k] < 0.0 || ranks[k] > 1.0) {
+                throw std::invalid_argument("normalized rank out of range");
+            }
+        }
+
+        auto view = setupSortedView();
+        for (u32 k = 0; k < n; ++k) {
+            out[k] = view.quantile(ranks[k], inclusive);
+        }
+    }
+
     SortedView mReqSketch::setupSortedView() const {
         auto view = SortedView(size());
 
@@ -113,4 +134,36 @@ namespace sketch {
         auto view = setupSortedView();
         return static_cast<sketch::Histogram>(view);
     }
-}  // namespace sketch
\ No newline at end of file
+
+    void mReqSketch::saveParams(BinaryWriter& out) const {
+        out.put(sketchCap);
+        out.put(cmtors.front().capacity());
+    }
+
+    void mReqSketch::loadParams(BinaryReader& in) {
+        sketchCap = in.get<u32>();
+        u32 cmtor_cap = in.get<u32>();
+        if (cmtor_cap == 0) {
+            throw std::runtime_error("corrupt sketch file");
+        }
+        *this = mReqSketch(sketchCap, cmtor_cap);
+    }
+
+    void mReqSketch::saveState(BinaryWriter& out) const {
+        out.putCounter(itemNum, sizeof(u32));
+        out.putCounter(minItem, sizeof(u32));
+        out.putCounter(maxItem, sizeof(u32));
+        for (const mReqCmtor& c : cmtors) {
+            c.saveState(out);
+        }
+    }
+
+    void mReqSketch::loadState(BinaryReader& in) {
+        itemNum = in.getCounter(sizeof(u32));
+        minItem = in.getCounter(sizeof(u32));
+        maxItem = in.getCounter(sizeof(u32));
+        for (mReqCmtor& c : cmtors) {
+            c.loadState(in);
+        }
+    }
+}  // namespace sketch
@@ -2,10 +2,14 @@
 #include "centroid.hpp"
 #include <utility>
 #include "../../common/histogram.hpp"
+#include "../../common/binary_io.hpp"
 
 namespace sketch {
     class TDigest {
     public:
+        /// @brief META model tag written into sketch files.
+        static constexpr MetaModel MODEL = TD;
+
         /// @brief Default constructor.
         /// @warning Members are potential uninitialized after construction.
         ///          Make sure you know what you are doing.
@@ -32,6 +36,10 @@ namespace sketch {
         /// @brief Return the number of bytes the t-digest uses.
         u32 memory() const;
 
+        /// @brief Return the heap bytes the t-digest owns, excluding the
+        ///        object itself.
+        u64 heapBytes() const;
+
         /// @brief Append an item to the t-digest.
         /// @param item The item to append.
         void append(u32 item);
@@ -40,8 +48,31 @@ namespace sketch {
         /// @param nom_rank Normalized rank.
         u32 quantile(f64 nom_rank) const;
 
+        /// @brief Estimate the quantile values of several normalized ranks,
+        ///        converting the t-digest to a histogram only once.
+        /// @param ranks Normalized ranks.
+        /// @param n Number of ranks.
+        /// @param out Quantile values, @p n of them.
+        void quantiles(const f64* ranks, u32 n, u32* out) const;
+
         /// @brief Convert the t-digest to a histogram.
         operator Histogram() const;
+
+        // Serialization.
+
+        /// @brief Write the parameters, shared by all t-digests of a level.
+        void saveParams(BinaryWriter& out) const;
+
+        /// @brief Become an empty t-digest with parameters written by
+        ///        @c saveParams.
+        void loadParams(BinaryReader& in);
+
+        /// @brief Write the items, excluding the parameters.
+        void saveState(BinaryWriter& out) const;
+
+        /// @brief Read items written by @c saveState into a t-digest
+        ///        with the same parameters.
+        void loadState(BinaryReader& in);
         
     private:
         vector<Centroid> centroids; ///< Centroids in the t-digest.
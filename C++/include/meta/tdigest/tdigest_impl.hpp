@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <cassert>
 #include "../../common/vec_ops.hpp"
+#include "../../common/mem_usage.hpp"
 
 namespace sketch{
     TDigest::TDigest(u32 cap_, u32 delta_)
@@ -29,6 +30,10 @@ namespace sketch{
         return (centroid_bits * DELTA + 7) / 8;
     }
 
+    u64 TDigest::heapBytes() const {
+        return heap_bytes(centroids);
+    }
+
     f64 TDigest::scale(f64 p) const {
         const f64 PI = acos(-1);
         return asin(2 * p - 1) / (2 * PI) * DELTA;
@@ -158,6 +163,13 @@ namespace sketch{
         return static_cast<Histogram>(*this).quantile(nom_rank);
     }
 
+    void TDigest::quantiles(const f64* ranks, u32 n, u32* out) const {
+        if (empty()) {
+            throw std::logic_error("get quantile on empty t-digest");
+        }
+        static_cast<Histogram>(*this).quantiles(ranks, n, out);
+    }
+
     TDigest::operator Histogram() const {
         const auto& c = centroids;
         assert(c.size() > 0);
@@ -179,4 +191,49 @@ namespace sketch{
 
         return Histogram(split, height);
     }
+
+    void TDigest::saveParams(BinaryWriter& out) const {
+        out.put(cap);
+        out.put(DELTA);
+    }
+
+    void TDigest::loadParams(BinaryReader& in) {
+        cap = in.get<u32>();
+        DELTA = in.get<u32>();
+        centroids.clear();
+        totalWeight = 0;
+        min_item = UINT32_MAX;
+        max_item = 0;
+        max_weight = 0;
+    }
+
+    void TDigest::saveState(BinaryWriter& out) const {
+        // Merged centroids may outweigh the capacity, so weights are
+        // written in full.
+        u32 width = sizeof(u32);
+        out.putCounter(totalWeight, width);
+        out.putCounter(max_weight, width);
+        out.putCounter(min_item, sizeof(u32));
+        out.putCounter(max_item, sizeof(u32));
+        out.putCounter(centroids.size(), sizeof(u32));
+        for (const Centroid& c : centroids) {
+            out.put(c.mean());
+            out.putCounter(c.weight(), width);
+        }
+    }
+
+    void TDigest::loadState(BinaryReader& in) {
+        u32 width = sizeof(u32);
+        totalWeight = in.getCounter(width);
+        max_weight = in.getCounter(width);
+        min_item = in.getCounter(sizeof(u32));
+        max_item = in.getCounter(sizeof(u32));
+        u32 num = in.getCounter(sizeof(u32));
+        centroids.clear();
+        centroids.reserve(num);
+        for (u32 i = 0; i < num; ++i) {
+            f64 mean = in.get<f64>();
+            centroids.emplace_back(mean, in.getCounter(width));
+        }
+    }
 }   // namespace sketch
@@ -0,0 +1,90 @@
+#pragma once
+#include <ostream>
+#include "sketch_test.hpp"
+
+namespace sketch {
+    /// @brief Search of the @c AndorConfig that suits a trace sample under
+    ///        a memory budget.
+    /// @details Candidates form a grid over the memory shares, the META
+    ///          accuracy and the capacities of lv1 and lv2. They are cut
+    ///          down by successive halving: each rung appends a longer
+    ///          prefix of the sample with the budget scaled to it, and only
+    ///          the most accurate candidates go on. The last rung appends
+    ///          the whole sample, and its survivors are compared on
+    ///          accuracy and throughput. Pinned workers build the ground
+    ///          truth and evaluate the candidates of a rung concurrently;
+    ///          only the survivors of the last rung are timed, one after
+    ///          another on a CPU of their own.
+    template <typename META>
+    class AndorTuner {
+    public:
+        /// @brief A candidate with the metrics of its latest rung.
+        struct Candidate {
+            AndorConfig config;
+            f64 ale = 0, ape = 0;
+            f64 append_tp = 0, query_tp = 0;
+            bool valid = false;     ///< Whether the sketch could be built.
+        };
+
+        /// @brief Constructor.
+        /// @param mem_limit_ Memory budget in bytes.
+        /// @param hash_num_ Number of hash functions per level.
+        /// @param seed_ Seed for generating hash functions.
+        /// @param worker_num_ Workers of the untimed passes, by default
+        ///                    one per hardware thread.
+        AndorTuner(u64 mem_limit_, u32 hash_num_, u32 seed_,
+                   double ddc_alpha_,
+                   u32 worker_num_ = std::thread::hardware_concurrency());
+
+        /// @brief Return the candidates searched.
+        static vector<AndorConfig> grid();
+
+        /// @brief Search the grid on a trace sample.
+        void run(const vector<FlowItem>& sample);
+
+        /// @brief Return the candidates of the last rung.
+        const vector<Candidate>& finalists() const { return final; }
+
+        /// @brief Return the finalists that no other finalist beats on
+        ///        ALE, APE, appending and query throughput at once.
+        vector<Candidate> paretoFront() const;
+
+        /// @brief Return the Pareto-optimal finalist of least error,
+        ///        ranked as in the rungs.
+        /// @throw std::logic_error if no candidate survived.
+        const Candidate& best() const;
+
+        /// @brief Print the Pareto front and the chosen configuration.
+        void report(std::ostream& out) const;
+
+    private:
+        u64 mem_limit;      ///< Memory budget.
+        u32 hash_num;       ///< Number of hash functions per level.
+        u32 seed;           ///< Seed for generating hash functions.
+        double ddc_alpha;
+        u32 worker_num;     ///< Workers of the untimed passes.
+
+        vector<Candidate> final;    ///< Candidates of the last rung.
+
+        /// Number of rungs, rung r appending 1 / 4^(rungs - 1 - r) of the
+        /// sample.
+        static constexpr u32 rungs = 3;
+        /// Share of candidates kept by each rung but the last.
+        static constexpr u32 keep_div = 3;
+
+        /// @brief Run candidates on a prefix of the sample.
+        /// @param timed Whether to measure throughput too.
+        void runRung(vector<Candidate>& cands, const vector<FlowItem>& items,
+                     u64 mem, ThreadPool& pool, bool timed) const;
+
+        /// @brief Sort valid candidates by the sum of their ALE and APE
+        ///        ranks, dropping the invalid ones.
+        static void rank(vector<Candidate>& cands);
+
+        /// @brief Return whether @p a is no worse than @p b on every
+        ///        metric and better on one.
+        static bool dominates(const Candidate& a, const Candidate& b);
+    };
+}   // namespace sketch
+
+#include "andor_tuner_impl.hpp"
@@ -0,0 +1,222 @@
+#pragma once
+#include "andor_tuner.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace sketch {
+    template <typename META>
+    AndorTuner<META>::AndorTuner(u64 mem_limit_, u32 hash_num_, u32 seed_,
+                                 double ddc_alpha_, u32 worker_num_)
+        : mem_limit(mem_limit_), hash_num(hash_num_), seed(seed_),
+          ddc_alpha(ddc_alpha_), worker_num(worker_num_) { }
+
+    template <typename META>
+    vector<AndorConfig> AndorTuner<META>::grid() {
+        // META accuracy steps from fine to coarse. Each META reads only
+        // its own parameter, so the steps move all of them together.
+        static constexpr f64 alphas[3][4] = {
+            {0, 0.3, 0.3, 0.2}, {0, 0.5, 0.5, 0.3}, {0, 0.7, 0.7, 0.45}};
+        static constexpr u32 cmtor_caps[3][4] = {
+            {0, 3, 3, 6}, {0, 2, 2, 4}, {0, 1, 1, 2}};
+        static constexpr u32 td_caps[3][4] = {
+            {0, 6, 12, 24}, {0, 4, 8, 16}, {0, 2, 4, 8}};
+
+        vector<AndorConfig> res;
+        for (f64 div0 : {0.02, 0.03, 0.05}) {
+            for (f64 div3 : {0.02, 0.05}) {
+                for (f64 share1 : {0.5, 0.6, 0.7}) {
+                    for (u32 step = 0; step < 3; ++step) {
+                        for (u32 cap1 : {15u, u32(UINT8_MAX)}) {
+                            for (u32 cap2 : {4095u, u32(UINT16_MAX)}) {
+                                AndorConfig config;
+                                f64 rest = 1 - div0 - div3;
+                                config.mem_div[0] = div0;
+                                config.mem_div[1] = rest * share1;
+                                config.mem_div[2] = rest * (1 - share1);
+                                config.mem_div[3] = div3;
+                                config.cap[1] = cap1;
+                                config.cap[2] = cap2;
+                                for (u32 i = 1; i < AndorConfig::LEVELS; ++i) {
+                                    config.alpha[i] = alphas[step][i];
+                                    config.cmtor_cap[i] = cmtor_caps[step][i];
+                                    config.td_cap[i] = td_caps[step][i];
+                                }
+                                res.push_back(config);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return res;
+    }
+
+    template <typename META>
+    void AndorTuner<META>::run(const vector<FlowItem>& sample) {
+        if (sample.empty()) {
+            throw std::invalid_argument("empty trace sample");
+        }
+
+        ThreadPool pool(worker_num, true);
+        vector<Candidate> cands;
+        for (const AndorConfig& config : grid()) {
+            cands.push_back({config});
+        }
+
+        for (u32 r = 0; r < rungs; ++r) {
+            u64 div = u64(1) << (2 * (rungs - 1 - r));
+            u64 len = std::max<u64>(sample.size() / div, 1);
+            vector<FlowItem> prefix(sample.begin(), sample.begin() + len);
+            u64 mem = mem_limit / div;
+
+            cout << "Rung " << r << ": " << cands.size() << " candidates, "
+                 << len << " items, " << (mem / 1024) << "KB" << endl;
+            runRung(cands, prefix, mem, pool, r + 1 == rungs);
+            rank(cands);
+            if (r + 1 < rungs) {
+                cands.resize((cands.size() + keep_div - 1) / keep_div);
+            }
+        }
+        final = std::move(cands);
+    }
+
+    template <typename META>
+    void AndorTuner<META>::runRung(vector<Candidate>& cands,
+                                   const vector<FlowItem>& items, u64 mem,
+                                   ThreadPool& pool, bool timed) const {
+        GroundTruth truth(items, pool);
+        for (Candidate& cand : cands) {
+            // the scaled budget may leave a level without buckets, which
+            // rules the candidate out; any other error is a bug
+            cand.valid = AndorSketch<META>::fits(mem, cand.config, ddc_alpha);
+        }
+
+        // accuracy of every candidate at once, untimed
+        pool.parallelFor(cands.size(), 1, [&](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; ++i) {
+                Candidate& cand = cands[i];
+                if (!cand.valid) {
+                    continue;
+                }
+                SketchSingleTest<META> test(ANDOR, mem, hash_num, seed,
+                                            ddc_alpha, cand.config);
+                test.append(items);
+                test.estimate(truth);
+                cand.ale = test.ALE(GroundTruth::eval_types);
+                cand.ape = test.APE(GroundTruth::eval_types);
+            }
+        });
+        if (!timed) {
+            return;
+        }
+
+        // throughput one candidate at a time, on the CPU the idle pool
+        // reserves
+        pool.runPinned([&] {
+            for (Candidate& cand : cands) {
+                if (!cand.valid) {
+                    continue;
+                }
+                SketchSingleTest<META> test(ANDOR, mem, hash_num, seed,
+                                            ddc_alpha, cand.config);
+                test.append(items);
+                test.timeQueries(truth);
+                cand.append_tp = test.appendTp();
+                cand.query_tp = test.queryTp();
+            }
+        });
+    }
+
+    template <typename META>
+    void AndorTuner<META>::rank(vector<Candidate>& cands) {
+        cands.erase(std::remove_if(cands.begin(), cands.end(),
+                                   [](const Candidate& c) { return !c.valid; }),
+                    cands.end());
+
+        u64 n = cands.size();
+        vector<u64> order(n), score(n, 0);
+        auto add_ranks = [&](auto key) {
+            for (u64 i = 0; i < n; ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](u64 a, u64 b) {
+                return key(cands[a]) < key(cands[b]);
+            });
+            for (u64 i = 0; i < n; ++i) {
+                score[order[i]] += i;
+            }
+        };
+        add_ranks([](const Candidate& c) { return c.ale; });
+        add_ranks([](const Candidate& c) { return c.ape; });
+
+        for (u64 i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](u64 a, u64 b) {
+            return score[a] < score[b];
+        });
+        vector<Candidate> sorted;
+        sorted.reserve(n);
+        for (u64 i : order) {
+            sorted.push_back(cands[i]);
+        }
+        cands = std::move(sorted);
+    }
+
+    template <typename META>
+    bool AndorTuner<META>::dominates(const Candidate& a, const Candidate& b) {
+        bool no_worse = a.ale <= b.ale && a.ape <= b.ape
+                        && a.append_tp >= b.append_tp
+                        && a.query_tp >= b.query_tp;
+        bool better = a.ale < b.ale || a.ape < b.ape
+                      || a.append_tp > b.append_tp
+                      || a.query_tp > b.query_tp;
+        return no_worse && better;
+    }
+
+    template <typename META>
+    vector<typename AndorTuner<META>::Candidate>
+    AndorTuner<META>::paretoFront() const {
+        vector<Candidate> res;
+        for (const Candidate& cand : final) {
+            bool dominated = std::any_of(final.begin(), final.end(),
+                [&](const Candidate& other) {
+                    return dominates(other, cand);
+                });
+            if (!dominated) {
+                res.push_back(cand);
+            }
+        }
+        return res;
+    }
+
+    template <typename META>
+    const typename AndorTuner<META>::Candidate&
+    AndorTuner<META>::best() const {
+        // finalists are in rank order, so the first undominated one is
+        // the most accurate of the front
+        for (const Candidate& cand : final) {
+            bool dominated = std::any_of(final.begin(), final.end(),
+                [&](const Candidate& other) {
+                    return dominates(other, cand);
+                });
+            if (!dominated) {
+                return cand;
+            }
+        }
+        throw std::logic_error("no candidate survived");
+    }
+
+    template <typename META>
+    void AndorTuner<META>::report(std::ostream& out) const {
+        out << "Pareto front, most accurate first:" << endl;
+        for (const Candidate& cand : paretoFront()) {
+            out << "ALE " << cand.ale << ", APE " << cand.ape
+                << ", append " << cand.append_tp << " Mops"
+                << ", query " << cand.query_tp << " Mops" << endl;
+            cand.config.write(out);
+        }
+        out << endl << "Chosen:" << endl;
+        best().config.write(out);
+    }
+}   // namespace sketch
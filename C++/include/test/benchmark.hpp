@@ -0,0 +1,131 @@
+#pragma once
+#include <ostream>
+#include <type_traits>
+#include "../common/sketch_utils.hpp"
+#include "../common/cycle_clock.hpp"
+
+namespace sketch {
+    /// @brief Hardware counters of the calling thread, read through
+    ///        @c perf_event_open.
+    /// @details Events the kernel refuses, e.g. under a restrictive
+    ///          @c perf_event_paranoid or in a VM, are left unavailable
+    ///          instead of failing the benchmark. Only user space is
+    ///          counted.
+    class PerfCounters {
+    public:
+        enum Event {
+            CYCLES,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            NUM_EVENTS,
+        };
+
+        /// @brief Open the counters, disabled.
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        /// @brief Return whether an event could be opened.
+        bool available(Event event) const { return fds[event] >= 0; }
+
+        /// @brief Start counting.
+        void start();
+
+        /// @brief Stop counting and add the counts since @c start to the
+        ///        totals.
+        void stop();
+
+        /// @brief Reset the totals.
+        void reset();
+
+        /// @brief Return the total of an event.
+        u64 total(Event event) const { return totals[event]; }
+
+        /// @brief Return the name of an event.
+        static const char* name(Event event);
+
+    private:
+        int fds[NUM_EVENTS];        ///< Counter of each event, or -1.
+        u64 totals[NUM_EVENTS];     ///< Counts summed over intervals.
+    };
+
+    /// @brief Summary of a sample of throughputs.
+    struct BenchSummary {
+        f64 median = 0, mean = 0, stddev = 0, min = 0, max = 0;
+
+        /// @brief Summarize samples, stddev being the sample one.
+        static BenchSummary of(vector<f64> samples);
+    };
+
+    /// @brief Percentiles of sampled per-operation latencies in ns.
+    struct LatencySummary {
+        u64 samples = 0;
+        f64 p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0;
+
+        /// @brief Summarize latencies in timestamp ticks.
+        static LatencySummary of(vector<u64> ticks);
+    };
+
+    struct BenchConfig {
+        u32 warmup = 1;         ///< Untimed runs before the trials.
+        u32 trials = 5;         ///< Timed runs.
+        u32 sample_every = 64;  ///< Time one operation in about n on its
+                                ///< own in an extra untimed run, 0 for no
+                                ///< latency samples.
+        bool counters = true;   ///< Whether to read hardware counters.
+    };
+
+    /// @brief Result of a benchmark.
+    struct BenchResult {
+        string name;                ///< Benchmark name.
+        u64 ops = 0;                ///< Operations per trial.
+        vector<f64> mops;           ///< Throughput of each trial in Mops.
+        BenchSummary tp;            ///< Summary of @c mops.
+        LatencySummary latency;     ///< Latencies sampled by a run of their
+                                    ///< own, none if it is too short.
+        /// Events per operation over all trials, negative if unavailable.
+        f64 perOp[PerfCounters::NUM_EVENTS];
+
+        /// @brief Write the result as a JSON object.
+        void writeJson(std::ostream& out, u32 indent = 0) const;
+    };
+
+    /// @brief Benchmark harness: warmup, repeated timed trials, sampled
+    ///        latencies and hardware counters.
+    class Benchmark {
+    public:
+        explicit Benchmark(const BenchConfig& config_ = BenchConfig());
+
+        /// @brief Benchmark an operation.
+        /// @details Every run calls @p setup untimed, then @p op(i) for i
+        ///          in [0, @p ops). A value returned by @p op is folded
+        ///          into a sink, so that the compiler cannot drop it.
+        ///          Latencies are sampled in a run after the trials, so
+        ///          that neither the throughput nor the counters of a
+        ///          trial pay for the serializing timestamps.
+        /// @param name Benchmark name.
+        /// @param ops Operations per run.
+        /// @param setup Resets the state before each run, e.g. builds an
+        ///              empty sketch.
+        /// @param op Operation to time.
+        template <typename Setup, typename Op>
+        BenchResult run(const string& name, u64 ops, Setup&& setup, Op&& op);
+
+        const BenchConfig& settings() const { return config; }
+
+    private:
+        BenchConfig config;
+        PerfCounters counters;
+
+        /// @brief Run @p op on [begin, end) untimed.
+        template <typename Op>
+        static void loop(u64 begin, u64 end, Op& op, u64& sink);
+    };
+
+    /// @brief Write a string as a JSON string literal.
+    void write_json_string(std::ostream& out, const string& str);
+}   // namespace sketch
+
+#include "benchmark_impl.hpp"
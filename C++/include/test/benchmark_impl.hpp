@@ -0,0 +1,267 @@
+#pragma once
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sketch {
+    PerfCounters::PerfCounters() {
+        static const u64 configs[NUM_EVENTS][2] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                 | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+
+        for (u32 i = 0; i < NUM_EVENTS; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[i][0];
+            attr.config = configs[i][1];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            totals[i] = 0;
+        }
+    }
+
+    PerfCounters::~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void PerfCounters::start() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void PerfCounters::stop() {
+        for (u32 i = 0; i < NUM_EVENTS; ++i) {
+            if (fds[i] >= 0) {
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (u32 i = 0; i < NUM_EVENTS; ++i) {
+            u64 cnt;
+            if (fds[i] >= 0 && read(fds[i], &cnt, sizeof(cnt)) == sizeof(cnt)) {
+                totals[i] += cnt;
+            }
+        }
+    }
+
+    void PerfCounters::reset() {
+        std::fill(totals, totals + NUM_EVENTS, 0);
+    }
+
+    const char* PerfCounters::name(Event event) {
+        static const char* names[NUM_EVENTS] = {
+            "cycles", "llc_misses", "branch_misses"
+        };
+        return names[event];
+    }
+
+    BenchSummary BenchSummary::of(vector<f64> samples) {
+        BenchSummary res;
+        u64 n = samples.size();
+        if (n == 0) {
+            return res;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        res.min = samples.front();
+        res.max = samples.back();
+        res.median = n % 2 ? samples[n / 2]
+                           : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+        for (f64 x : samples) {
+            res.mean += x;
+        }
+        res.mean /= n;
+        if (n > 1) {
+            for (f64 x : samples) {
+                res.stddev += (x - res.mean) * (x - res.mean);
+            }
+            res.stddev = std::sqrt(res.stddev / (n - 1));
+        }
+        return res;
+    }
+
+    LatencySummary LatencySummary::of(vector<u64> ticks) {
+        LatencySummary res;
+        res.samples = ticks.size();
+        if (ticks.empty()) {
+            return res;
+        }
+
+        std::sort(ticks.begin(), ticks.end());
+        u64 floor = CycleClock::overhead();
+        f64 ratio = CycleClock::ticksPerNs();
+        // nearest-rank percentile, with the timer's own cost taken off
+        auto at = [&](f64 p) {
+            u64 idx = std::max<u64>(std::ceil(p * ticks.size()), 1) - 1;
+            u64 t = ticks[idx];
+            return (t > floor ? t - floor : 0) / ratio;
+        };
+        res.p50 = at(0.5);
+        res.p90 = at(0.9);
+        res.p99 = at(0.99);
+        res.p999 = at(0.999);
+        res.max = at(1.0);
+        return res;
+    }
+
+    void write_json_string(std::ostream& out, const string& str) {
+        out << '"';
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out << ' ';
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    void BenchResult::writeJson(std::ostream& out, u32 indent) const {
+        string pad(indent, ' ');
+        auto num = [&](f64 x) -> std::ostream& {
+            return std::isfinite(x) ? out << x : out << "null";
+        };
+
+        auto precision = out.precision(9);
+        out << "{\n" << pad << "  \"name\": ";
+        write_json_string(out, name);
+        out << ",\n" << pad << "  \"ops\": " << ops << ",\n";
+
+        out << pad << "  \"trial_mops\": [";
+        for (u64 i = 0; i < mops.size(); ++i) {
+            num(mops[i]) << (i + 1 < mops.size() ? ", " : "");
+        }
+        out << "],\n";
+
+        out << pad << "  \"mops\": {\"median\": ";
+        num(tp.median) << ", \"mean\": ";
+        num(tp.mean) << ", \"stddev\": ";
+        num(tp.stddev) << ", \"min\": ";
+        num(tp.min) << ", \"max\": ";
+        num(tp.max) << "},\n";
+
+        out << pad << "  \"latency_ns\": ";
+        if (latency.samples == 0) {
+            out << "null,\n";
+        } else {
+            out << "{\"samples\": " << latency.samples << ", \"p50\": ";
+            num(latency.p50) << ", \"p90\": ";
+            num(latency.p90) << ", \"p99\": ";
+            num(latency.p99) << ", \"p999\": ";
+            num(latency.p999) << ", \"max\": ";
+            num(latency.max) << "},\n";
+        }
+
+        out << pad << "  \"counters_per_op\": {";
+        for (u32 i = 0; i < PerfCounters::NUM_EVENTS; ++i) {
+            out << '"' << PerfCounters::name(PerfCounters::Event(i)) << "\": ";
+            if (perOp[i] < 0) {
+                out << "null";
+            } else {
+                num(perOp[i]);
+            }
+            out << (i + 1 < PerfCounters::NUM_EVENTS ? ", " : "");
+        }
+        out << "}\n" << pad << "}";
+        out.precision(precision);
+    }
+
+    Benchmark::Benchmark(const BenchConfig& config_) : config(config_) { }
+
+    template <typename Op>
+    void Benchmark::loop(u64 begin, u64 end, Op& op, u64& sink) {
+        for (u64 i = begin; i < end; ++i) {
+            if constexpr (std::is_void_v<decltype(op(i))>) {
+                op(i);
+            } else {
+                sink += static_cast<u64>(op(i));
+            }
+        }
+    }
+
+    template <typename Setup, typename Op>
+    BenchResult Benchmark::run(const string& name, u64 ops, Setup&& setup,
+                               Op&& op) {
+        BenchResult res;
+        res.name = name;
+        res.ops = ops;
+
+        u64 sink = 0;
+        for (u32 i = 0; i < config.warmup; ++i) {
+            setup();
+            loop(0, ops, op, sink);
+        }
+
+        counters.reset();
+        for (u32 t = 0; t < config.trials; ++t) {
+            setup();
+            if (config.counters) {
+                counters.start();
+            }
+            auto start = steady_clock::now();
+            loop(0, ops, op, sink);
+            auto end = steady_clock::now();
+            if (config.counters) {
+                counters.stop();
+            }
+            f64 ns = duration_cast<nanoseconds>(end - start).count();
+            res.mops.push_back(ops * 1e3 / ns);
+        }
+
+        u64 every = config.sample_every;
+        vector<u64> ticks;
+        if (every != 0) {
+            // Operations are timed alone at jittered gaps averaging
+            // @c every, so that sampling does not alias with periodic work
+            // such as compactions.
+            ticks.reserve(ops / every + 1);
+            setup();
+            xorshift32 jitter(1);
+            for (u64 i = 0; i < ops; ++i) {
+                u64 gap = every / 2 + jitter() % every;
+                u64 end = std::min(ops, i + gap);
+                loop(i, end, op, sink);
+                if ((i = end) == ops) {
+                    break;
+                }
+                u64 c0 = CycleClock::start();
+                loop(i, i + 1, op, sink);
+                ticks.push_back(CycleClock::stop() - c0);
+            }
+        }
+
+        volatile u64 unused = sink;     // just for avoiding optimization
+        (void) unused;
+
+        res.tp = BenchSummary::of(res.mops);
+        res.latency = LatencySummary::of(std::move(ticks));
+        f64 total_ops = static_cast<f64>(ops) * config.trials;
+        for (u32 i = 0; i < PerfCounters::NUM_EVENTS; ++i) {
+            auto event = PerfCounters::Event(i);
+            res.perOp[i] = config.counters && counters.available(event)
+                           ? counters.total(event) / total_ops : -1;
+        }
+        return res;
+    }
+}   // namespace sketch
@@ -0,0 +1,54 @@
+#pragma once
+#include "../common/spsc_ring.hpp"
+#include "../common/trace_reader.hpp"
+#include "../framework/framework.hpp"
+
+namespace sketch {
+    /// @brief Counters of one pipelined run.
+    struct PipelineStats {
+        u64 items = 0;          ///< Appended items.
+        u64 batches = 0;        ///< Consumed batches.
+        f64 seconds = 0;        ///< End-to-end time, reading included.
+        u64 readerStalls = 0;   ///< Batches the reader had no room for.
+        u64 sketchStalls = 0;   ///< Batches the sketch had to wait for.
+        f64 avgDepth = 0;       ///< Mean queued batches seen by the sketch.
+        u32 maxDepth = 0;       ///< Max queued batches seen by the sketch.
+    };
+
+    /// @brief Streams a binary trace into a sketch. A reader thread decodes
+    ///        batches of items into a lock-free queue while the calling
+    ///        thread appends them, so reading and updating overlap.
+    /// @details Batches are recycled through a second queue, which keeps
+    ///          the steady state free of allocations.
+    class IngestPipeline {
+    public:
+        /// @brief Constructor.
+        /// @param dataset Dataset to stream, see @c TraceReader::streamable.
+        /// @param batch_size Items per batch.
+        /// @param depth Number of batches in flight.
+        IngestPipeline(const string& dataset, u32 batch_size = 4096,
+                       u32 depth = 16);
+
+        /// @brief Stream the whole trace into a sketch.
+        /// @param sketch Sketch to append to, on the calling thread, best
+        ///               of its final class so that appends bind statically.
+        template <typename Sketch>
+        PipelineStats run(Sketch& sketch);
+
+    private:
+        struct Batch {
+            vector<FlowItem> items;
+            u32 num;        ///< Valid items, 0 marks the end of the trace.
+        };
+
+        string dataset;         ///< Dataset to stream.
+        vector<Batch> pool;     ///< Batch storage.
+        SpscRing<u32> filled;   ///< Batches ready for the sketch.
+        SpscRing<u32> drained;  ///< Batches ready for the reader.
+
+        /// @brief Reader loop.
+        void produce(TraceReader& reader);
+    };
+}   // namespace sketch
+
+#include "ingest_pipeline_impl.hpp"
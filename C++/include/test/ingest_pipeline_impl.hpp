@@ -0,0 +1,76 @@
+#pragma once
+#include "ingest_pipeline.hpp"
+#include <thread>
+
+namespace sketch {
+    IngestPipeline::IngestPipeline(const string& dataset_, u32 batch_size,
+                                   u32 depth)
+        : dataset(dataset_), filled(depth), drained(depth) {
+        if (!TraceReader::streamable(dataset)) {
+            throw std::invalid_argument("dataset cannot be streamed");
+        }
+        if (batch_size == 0 || depth == 0) {
+            throw std::invalid_argument("batch size and depth must be positive");
+        }
+        pool = vector<Batch>(depth, Batch{vector<FlowItem>(batch_size), 0});
+        for (u32 i = 0; i < depth; ++i) {
+            drained.push(i);
+        }
+    }
+
+    template <typename Sketch>
+    PipelineStats IngestPipeline::run(Sketch& sketch) {
+        PipelineStats stats;
+        // The reader waits for drained batches, never for room in filled.
+        u64 reader_stalls = drained.popStalls();
+        u64 sketch_stalls = filled.popStalls();
+        u64 depth_sum = 0;
+
+        auto start = high_resolution_clock::now();
+        TraceReader reader(dataset);
+        std::thread producer(&IngestPipeline::produce, this,
+                             std::ref(reader));
+
+        while (true) {
+            u32 idx;
+            filled.pop(idx);
+            u32 depth = filled.depth() + 1;
+            depth_sum += depth;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+
+            const Batch& batch = pool[idx];
+            if (batch.num == 0) {
+                drained.push(idx);
+                break;
+            }
+            for (u32 i = 0; i < batch.num; ++i) {
+                sketch.append(batch.items[i].id, batch.items[i].value);
+            }
+            stats.items += batch.num;
+            ++stats.batches;
+            drained.push(idx);
+        }
+
+        producer.join();
+        auto end = high_resolution_clock::now();
+
+        stats.seconds = duration<f64>(end - start).count();
+        stats.readerStalls = drained.popStalls() - reader_stalls;
+        stats.sketchStalls = filled.popStalls() - sketch_stalls;
+        stats.avgDepth = static_cast<f64>(depth_sum) / (stats.batches + 1);
+        return stats;
+    }
+
+    void IngestPipeline::produce(TraceReader& reader) {
+        while (true) {
+            u32 idx;
+            drained.pop(idx);
+            Batch& batch = pool[idx];
+            batch.num = reader.read(batch.items.data(), batch.items.size());
+            filled.push(idx);
+            if (batch.num == 0) {
+                return;
+            }
+        }
+    }
+}   // namespace sketch
@@ -0,0 +1,83 @@
+#pragma once
+#include <memory>
+#include "../framework/bulk_query.hpp"
+#include "../framework/sharded/sharded_sketch.hpp"
+#include "benchmark.hpp"
+#include "sketch_test.hpp"
+
+namespace sketch {
+    /// @brief Appending and query benchmarks of every sketch model.
+    /// @details Each append trial starts from an empty sketch and appends
+    ///          the whole dataset. Queries then ask the filled sketch for
+    ///          the median of the evaluated flows, cycling through them.
+    ///          Bulk queries then ask for all of them at once with
+    ///          @c bulk_quantiles, one operation being one such call on a
+    ///          worker per hardware thread, after checking its results
+    ///          against per-flow queries. Everything else runs on the
+    ///          calling thread, which should be pinned by the caller, e.g.
+    ///          with taskset. With shards, each
+    ///          model is instead split into a @c ShardedSketch, the calling
+    ///          thread only ingests, on the first NUMA node, and a trial
+    ///          ends once every shard has applied its items.
+    template <typename META>
+    class SketchBench {
+    public:
+        /// @brief Constructor.
+        /// @param mem_limit_ Memory limit in bytes.
+        /// @param hash_num_ Number of hash functions per level,
+        ///                 used only by andor model.
+        /// @param seed_ Seed for generating hash functions.
+        /// @param dataset_ Dataset to be appended.
+        /// @param config_ Warmup, trials, sampling and counters.
+        /// @param andor_config_ Level layout of andor model.
+        /// @param models_ Sketch models to benchmark, by default all.
+        /// @param shards_ Shards splitting the memory limit, 0 for none.
+        SketchBench(u64 mem_limit_, u32 hash_num_, u32 seed_,
+                    const string& dataset_, double ddc_alpha_,
+                    const BenchConfig& config_ = BenchConfig(),
+                    const AndorConfig& andor_config_ = AndorConfig(),
+                    const vector<u32>& models_ =
+                        SketchTest<META>::all_models(),
+                    u32 shards_ = 0);
+
+        /// @brief Run the benchmarks.
+        void run();
+
+        /// @brief Write the settings and results as a JSON object.
+        /// @param meta Name of the meta sketch.
+        void writeJson(std::ostream& out, const string& meta) const;
+
+    private:
+        u64 mem_limit;      ///< Memory limit.
+        u32 hash_num;       ///< Number of hash functions per level.
+        u32 seed;           ///< Seed for generating hash functions.
+        string dataset;     ///< Dataset to be appended.
+        double ddc_alpha;
+        AndorConfig andor_config;   ///< Level layout of andor model.
+        vector<u32> models; ///< Sketch models to benchmark.
+        u32 shards;         ///< Shards of each model, 0 for none.
+
+        Benchmark bench;
+        vector<BenchResult> results;    ///< Appending, query then bulk
+                                        ///< query result of each model.
+        /// Per-node counters of the last appending trial of each model,
+        /// when sharded.
+        vector<vector<NodeStats>> node_stats;
+
+        /// @brief Benchmark a model split into shards.
+        void runSharded(u32 model, const vector<FlowItem>& items,
+                        const vec_u32& ids, u64 query_ops);
+
+        /// @brief Benchmark bulk queries of every evaluated flow.
+        /// @throw std::runtime_error if a bulk result differs from the
+        ///        per-flow query of the same flow.
+        void runBulk(const string& name, const Framework& sketch,
+                     const vec_u32& ids, ThreadPool& pool);
+
+        /// Least queries per trial, so that small datasets are still
+        /// timed over a meaningful interval.
+        static constexpr u64 min_query_ops = 1 << 20;
+    };
+}   // namespace sketch
+
+#include "sketch_bench_impl.hpp"
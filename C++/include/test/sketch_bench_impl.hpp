@@ -0,0 +1,192 @@
+#pragma once
+#include "sketch_bench.hpp"
+
+namespace sketch {
+    template <typename META>
+    SketchBench<META>::SketchBench(u64 mem_limit_, u32 hash_num_, u32 seed_,
+                                   const string& dataset_, double ddc_alpha_,
+                                   const BenchConfig& config_,
+                                   const AndorConfig& andor_config_,
+                                   const vector<u32>& models_,
+                                   u32 shards_)
+        : mem_limit(mem_limit_), hash_num(hash_num_), seed(seed_),
+          dataset(dataset_), ddc_alpha(ddc_alpha_),
+          andor_config(andor_config_), models(models_), shards(shards_),
+          bench(config_) { }
+
+    template <typename META>
+    void SketchBench<META>::run() {
+        auto items = load_dataset(dataset);
+
+        vec_u32 ids;
+        {
+            ThreadPool pool;
+            GroundTruth truth(items, pool);
+            for (const auto& flow : truth.flows()) {
+                ids.push_back(flow.id);
+            }
+        }
+        if (ids.empty()) {
+            throw std::runtime_error("no flow to query");
+        }
+        u64 query_ops = (min_query_ops + ids.size() - 1) / ids.size()
+                        * ids.size();
+
+        cout << "mem_limit: " << (mem_limit / 1024) << "KB" << endl;
+
+        ThreadPool pool;
+        results.clear();
+        node_stats.clear();
+        for (u32 m : models) {
+            string name = model_name(m);
+            cout << "Benchmarking " << name << "..." << endl;
+            if (shards != 0) {
+                runSharded(m, items, ids, query_ops);
+                continue;
+            }
+
+            // The framework class is picked once here, so that timed
+            // operations call it without virtual dispatch.
+            dispatch_model<META>(m, [&](auto tag) {
+                using Sketch = typename decltype(tag)::type;
+                std::unique_ptr<Sketch> sketch;
+
+                results.push_back(bench.run(name + "/append", items.size(),
+                    [&] {
+                        sketch.reset(static_cast<Sketch*>(create_model<META>(
+                            m, mem_limit, hash_num, seed, ddc_alpha,
+                            andor_config)));
+                    },
+                    [&](u64 i) {
+                        sketch->append(items[i].id, items[i].value);
+                    }));
+
+                // the sketch of the last appending trial stays filled
+                results.push_back(bench.run(name + "/query", query_ops,
+                    [] { },
+                    [&](u64 i) {
+                        return sketch->quantile(ids[i % ids.size()],
+                                                GroundTruth::given_p);
+                    }));
+
+                runBulk(name, *sketch, ids, pool);
+            });
+        }
+        cout << "Benchmark finished" << endl;
+    }
+
+    template <typename META>
+    void SketchBench<META>::runSharded(u32 model,
+                                       const vector<FlowItem>& items,
+                                       const vec_u32& ids, u64 query_ops) {
+        NumaTopology topo;
+        topo.pinToNode(0);
+
+        string name = string(model_name(model)) + "/sharded";
+        std::unique_ptr<ShardedSketch> sketch;
+        ShardedSketch::Factory create = [&](u32) {
+            return create_model<META>(model, mem_limit / shards, hash_num,
+                                      seed, ddc_alpha, andor_config);
+        };
+
+        // the last item waits for the shards, so that a trial times them
+        // draining their batches too
+        results.push_back(bench.run(name + "/append", items.size(),
+            [&] {
+                sketch.reset();
+                sketch.reset(new ShardedSketch(shards, create, topo));
+            },
+            [&](u64 i) {
+                sketch->append(items[i].id, items[i].value);
+                if (i + 1 == items.size()) {
+                    sketch->flush();
+                }
+            }));
+        node_stats.push_back(sketch->nodeStats());
+
+        results.push_back(bench.run(name + "/query", query_ops,
+            [] { },
+            [&](u64 i) {
+                return sketch->quantile(ids[i % ids.size()],
+                                        GroundTruth::given_p);
+            }));
+
+        for (const NodeStats& stats : node_stats.back()) {
+            cout << "  node " << stats.node << ": " << stats.shards
+                 << " shards, " << stats.items << " items, "
+                 << (stats.seconds > 0 ? stats.items / stats.seconds / 1e6
+                                       : 0)
+                 << " Mops per owner, heap " << (stats.heap / 1024)
+                 << " KB, resident " << (stats.resident / 1024) << " KB"
+                 << endl;
+        }
+    }
+
+    template <typename META>
+    void SketchBench<META>::runBulk(const string& name,
+                                    const Framework& sketch,
+                                    const vec_u32& ids, ThreadPool& pool) {
+        const f64 rank = GroundTruth::given_p;
+        vec_u32 out(ids.size());
+        bulk_quantiles(pool, sketch, ids.data(), ids.size(), &rank, 1,
+                       out.data());
+        for (u64 i = 0; i < ids.size(); ++i) {
+            if (out[i] != sketch.quantile(ids[i], rank)) {
+                throw std::runtime_error(
+                    "bulk query differs from the per-flow query");
+            }
+        }
+
+        u64 calls = std::max<u64>(min_query_ops / ids.size(), 1);
+        results.push_back(bench.run(name + "/bulk_query", calls, [] { },
+            [&](u64) {
+                bulk_quantiles(pool, sketch, ids.data(), ids.size(), &rank,
+                               1, out.data());
+                return out[0];
+            }));
+    }
+
+    template <typename META>
+    void SketchBench<META>::writeJson(std::ostream& out,
+                                      const string& meta) const {
+        const BenchConfig& config = bench.settings();
+        out << "{\n  \"meta\": ";
+        write_json_string(out, meta);
+        out << ",\n  \"dataset\": ";
+        write_json_string(out, dataset);
+        out << ",\n  \"memory_kb\": " << (mem_limit / 1024)
+            << ",\n  \"hash_num\": " << hash_num
+            << ",\n  \"hash\": \"" << HashFamily::name(HashFamily::selected())
+            << "\""
+            << ",\n  \"seed\": " << seed
+            << ",\n  \"warmup\": " << config.warmup
+            << ",\n  \"trials\": " << config.trials
+            << ",\n  \"sample_every\": " << config.sample_every
+            << ",\n  \"ticks_per_ns\": " << CycleClock::ticksPerNs()
+            << ",\n  \"shards\": " << shards
+            << ",\n  \"results\": [";
+        for (u64 i = 0; i < results.size(); ++i) {
+            out << (i ? ", " : "");
+            results[i].writeJson(out, 2);
+        }
+        out << "]";
+        if (shards != 0) {
+            out << ",\n  \"nodes\": [";
+            for (u64 i = 0; i < node_stats.size(); ++i) {
+                for (u64 j = 0; j < node_stats[i].size(); ++j) {
+                    const NodeStats& stats = node_stats[i][j];
+                    out << (i || j ? ",\n    " : "\n    ") << "{\"model\": ";
+                    write_json_string(out, model_name(models[i]));
+                    out << ", \"node\": " << stats.node
+                        << ", \"shards\": " << stats.shards
+                        << ", \"items\": " << stats.items
+                        << ", \"seconds\": " << stats.seconds
+                        << ", \"heap\": " << stats.heap
+                        << ", \"resident\": " << stats.resident << "}";
+                }
+            }
+            out << "\n  ]";
+        }
+        out << "\n}\n";
+    }
+}   // namespace sketch
@@ -0,0 +1,54 @@
+#pragma once
+#include "../framework/andor/andor_sketch.hpp"
+#include "../framework/dleft/dleft_sketch.hpp"
+#include "../framework/cuckoo/cuckoo.hpp"
+#include "../framework/bcuckoo/bcuckoo.hpp"
+
+namespace sketch {
+    // Drivers pick the META and the framework at run time, and dispatch
+    // here once per run, so that per-item loops bind every call statically.
+
+    /// @brief A type, passed to functions dispatched on it.
+    template <typename T>
+    struct TypeTag {
+        using type = T;
+    };
+
+    /// @brief Return the name of a META model, as given on command lines.
+    const char* meta_name(u32 meta);
+
+    /// @brief Return the META model of a given name.
+    /// @throw std::invalid_argument if the name is unknown.
+    MetaModel parse_meta(const string& name);
+
+    /// @brief Return the name of a sketch model, as given on command lines.
+    const char* model_name(u32 model);
+
+    /// @brief Return the sketch model of a given name.
+    /// @throw std::invalid_argument if the name is unknown.
+    SketchModel parse_model(const string& name);
+
+    /// @brief Call @p f with the @c TypeTag of a META model.
+    /// @param meta META model, one of @c MetaModel.
+    /// @throw std::invalid_argument if the model is unknown.
+    template <typename F>
+    decltype(auto) dispatch_meta(u32 meta, F&& f);
+
+    /// @brief Call @p f with the @c TypeTag of the framework class of a
+    ///        sketch model.
+    /// @param model Sketch model, one of @c SketchModel.
+    /// @throw std::invalid_argument if the model is unknown.
+    template <typename META, typename F>
+    decltype(auto) dispatch_model(u32 model, F&& f);
+
+    /// @brief Call @p f with a sketch cast to its framework class.
+    /// @details Frameworks are final, so calls made by @p f on the cast
+    ///          sketch are not virtual.
+    /// @param model Sketch model the sketch was created as, one of
+    ///              @c SketchModel.
+    /// @throw std::invalid_argument if the model is unknown.
+    template <typename META, typename F>
+    decltype(auto) visit_model(u32 model, Framework& sketch, F&& f);
+}   // namespace sketch
+
+#include "sketch_dispatch_impl.hpp"
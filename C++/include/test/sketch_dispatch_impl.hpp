@@ -0,0 +1,85 @@
+#pragma once
+#include "sketch_dispatch.hpp"
+#include <stdexcept>
+
+namespace sketch {
+    constexpr const char* meta_names[NUM_METAS] = {
+        "dd", "mreq", "tdigest", "ddc"
+    };
+
+    constexpr const char* model_names[NUM_MODELS] = {
+        "andor", "dleft", "cuckoo", "bcuckoo"
+    };
+
+    const char* meta_name(u32 meta) {
+        if (meta >= NUM_METAS) {
+            throw std::invalid_argument("unknown META model");
+        }
+        return meta_names[meta];
+    }
+
+    MetaModel parse_meta(const string& name) {
+        for (u32 i = 0; i < NUM_METAS; ++i) {
+            if (name == meta_names[i]) {
+                return static_cast<MetaModel>(i);
+            }
+        }
+        throw std::invalid_argument("unknown META model");
+    }
+
+    const char* model_name(u32 model) {
+        if (model >= NUM_MODELS) {
+            throw std::invalid_argument("unknown sketch model");
+        }
+        return model_names[model];
+    }
+
+    SketchModel parse_model(const string& name) {
+        for (u32 i = 0; i < NUM_MODELS; ++i) {
+            if (name == model_names[i]) {
+                return static_cast<SketchModel>(i);
+            }
+        }
+        throw std::invalid_argument("unknown sketch model");
+    }
+
+    template <typename F>
+    decltype(auto) dispatch_meta(u32 meta, F&& f) {
+        switch (meta) {
+        case DD:
+            return f(TypeTag<DDSketch>());
+        case MREQ:
+            return f(TypeTag<mReqSketch>());
+        case TD:
+            return f(TypeTag<TDigest>());
+        case DDC:
+            return f(TypeTag<DDCSketch>());
+        default:
+            throw std::invalid_argument("unknown META model");
+        }
+    }
+
+    template <typename META, typename F>
+    decltype(auto) dispatch_model(u32 model, F&& f) {
+        switch (model) {
+        case ANDOR:
+            return f(TypeTag<AndorSketch<META>>());
+        case DLEFT:
+            return f(TypeTag<DLeftSketch<META>>());
+        case CUCKOO:
+            return f(TypeTag<Cuckoo<META>>());
+        case BCUCKOO:
+            return f(TypeTag<BCuckoo<META>>());
+        default:
+            throw std::invalid_argument("unknown sketch model");
+        }
+    }
+
+    template <typename META, typename F>
+    decltype(auto) visit_model(u32 model, Framework& sketch, F&& f) {
+        return dispatch_model<META>(model, [&](auto tag) -> decltype(auto) {
+            using Sketch = typename decltype(tag)::type;
+            return f(static_cast<Sketch&>(sketch));
+        });
+    }
+}   // namespace sketch
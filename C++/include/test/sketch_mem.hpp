@@ -0,0 +1,64 @@
+#pragma once
+#include <ostream>
+#include "../common/mem_usage.hpp"
+#include "sketch_test.hpp"
+
+namespace sketch {
+    /// @brief Memory a sketch model uses after appending a dataset.
+    struct MemUsage {
+        u32 model;          ///< Sketch model, one of @c SketchModel.
+        u64 modeled;        ///< Modeled budget, see @c Framework::memory.
+        u64 heap;           ///< Bytes reported by @c Framework::heapBytes.
+        /// Growth of @c HeapTracker::liveBytes, 0 if it is not enabled.
+        u64 tracked;
+        i64 rss;            ///< Growth of the resident set size.
+        HugePages::Backing backing;     ///< Pages of the bucket arrays.
+    };
+
+    /// @brief Cross-check of the memory every sketch model reports against
+    ///        what the process actually allocates.
+    /// @details Models are built one after another on the calling thread,
+    ///          each after freed memory is returned to the system, so that
+    ///          the growth of the heap and of RSS is the sketch's own. RSS
+    ///          counts touched pages only, and both include the dataset
+    ///          loaded before, so only the growth is reported.
+    template <typename META>
+    class SketchMemCheck {
+    public:
+        /// @brief Constructor.
+        /// @param mem_limit_ Memory limit in bytes.
+        /// @param hash_num_ Number of hash functions per level,
+        ///                  used only by andor model.
+        /// @param seed_ Seed for generating hash functions.
+        /// @param dataset_ Dataset to be appended.
+        /// @param andor_config_ Level layout of andor model.
+        /// @param models_ Sketch models to check, by default all.
+        SketchMemCheck(u64 mem_limit_, u32 hash_num_, u32 seed_,
+                       const string& dataset_, double ddc_alpha_,
+                       const AndorConfig& andor_config_ = AndorConfig(),
+                       const vector<u32>& models_ =
+                           SketchTest<META>::all_models());
+
+        /// @brief Build and fill every model, measuring its memory.
+        void run();
+
+        /// @brief Return the measurements, one per model.
+        const vector<MemUsage>& results() const { return usages; }
+
+        /// @brief Write the settings and measurements as text.
+        void write(std::ostream& out) const;
+
+    private:
+        u64 mem_limit;      ///< Memory limit.
+        u32 hash_num;       ///< Number of hash functions per level.
+        u32 seed;           ///< Seed for generating hash functions.
+        string dataset;     ///< Dataset to be appended.
+        double ddc_alpha;
+        AndorConfig andor_config;   ///< Level layout of andor model.
+        vector<u32> models; ///< Sketch models to check.
+
+        vector<MemUsage> usages;    ///< Measurement of each model.
+    };
+}   // namespace sketch
+
+#include "sketch_mem_impl.hpp"
@@ -0,0 +1,82 @@
+#pragma once
+#include "sketch_mem.hpp"
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+namespace sketch {
+    template <typename META>
+    SketchMemCheck<META>::SketchMemCheck(u64 mem_limit_, u32 hash_num_,
+                                         u32 seed_, const string& dataset_,
+                                         double ddc_alpha_,
+                                         const AndorConfig& andor_config_,
+                                         const vector<u32>& models_)
+        : mem_limit(mem_limit_), hash_num(hash_num_), seed(seed_),
+          dataset(dataset_), ddc_alpha(ddc_alpha_),
+          andor_config(andor_config_), models(models_) { }
+
+    template <typename META>
+    void SketchMemCheck<META>::run() {
+        auto items = load_dataset(dataset);
+
+        cout << "mem_limit: " << (mem_limit / 1024) << "KB" << endl;
+
+        usages.clear();
+        usages.reserve(models.size());
+        for (u32 m : models) {
+            cout << "Measuring " << model_name(m) << "..." << endl;
+
+            trim_heap();
+            u64 live = HeapTracker::liveBytes();
+            u64 rss = rss_bytes();
+
+            std::unique_ptr<Framework> sketch(create_model<META>(
+                m, mem_limit, hash_num, seed, ddc_alpha, andor_config));
+            visit_model<META>(m, *sketch, [&](auto& fw) {
+                for (const auto& item : items) {
+                    fw.append(item.id, item.value);
+                }
+            });
+
+            MemUsage usage;
+            usage.model = m;
+            usage.modeled = sketch->memory();
+            usage.heap = sketch->heapBytes();
+            usage.tracked = HeapTracker::liveBytes() - live;
+            usage.rss = static_cast<i64>(rss_bytes()) - static_cast<i64>(rss);
+            usage.backing = sketch->backing();
+            usages.push_back(usage);
+        }
+        cout << "Measurement finished" << endl;
+    }
+
+    template <typename META>
+    void SketchMemCheck<META>::write(std::ostream& out) const {
+        out << "memory: " << (mem_limit / 1024) << " KB" << endl;
+        out << "dataset: " << dataset << endl;
+        out << "hash_num: " << hash_num << endl;
+        out << "seed: " << seed << endl;
+        out << "heap tracking: "
+            << (HeapTracker::enabled() ? "on" : "off") << endl;
+        out << endl;
+
+        auto kb = [](f64 bytes) {
+            std::ostringstream s;
+            s << std::fixed << std::setprecision(1) << bytes / 1024 << " KB";
+            return s.str();
+        };
+        for (const MemUsage& usage : usages) {
+            string name = model_name(usage.model);
+            out << "Modeled of " << name << ": " << kb(usage.modeled) << endl;
+            out << "Heap of " << name << ": " << kb(usage.heap) << endl;
+            if (HeapTracker::enabled()) {
+                out << "Tracked of " << name << ": " << kb(usage.tracked)
+                    << endl;
+            }
+            out << "RSS of " << name << ": " << kb(usage.rss) << endl;
+            out << "Pages of " << name << ": "
+                << HugePages::name(usage.backing) << endl;
+        }
+        out << endl;
+    }
+}   // namespace sketch
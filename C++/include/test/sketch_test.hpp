@@ -1,55 +1,165 @@
 #pragma once
-#include <unordered_set>
 #include "../common/real_dist.hpp"
+#include "../common/thread_pool.hpp"
 #include "../framework/framework.hpp"
+#include "../framework/andor/andor_config.hpp"
+#include "ingest_pipeline.hpp"
+#include "sketch_dispatch.hpp"
 
 namespace sketch {
+    /// @brief Ground truth of a dataset, shared read-only by all trials.
+    class GroundTruth {
+    public:
+        /// Flow types evaluated, tiny flows are not queried.
+        static constexpr u32 eval_types = MID | HUGE;
+
+        /// Given percentage, used when calculating ALE and APE.
+        static constexpr f64 given_p = 0.5;
+
+        /// @brief A flow of @c eval_types.
+        struct Flow {
+            u32 id;         ///< Flow ID.
+            FlowType type;  ///< Real flow type.
+            u32 real;       ///< Real quantile at @c given_p.
+        };
+
+        /// @brief Build the ground truth of a dataset.
+        /// @param dataset Items of all flows.
+        /// @param pool Workers building the real distribution.
+        GroundTruth(const vector<FlowItem>& dataset, ThreadPool& pool);
+
+        /// Expected number of values a streamed synthetic spec is sampled
+        /// down to, 512 MB of them.
+        static constexpr u64 max_items = u64(1) << 27;
+
+        /// @brief Build the ground truth of a binary trace, streaming it.
+        /// @details A synthetic spec of more than @c max_items items only
+        ///          records the flows of a fixed sample, seeded by the spec,
+        ///          so that traces of any length fit in memory. Sampled
+        ///          flows keep all their values, and the accuracy metrics
+        ///          average over them alone.
+        /// @param dataset Dataset name, see @c TraceReader::streamable.
+        /// @param pool Workers building the real distribution.
+        GroundTruth(const string& dataset, ThreadPool& pool);
+
+        /// @brief Return the real distribution.
+        const real_dist& dist() const { return real; }
+
+        /// @brief Return the evaluated flows in ascending ID order.
+        const vector<Flow>& flows() const { return evalFlows; }
+
+        /// @brief Return the expected share of the flows recorded.
+        f64 sample() const { return share; }
+
+    private:
+        f64 share = 1;              ///< Expected share of flows recorded.
+        real_dist real;             ///< Real distribution.
+        vector<Flow> evalFlows;     ///< Flows of @c eval_types.
+
+        /// @brief Return the share of flows to record of a dataset.
+        static f64 sample_of(const string& dataset);
+
+        /// @brief Collect the evaluated flows and their real quantiles.
+        void evaluate(ThreadPool& pool);
+    };
+
+    /// @brief Create a sketch model.
+    /// @param model Sketch model, one of @c SketchModel.
+    /// @param mem_limit Memory limit in bytes.
+    /// @param hash_num Number of hash functions per level, used only by
+    ///                 andor model.
+    /// @param seed Seed for generating hash functions.
+    /// @param andor_config Level layout, used only by andor model.
+    /// @throw std::invalid_argument if the model is unknown.
+    template <typename META>
+    Framework* create_model(u32 model, u64 mem_limit, u32 hash_num, u32 seed,
+                            double ddc_alpha,
+                            const AndorConfig& andor_config = AndorConfig());
+
+    /// @brief A single trial: one model built, appended and evaluated.
+    /// @details Appends and timed queries run on the calling thread. The
+    ///          accuracy pass, @c estimate, is untimed and may run apart
+    ///          from them, on another instance built the same way.
     template <typename META>
     class SketchSingleTest {
     public:
         /// @brief Constructor.
+        /// @param model Sketch model, one of @c SketchModel.
         /// @param mem_limit Memory limit in bytes.
         /// @param hash_num Number of hash functions per level.
         /// @param seed Seed for generating hash functions.
-        /// @param dataset Dataset to be tested.
-        SketchSingleTest(u64 mem_limit, u32 hash_num, u32 seed,
-                         const vector<FlowItem>& dataset, double ddc_alpha_);
+        /// @param andor_config Level layout, used only by andor model.
+        SketchSingleTest(u32 model, u64 mem_limit, u32 hash_num, u32 seed,
+                         double ddc_alpha_,
+                         const AndorConfig& andor_config = AndorConfig());
 
         ~SketchSingleTest();
 
-        /// @brief Calculate ALE of a given model on a given flow type.
-        f64 ALE(u32 model, u32 type) const;
-        /// @brief Calculate APE of a given model on a given flow type.
-        f64 APE(u32 model, u32 type) const;
-        f64 AAE(u32 model, u32 type) const;
-        f64 ARE(u32 model, u32 type) const;
-        /// @brief Calculate appending throughput of a given model in Mops.
-        f64 appendTp(u32 model) const;
-        /// @brief Calculate query throughput of a given model in Mops.
-        f64 queryTp(u32 model) const;
+        SketchSingleTest(const SketchSingleTest&) = delete;
+        SketchSingleTest& operator=(const SketchSingleTest&) = delete;
 
-    private:
-        Framework* models[NUM_MODELS];  ///< Sketch models.
-        real_dist real;                 ///< Real distribution.
+        /// @brief Append a dataset and measure appending throughput.
+        void append(const vector<FlowItem>& dataset);
 
-        std::unordered_set<u32> id_list;    ///< List of flow id.
+        /// @brief Stream the dataset through a pipeline, so that appending
+        ///        throughput includes reading the trace.
+        void append(IngestPipeline& pipeline);
 
-        f64 append_tp[NUM_MODELS];     ///< Appending throughput.
+        /// @brief Estimate every evaluated flow for the accuracy metrics,
+        ///        untimed.
+        /// @param truth Ground truth of the appended dataset, which must
+        ///              outlive the trial.
+        /// @param pool Workers to spread the queries over, @c nullptr to
+        ///             query on the calling thread.
+        void estimate(const GroundTruth& truth, ThreadPool* pool = nullptr);
 
-        /// Given percentage, used when calculating ALE and APE.
-        static constexpr f64 given_p = 0.5;
+        /// @brief Query every evaluated flow ten times on the calling
+        ///        thread and measure query throughput.
+        void timeQueries(const GroundTruth& truth);
+
+        /// @brief Both @c estimate over a pool and @c timeQueries.
+        void evaluate(const GroundTruth& truth, ThreadPool& pool);
 
-        /// @brief Return the type of a given flow.
-        /// @param id Flow ID.
-        FlowType getType(u32 id) const;
+        /// @brief Calculate ALE on a given flow type.
+        /// @param type Flow types, a subset of @c GroundTruth::eval_types.
+        f64 ALE(u32 type) const;
+        /// @brief Calculate APE on a given flow type.
+        f64 APE(u32 type) const;
+        f64 AAE(u32 type) const;
+        f64 ARE(u32 type) const;
+        /// @brief Return appending throughput in Mops.
+        f64 appendTp() const { return append_tp; }
+        /// @brief Return query throughput in Mops.
+        f64 queryTp() const { return query_tp; }
 
-        f64 FlowALE(const Framework* sketch, u32 id) const;
+    private:
+        using Flow = GroundTruth::Flow;
 
-        f64 FlowAPE(const Framework* sketch, u32 id) const;
+        /// @brief Estimate of a flow at @c GroundTruth::given_p.
+        struct FlowEst {
+            u32 est;        ///< Estimated quantile.
+            f64 estRank;    ///< Real normalized rank of @c est.
+        };
 
-        f64 FlowAAE(const Framework* sketch, u32 id) const;
+        u32 model;                          ///< Sketch model under test.
+        Framework* sketch;                  ///< Sketch under test.
+        const GroundTruth* truth = nullptr; ///< Ground truth evaluated on.
+        vector<FlowEst> ests;               ///< Estimate of each flow of
+                                            ///< @c truth.
+        f64 append_tp = 0;                  ///< Appending throughput.
+        f64 query_tp = 0;                   ///< Query throughput.
 
-        f64 FlowARE(const Framework* sketch, u32 id) const;
+        /// @brief Average a per-flow error over the flows of given types.
+        template <typename F>
+        f64 average(u32 type, F&& flow_error) const;
+
+        static f64 FlowALE(const Flow& flow, const FlowEst& est);
+
+        static f64 FlowAPE(const Flow& flow, const FlowEst& est);
+
+        static f64 FlowAAE(const Flow& flow, const FlowEst& est);
+
+        static f64 FlowARE(const Flow& flow, const FlowEst& est);
     };
 
     template <typename META>
@@ -62,13 +172,55 @@ namespace sketch {
         /// @param seed_ Seed for generating hash functions.
         /// @param dataset_ Dataset to be tested.
         /// @param repeat_time_ Number of times to repeat the test.
+        /// @param pipeline_ Whether to stream the dataset while appending
+        ///                  instead of loading it up front.
+        /// @param worker_num_ Workers building the ground truth and
+        ///                    evaluating accuracy, by default one per
+        ///                    hardware thread.
+        /// @param andor_config_ Level layout of andor model.
+        /// @param models_ Sketch models to test, by default all of them.
         SketchTest(u64 mem_limit_, u32 hash_num_, u32 seed_,
                   const string& dataset_,
-                  u32 repeat_time_, double ddc_alpha_);
+                  u32 repeat_time_, double ddc_alpha_,
+                  bool pipeline_ = false,
+                  u32 worker_num_ = std::thread::hardware_concurrency(),
+                  const AndorConfig& andor_config_ = AndorConfig(),
+                  const vector<u32>& models_ = all_models());
 
-        /// @brief Run the test.
+        /// @brief Run the test on its own.
+        /// @details Every repeat of every model is a trial, split into an
+        ///          untimed part, see @c accuracyJobs, and a timed one, see
+        ///          @c timeTrials. The dataset and its ground truth are
+        ///          loaded once for all of them, and the untimed parts run
+        ///          concurrently on workers pinned to their own CPUs.
         void run();
 
+        /// @brief Return the untimed part of every trial, each a job that
+        ///        builds the sketch of the trial, appends the dataset and
+        ///        estimates the evaluated flows on the thread it runs on.
+        /// @details Jobs share nothing but their read-only inputs, so that
+        ///          those of every repeat, model and META may run at once.
+        /// @param dataset Dataset, which must outlive the jobs.
+        /// @param truth Its ground truth, which must outlive the test.
+        vector<std::function<void()>> accuracyJobs(
+            const vector<FlowItem>& dataset, const GroundTruth& truth);
+
+        /// @brief Run the timed part of every trial and summarize, after
+        ///        the jobs of @c accuracyJobs.
+        /// @details Each trial builds its sketch again, the same as the
+        ///          one of its job, and times appending the dataset and
+        ///          querying. Trials run one after another on the calling
+        ///          thread, pinned to the CPU the idle @p pool reserves, so
+        ///          that no other trial shares its core or caches.
+        void timeTrials(const vector<FlowItem>& dataset,
+                        const GroundTruth& truth, ThreadPool& pool);
+
+        /// @brief Return every sketch model.
+        static vector<u32> all_models();
+
+        /// @brief Return the sketch models tested.
+        const vector<u32>& tested() const { return models; }
+
         /// @brief Calculate ALE of a given model.
         f64 ALE(u32 model) const;
         /// @brief Calculate APE of a given model.
@@ -81,17 +233,53 @@ namespace sketch {
         f64 queryTp(u32 model) const;
 
     private:
+        /// @brief Metrics of a finished trial.
+        struct TrialMetrics {
+            f64 ale, ape, aae, are;
+            f64 append_tp, query_tp;
+        };
+
         u64 mem_limit;      ///< Memory limit.
         u32 hash_num;       ///< Number of hash functions per level.
         u32 seed;           ///< Seed for generating hash functions.
         string dataset;     ///< Dataset to be tested.
         u32 repeat;         ///< Number of times to repeat the test.
         double ddc_alpha;
+        bool pipeline;      ///< Whether to stream the dataset.
+        u32 worker_num;     ///< Workers of the untimed passes.
+        AndorConfig andor_config;   ///< Level layout of andor model.
+        vector<u32> models; ///< Sketch models to test.
+
+        f64 m_ALE[NUM_MODELS] = {}, m_APE[NUM_MODELS] = {};
+        f64 m_AAE[NUM_MODELS] = {}, m_ARE[NUM_MODELS] = {};
+        f64 m_appendTp[NUM_MODELS] = {}, m_queryTp[NUM_MODELS] = {};
+
+        /// Metrics of each trial, repeat-major, see @c trialModel.
+        vector<TrialMetrics> trials;
+
+        /// @brief Run the test streaming the dataset through a pipeline.
+        /// @details Trials run one after another, as they share the
+        ///          pipeline.
+        void runPipeline();
+
+        /// Distance between seeds of consecutive repeats. D-left uses the
+        /// seed itself as the first of its hash function indices, so the
+        /// stride keeps repeats from sharing hash functions.
+        static constexpr u32 seed_stride = 8;
+
+        /// @brief Return the seed of a given repeat.
+        /// @details Repeat 0 uses @c seed itself, so that a single repeat
+        ///          reproduces earlier results.
+        u32 repeatSeed(u32 r) const;
+
+        /// @brief Return the model of a given trial.
+        u32 trialModel(u32 t) const { return models[t % models.size()]; }
 
-        f64 m_ALE[NUM_MODELS], m_APE[NUM_MODELS], m_AAE[NUM_MODELS], m_ARE[NUM_MODELS];
-        f64 m_appendTp[NUM_MODELS], m_queryTp[NUM_MODELS];
+        /// @brief Return a new trial of a given index, not appended yet.
+        std::unique_ptr<SketchSingleTest<META>> makeTrial(u32 t) const;
 
-        void addMetrics(const SketchSingleTest<META>& test);
+        static TrialMetrics metrics(const SketchSingleTest<META>& test);
+        /// @brief Average @c trials over the repeats of each model.
         void summarize();
     };
 }   // namespace sketch
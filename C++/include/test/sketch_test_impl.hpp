@@ -1,168 +1,236 @@
 #pragma once
 #include "sketch_test.hpp"
 #include <cmath>
-#include "../framework/andor/andor_sketch.hpp"
-#include "../framework/dleft/dleft_sketch.hpp"
-#include "../framework/cuckoo/cuckoo.hpp"
+#include <sstream>
 
 namespace sketch {
-    template <typename META>
-    SketchSingleTest<META>::SketchSingleTest(u64 mem_limit, u32 hash_num,
-                                             u32 seed,
-                                             const vector<FlowItem>& dataset,
-                                             double ddc_alpha) {
-        models[ANDOR] = new AndorSketch<META>(mem_limit, hash_num, seed, ddc_alpha);
-        models[DLEFT] = new DLeftSketch<META>(mem_limit, seed, ddc_alpha);
-        models[CUCKOO] = new Cuckoo<META>(mem_limit, seed, ddc_alpha);
-        
-        // append all items to real
-        for (auto [id, value] : dataset) {
-            real.append(id, value);
-            id_list.insert(id);
-        }
-
-        f64 size = static_cast<f64>(dataset.size());
-
-        // append all items to models and calculate appending throughput
-        for (u32 i = 0; i < NUM_MODELS; ++i) {
-            auto start = high_resolution_clock::now();
-            for (auto [id, value] : dataset) {
-                models[i]->append(id, value);
+    GroundTruth::GroundTruth(const vector<FlowItem>& dataset, ThreadPool& pool)
+        : real(dataset, pool) {
+        evaluate(pool);
+    }
+
+    GroundTruth::GroundTruth(const string& dataset, ThreadPool& pool)
+        : share(sample_of(dataset)),
+          real(dataset, pool, share,
+               share < 1 ? SyntheticConfig::parse(dataset).seed : 0) {
+        evaluate(pool);
+    }
+
+    f64 GroundTruth::sample_of(const string& dataset) {
+        if (!SyntheticConfig::isSpec(dataset)) {
+            return 1;
+        }
+        u64 items = SyntheticConfig::parse(dataset).items;
+        return items <= max_items ? 1 : static_cast<f64>(max_items) / items;
+    }
+
+    void GroundTruth::evaluate(ThreadPool& pool) {
+        for (u32 id : real.flows()) {
+            FlowType type = real.type(id);
+            if (type & eval_types) {
+                evalFlows.push_back({id, type, 0});
             }
-            auto end = high_resolution_clock::now();
-            auto duration = duration_cast<microseconds>(end - start);
-            append_tp[i] = size / duration.count();
         }
+
+        pool.parallelFor(evalFlows.size(), 256, [this](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; ++i) {
+                evalFlows[i].real = real.quantile(evalFlows[i].id, given_p);
+            }
+        });
     }
 
     template <typename META>
-    SketchSingleTest<META>::~SketchSingleTest() {
-        delete models[ANDOR];
-        delete models[DLEFT];
-        delete models[CUCKOO];
+    Framework* create_model(u32 model, u64 mem_limit, u32 hash_num, u32 seed,
+                            double ddc_alpha,
+                            const AndorConfig& andor_config) {
+        switch (model) {
+        case ANDOR:
+            return new AndorSketch<META>(mem_limit, hash_num, seed, ddc_alpha,
+                                         andor_config);
+        case DLEFT:
+            return new DLeftSketch<META>(mem_limit, seed, ddc_alpha);
+        case CUCKOO:
+            return new Cuckoo<META>(mem_limit, seed, ddc_alpha);
+        case BCUCKOO:
+            return new BCuckoo<META>(mem_limit, seed, ddc_alpha);
+        default:
+            throw std::invalid_argument("unknown sketch model");
+        }
     }
 
     template <typename META>
-    FlowType SketchSingleTest<META>::getType(u32 id) const {
-        return real.type(id);
+    SketchSingleTest<META>::SketchSingleTest(u32 model_, u64 mem_limit,
+                                             u32 hash_num, u32 seed,
+                                             double ddc_alpha,
+                                             const AndorConfig& andor_config)
+        : model(model_),
+          sketch(create_model<META>(model_, mem_limit, hash_num, seed,
+                                    ddc_alpha, andor_config)) { }
+
+    template <typename META>
+    SketchSingleTest<META>::~SketchSingleTest() {
+        delete sketch;
     }
 
     template <typename META>
-    f64 SketchSingleTest<META>::ALE(u32 model, u32 type) const {
-        u32 flow_cnt = 0;
-        f64 error = 0;
-        for (u32 id : id_list) {
-            if ((getType(id) & type) == 0) {
-                continue;
+    void SketchSingleTest<META>::append(const vector<FlowItem>& dataset) {
+        auto start = high_resolution_clock::now();
+        visit_model<META>(model, *sketch, [&](auto& concrete) {
+            for (auto [id, value] : dataset) {
+                concrete.append(id, value);
             }
-            error += FlowALE(models[model], id);
-            ++flow_cnt;
-        }
-        return error / flow_cnt;
+        });
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<microseconds>(end - start);
+        append_tp = static_cast<f64>(dataset.size()) / duration.count();
     }
 
     template <typename META>
-    f64 SketchSingleTest<META>::APE(u32 model, u32 type) const {
-        u32 flow_cnt = 0;
-        f64 error = 0;
-        for (u32 id : id_list) {
-            if ((getType(id) & type) == 0) {
-                continue;
+    void SketchSingleTest<META>::append(IngestPipeline& pipeline) {
+        PipelineStats stats = visit_model<META>(model, *sketch,
+            [&](auto& concrete) {
+                return pipeline.run(concrete);
+            });
+        append_tp = stats.items / (stats.seconds * 1e6);
+        cout << " " << stats.seconds << " s"
+             << ", reader stalls " << stats.readerStalls
+             << ", sketch stalls " << stats.sketchStalls
+             << ", depth avg " << stats.avgDepth
+             << " max " << stats.maxDepth << endl;
+    }
+
+    template <typename META>
+    void SketchSingleTest<META>::estimate(const GroundTruth& truth_,
+                                          ThreadPool* pool) {
+        truth = &truth_;
+        const real_dist& real = truth->dist();
+        const f64 given_p = GroundTruth::given_p;
+        const vector<Flow>& flows = truth->flows();
+
+        // queries only read the sketch, so the accuracy pass may fan out
+        ests.assign(flows.size(), {});
+        auto body = [&](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; ++i) {
+                u32 quan = sketch->quantile(flows[i].id, given_p);
+                ests[i] = {quan, quan == 0 ? 0 : real.nomRank(flows[i].id,
+                                                               quan)};
             }
-            error += FlowAPE(models[model], id);
-            ++flow_cnt;
+        };
+        if (pool) {
+            pool->parallelFor(flows.size(), 256, body);
+        } else {
+            body(0, flows.size());
         }
-        return error / flow_cnt;
     }
 
-    // 新增：计算 AAE（平均绝对误差）
     template <typename META>
-    f64 SketchSingleTest<META>::AAE(u32 model, u32 type) const {
+    void SketchSingleTest<META>::evaluate(const GroundTruth& truth_,
+                                          ThreadPool& pool) {
+        estimate(truth_, &pool);
+        timeQueries(truth_);
+    }
+
+    template <typename META>
+    void SketchSingleTest<META>::timeQueries(const GroundTruth& truth_) {
+        const f64 given_p = GroundTruth::given_p;
+        volatile u32 unused;    // just for avoiding optimization
         u32 flow_cnt = 0;
-        f64 error = 0;
-        for (u32 id : id_list) {
-            if ((getType(id) & type) == 0) {
-                continue;
+        auto start = high_resolution_clock::now();
+        for (u32 i = 0; i < 10; ++i) {
+            for (const Flow& flow : truth_.flows()) {
+                unused = sketch->quantile(flow.id, given_p);
+                (void) unused;
+                ++flow_cnt;
             }
-            error += FlowAAE(models[model], id);
-            ++flow_cnt;
         }
-        return error / flow_cnt;
+        auto end = high_resolution_clock::now();
+        auto duration = duration_cast<microseconds>(end - start);
+        query_tp = static_cast<f64>(flow_cnt) / duration.count();
+
+#ifdef ANDOR_STATS
+        if (auto andor = dynamic_cast<const AndorSketch<META>*>(sketch)) {
+            cout << "andor stats:" << endl;
+            andor->stats().dump(cout);
+        }
+#endif
     }
 
-    // 新增：计算 ARE（平均相对误差）
     template <typename META>
-    f64 SketchSingleTest<META>::ARE(u32 model, u32 type) const {
+    template <typename F>
+    f64 SketchSingleTest<META>::average(u32 type, F&& flow_error) const {
+        if (type & ~GroundTruth::eval_types) {
+            throw std::invalid_argument("flow type not evaluated");
+        }
+        if (truth == nullptr) {
+            throw std::logic_error("trial not evaluated");
+        }
+
+        const vector<Flow>& flows = truth->flows();
         u32 flow_cnt = 0;
         f64 error = 0;
-        for (u32 id : id_list) {
-            if ((getType(id) & type) == 0) {
+        for (u64 i = 0; i < flows.size(); ++i) {
+            if ((flows[i].type & type) == 0) {
                 continue;
             }
-            error += FlowARE(models[model], id);
+            error += flow_error(flows[i], ests[i]);
             ++flow_cnt;
         }
         return error / flow_cnt;
     }
 
     template <typename META>
-    f64 SketchSingleTest<META>::appendTp(u32 model) const {
-        return append_tp[model];
+    f64 SketchSingleTest<META>::ALE(u32 type) const {
+        return average(type, FlowALE);
     }
 
     template <typename META>
-    f64 SketchSingleTest<META>::queryTp(u32 model) const {
-        volatile u32 unused;    // just for avoiding optimization
-        u32 flow_cnt = 0;
-        auto start = high_resolution_clock::now();
-        for (u32 i = 0; i < 10; ++i) {
-            for (u32 id : id_list) {
-                if (getType(id) == FlowType::TINY) {
-                    continue;
-                }
-                unused = models[model]->quantile(id, given_p);
-                (void) unused;
-                ++flow_cnt;
-            }
-        }
-        auto end = high_resolution_clock::now();
-        auto duration = duration_cast<microseconds>(end - start);
-        return static_cast<f64>(flow_cnt) / duration.count();
+    f64 SketchSingleTest<META>::APE(u32 type) const {
+        return average(type, FlowAPE);
+    }
+
+    // 新增：计算 AAE（平均绝对误差）
+    template <typename META>
+    f64 SketchSingleTest<META>::AAE(u32 type) const {
+        return average(type, FlowAAE);
     }
 
+    // 新增：计算 ARE（平均相对误差）
     template <typename META>
-    f64 SketchSingleTest<META>::FlowALE(const Framework* sketch, u32 id) const {
-        f64 quan = sketch->quantile(id, given_p);
+    f64 SketchSingleTest<META>::ARE(u32 type) const {
+        return average(type, FlowARE);
+    }
+
+    template <typename META>
+    f64 SketchSingleTest<META>::FlowALE(const Flow& flow, const FlowEst& est) {
+        f64 quan = est.est;
         if (quan == 0) {
             return 0;
         }
-        f64 quan_real = real.quantile(id, given_p);
+        f64 quan_real = flow.real;
         return std::fabs(std::log2(quan / quan_real));
     }
 
     template <typename META>
-    f64 SketchSingleTest<META>::FlowAPE(const Framework* sketch , u32 id) const {
-        f64 quan = sketch->quantile(id, given_p);
-        if (quan == 0) {
+    f64 SketchSingleTest<META>::FlowAPE(const Flow& flow, const FlowEst& est) {
+        if (est.est == 0) {
             return 0;
         }
-        f64 nom_rank = real.nomRank(id, quan);
-        return std::fabs(nom_rank - given_p);
+        return std::fabs(est.estRank - GroundTruth::given_p);
     }
 
     // 新增：计算单个流的 AAE（绝对误差）
     template <typename META>
-    f64 SketchSingleTest<META>::FlowAAE(const Framework* sketch, u32 id) const {
-        f64 quan = sketch->quantile(id, given_p);
-        f64 quan_real = real.quantile(id, given_p);
+    f64 SketchSingleTest<META>::FlowAAE(const Flow& flow, const FlowEst& est) {
+        f64 quan = est.est;
+        f64 quan_real = flow.real;
         return std::fabs(quan - quan_real);
     }
 
     // 新增：计算单个流的 ARE（相对误差）
     template <typename META>
-    f64 SketchSingleTest<META>::FlowARE(const Framework* sketch, u32 id) const {
-        f64 quan = sketch->quantile(id, given_p);
-        f64 quan_real = real.quantile(id, given_p);
+    f64 SketchSingleTest<META>::FlowARE(const Flow& flow, const FlowEst& est) {
+        f64 quan = est.est;
+        f64 quan_real = flow.real;
         if (quan_real == 0) {
             return 0; // 避免除以零
         }
@@ -172,22 +240,120 @@ namespace sketch {
     template <typename META>
     SketchTest<META>::SketchTest(u64 mem_limit_, u32 hash_num_, u32 seed_,
                          const string& dataset_name_,
-                         u32 repeat_, double ddc_alpha_)
+                         u32 repeat_, double ddc_alpha_, bool pipeline_,
+                         u32 worker_num_, const AndorConfig& andor_config_,
+                         const vector<u32>& models_)
         : mem_limit(mem_limit_), hash_num(hash_num_), seed(seed_), 
-          dataset(dataset_name_), repeat(repeat_), ddc_alpha(ddc_alpha_) { }
+          dataset(dataset_name_), repeat(repeat_), ddc_alpha(ddc_alpha_),
+          pipeline(pipeline_), worker_num(worker_num_),
+          andor_config(andor_config_), models(models_) {
+        for (u32 m : models) {
+            model_name(m);  // throws if unknown
+        }
+    }
+
+    template <typename META>
+    vector<u32> SketchTest<META>::all_models() {
+        vector<u32> res;
+        for (u32 m = 0; m < NUM_MODELS; ++m) {
+            res.push_back(m);
+        }
+        return res;
+    }
 
     template <typename META>
     void SketchTest<META>::run() {
+        if (pipeline) {
+            runPipeline();
+            return;
+        }
+
         auto dataset_loaded = load_dataset(dataset);
+        ThreadPool pool(worker_num, true);
+        GroundTruth truth(dataset_loaded, pool);
 
+        vector<std::function<void()>> jobs = accuracyJobs(dataset_loaded,
+                                                          truth);
+        cout << "Running " << jobs.size() << " trials on " << pool.size()
+             << " workers..." << endl;
+        pool.parallelFor(jobs.size(), 1, [&jobs](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; ++i) {
+                jobs[i]();
+            }
+        });
+        timeTrials(dataset_loaded, truth, pool);
+        cout << "Test finished" << endl;
+    }
+
+    template <typename META>
+    std::unique_ptr<SketchSingleTest<META>>
+    SketchTest<META>::makeTrial(u32 t) const {
+        return std::make_unique<SketchSingleTest<META>>(
+            trialModel(t), mem_limit, hash_num, repeatSeed(t / models.size()),
+            ddc_alpha, andor_config);
+    }
+
+    template <typename META>
+    vector<std::function<void()>> SketchTest<META>::accuracyJobs(
+            const vector<FlowItem>& dataset_loaded, const GroundTruth& truth) {
+        trials.assign(repeat * models.size(), {});
+        vector<std::function<void()>> jobs;
+        for (u32 t = 0; t < trials.size(); ++t) {
+            jobs.push_back([this, t, &dataset_loaded, &truth] {
+                auto test = makeTrial(t);
+                test->append(dataset_loaded);
+                test->estimate(truth);
+                trials[t] = metrics(*test);
+            });
+        }
+        return jobs;
+    }
+
+    template <typename META>
+    void SketchTest<META>::timeTrials(const vector<FlowItem>& dataset_loaded,
+                                      const GroundTruth& truth,
+                                      ThreadPool& pool) {
         cout << "mem_limit: " << (mem_limit / 1024) << "KB" << endl;
-        
-        for (u32 i = 0; i < repeat; ++i) {
-            cout << "Running test " << i << "..." << endl;
-            SketchSingleTest<META> test(mem_limit, hash_num,
-                                        seed, dataset_loaded, ddc_alpha);
-            cout << "Calculating metrics..." << endl;
-            addMetrics(test);
+        cout << "Timing " << trials.size() << " trials..." << endl;
+        pool.runPinned([&] {
+            for (u32 t = 0; t < trials.size(); ++t) {
+                auto test = makeTrial(t);
+                test->append(dataset_loaded);
+                test->timeQueries(truth);
+                trials[t].append_tp = test->appendTp();
+                trials[t].query_tp = test->queryTp();
+            }
+        });
+        summarize();
+    }
+
+    template <typename META>
+    void SketchTest<META>::runPipeline() {
+        IngestPipeline ingest(dataset);
+        ThreadPool pool(worker_num);
+
+        cout << "mem_limit: " << (mem_limit / 1024) << "KB" << endl;
+
+        // The ground truth streams the trace on its own, untimed, so that
+        // the reader of a timed run does nothing but decode. Trials share
+        // the pipeline, so they run one after another.
+        GroundTruth truth(dataset, pool);
+        if (truth.sample() < 1) {
+            cout << "Evaluating " << truth.flows().size()
+                 << " flows of a " << truth.sample() * 100
+                 << "% sample" << endl;
+        }
+        trials.assign(repeat * models.size(), {});
+        for (u32 t = 0; t < trials.size(); ++t) {
+            if (t % models.size() == 0) {
+                cout << "Running pipelined test " << t / models.size()
+                     << "..." << endl;
+            }
+            auto test = makeTrial(t);
+            cout << "  model " << trialModel(t) << ":";
+            test->append(ingest);
+            test->evaluate(truth, pool);
+            trials[t] = metrics(*test);
         }
 
         summarize();
@@ -195,19 +361,30 @@ namespace sketch {
     }
 
     template <typename META>
-    void SketchTest<META>::addMetrics(const SketchSingleTest<META>& test) {
-        for (u32 i = 0; i < NUM_MODELS; ++i) {
-            m_ALE[i] += test.ALE(i, MID | HUGE);
-            m_APE[i] += test.APE(i, MID | HUGE);
-            m_AAE[i] += test.AAE(i, MID | HUGE); // 新增：累加 AAE
-            m_ARE[i] += test.ARE(i, MID | HUGE); // 新增：累加 ARE
-            m_appendTp[i] += test.appendTp(i);
-            m_queryTp[i] += test.queryTp(i);
-        }
+    u32 SketchTest<META>::repeatSeed(u32 r) const {
+        return seed + r * seed_stride;
+    }
+
+    template <typename META>
+    typename SketchTest<META>::TrialMetrics
+    SketchTest<META>::metrics(const SketchSingleTest<META>& test) {
+        return {test.ALE(MID | HUGE), test.APE(MID | HUGE),
+                test.AAE(MID | HUGE), test.ARE(MID | HUGE),
+                test.appendTp(), test.queryTp()};
     }
 
     template <typename META>
     void SketchTest<META>::summarize() {
+        for (u32 t = 0; t < trials.size(); ++t) {
+            u32 model = trialModel(t);
+            const TrialMetrics& res = trials[t];
+            m_ALE[model] += res.ale;
+            m_APE[model] += res.ape;
+            m_AAE[model] += res.aae; // 新增：累加 AAE
+            m_ARE[model] += res.are; // 新增：累加 ARE
+            m_appendTp[model] += res.append_tp;
+            m_queryTp[model] += res.query_tp;
+        }
         for (i32 i = 0; i < NUM_MODELS; ++i) {
             m_ALE[i] /= repeat;
             m_APE[i] /= repeat;
@@ -3,37 +3,50 @@
 #include <string>
 #include <cassert>
 #include "include/test/sketch_test.hpp"
-#include "include/meta/dd/ddsketch.hpp"
-#include "include/meta/mreq/mreq_sketch.hpp"
-#include "include/meta/tdigest/tdigest.hpp"
+#include "include/test/sketch_bench.hpp"
+#include "include/test/sketch_mem.hpp"
 
 using namespace sketch;
 
-#if defined(TEST_MREQ)
-#define METATYPE mReqSketch
-#define metaname "mreq"
-#elif defined(TEST_TD)
-#define METATYPE TDigest
-#define metaname "tdigest"
-#elif defined(TEST_DD)
-#define METATYPE DDSketch
-#define metaname "dd"
-#elif defined(TEST_DDC)
-#define METATYPE DDCSketch
-#define metaname "ddc"
-#endif
-
 void print_usage(char* file) {
     cout << "usage: " << file
-         << " <memory> <dataset> <hash-num> <repeat> [<seed>]" << endl;
+         << " [--pipeline | --bench | --mem] [--meta <metas>] [--models <models>]"
+         << " [--andor-config <file>] [--huge-pages <pages>] [--shards <n>]"
+         << " [--hash <family>] [--pcap <file>]"
+         << " <memory> <dataset> <hash-num> <repeat>"
+         << " [<seed>]"
+         << endl;
     cout << endl;
 
     cout << "Meaning of arguments: " << endl;
     cout << "    memory          memory in KB" << endl;
-    cout << "    dataset         caida, imc, seattle, or MAWI" << endl;
+    cout << "    dataset         caida, imc, seattle, web, criteo, MAWI, pcap,"
+         << " or a synthetic spec like synth:flows=1e6,items=1e8" << endl;
     cout << "    hash-num        number of hash functions per level" << endl;
     cout << "    repeat          times of test repetitions" << endl;
     cout << "    seed            random seed, by default 0" << endl;
+    cout << "    --pipeline      read the dataset while appending, caida,"
+         << " imc, MAWI or a synthetic spec, whose ground truth samples"
+         << " flows beyond 2^27 items" << endl;
+    cout << "    --bench         benchmark appending and queries instead,"
+         << " repeat being the timed trials, and write JSON" << endl;
+    cout << "    --mem           report the memory of each model, modeled,"
+         << " heap and RSS, instead; build with TRACK=1 to also count"
+         << " allocations" << endl;
+    cout << "    --meta          comma-separated METAs among dd, mreq,"
+         << " tdigest and ddc, by default all" << endl;
+    cout << "    --models        comma-separated sketch models among andor,"
+         << " dleft, cuckoo and bcuckoo, by default all" << endl;
+    cout << "    --andor-config  level layout of andor, as written by tuner"
+         << endl;
+    cout << "    --huge-pages    back bucket arrays of andor, dleft and cuckoo"
+         << " by 1gb, 2mb or thp pages, falling back to smaller ones" << endl;
+    cout << "    --shards        with --bench, split each model into n shards"
+         << " of memory / n, owned by threads spread over NUMA nodes" << endl;
+    cout << "    --hash          bucket hashes of 32-bit IDs, bob by default, or"
+         << " crc for the three CRC-32s of the switch pipeline" << endl;
+    cout << "    --pcap          pcap or pcapng capture of M4 telemetry read"
+         << " as the pcap dataset" << endl;
 }
 
 struct main_args {
@@ -44,12 +57,89 @@ struct main_args {
     u32 repeat;
     u32 seed;
     double ddc_alpha;
+    bool pipeline;
+    bool bench;
+    bool mem;
+    u32 shards;
+    AndorConfig andor_config;
+    vector<u32> metas;
+    vector<u32> models;
 };
 
+/// @brief Split a comma-separated list and parse each of its names.
+template <typename Parse>
+vector<u32> parse_list(const string& list, Parse&& parse) {
+    vector<u32> res;
+    u64 begin = 0;
+    while (begin <= list.size()) {
+        u64 end = std::min(list.find(',', begin), list.size());
+        res.push_back(parse(list.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return res;
+}
+
 main_args parse_args(int argc, char* argv[]) {
     main_args args;
     args.valid = false;
 
+    args.pipeline = false;
+    args.bench = false;
+    args.mem = false;
+    args.shards = 0;
+    for (u32 i = 0; i < NUM_METAS; ++i) {
+        args.metas.push_back(i);
+    }
+    args.models = SketchTest<DDSketch>::all_models();
+    while (argc > 1 && string(argv[1]).rfind("--", 0) == 0) {
+        string flag = argv[1];
+        if (flag == "--pipeline") {
+            args.pipeline = true;
+        } else if (flag == "--bench") {
+            args.bench = true;
+        } else if (flag == "--mem") {
+            args.mem = true;
+        } else if (flag == "--meta" && argc > 2) {
+            args.metas = parse_list(argv[2], parse_meta);
+            --argc;
+            ++argv;
+        } else if (flag == "--models" && argc > 2) {
+            args.models = parse_list(argv[2], parse_model);
+            --argc;
+            ++argv;
+        } else if (flag == "--andor-config" && argc > 2) {
+            args.andor_config = AndorConfig::load(argv[2]);
+            --argc;
+            ++argv;
+        } else if (flag == "--shards" && argc > 2) {
+            args.shards = stoul(argv[2]);
+            --argc;
+            ++argv;
+        } else if (flag == "--huge-pages" && argc > 2) {
+            HugePages::request(HugePages::parse(argv[2]));
+            --argc;
+            ++argv;
+        } else if (flag == "--hash" && argc > 2) {
+            HashFamily::select(HashFamily::parse(argv[2]));
+            --argc;
+            ++argv;
+        } else if (flag == "--pcap" && argc > 2) {
+            pcap_path = argv[2];
+            --argc;
+            ++argv;
+        } else {
+            return args;
+        }
+        --argc;
+        ++argv;
+    }
+    if (args.pipeline + args.bench + args.mem > 1) {
+        return args;
+    }
+    if (args.shards != 0 && !args.bench) {
+        return args;
+    }
+
     if (argc != 5 && argc != 6 && argc != 7) {
         return args;
     }
@@ -61,11 +151,23 @@ main_args parse_args(int argc, char* argv[]) {
         args.dataset != "MAWI" &&
         args.dataset != "seattle" &&
         args.dataset != "web" &&
-        args.dataset != "criteo") {
+        args.dataset != "criteo" &&
+        args.dataset != "pcap" &&
+        !SyntheticConfig::isSpec(args.dataset)) {
+        return args;
+    }
+    if (args.dataset == "pcap" && !pcap_path) {
+        return args;
+    }
+    if (args.pipeline && !TraceReader::streamable(args.dataset)) {
         return args;
     }
 
     args.hash_num = stoul(argv[3]);
+    if (HashFamily::selected() == HashFamily::CRC
+            && args.hash_num > CrcHash::VARIANTS) {
+        return args;
+    }
 
     args.repeat = stoul(argv[4]);
 
@@ -84,8 +186,10 @@ main_args parse_args(int argc, char* argv[]) {
 }
 
 
-void output_res(const main_args& args, const SketchTest<METATYPE>& test) {
-    string output_name = static_cast<string>(res_path) + "res_" + metaname
+template <typename META>
+void output_res(const main_args& args, const string& meta,
+                const SketchTest<META>& test) {
+    string output_name = static_cast<string>(res_path) + "res_" + meta
                             + "_" + args.dataset + ".txt";
     ofstream out(output_name, ios::app);
     assert(out.is_open());
@@ -93,32 +197,115 @@ void output_res(const main_args& args, const SketchTest<METATYPE>& test) {
     out << "memory: " << (args.memory / 1024) << " KB" << endl;
     out << "dataset: " << args.dataset << endl;
     out << "hash_num: " << args.hash_num << endl;
+    if (HashFamily::selected() != HashFamily::BOB) {
+        out << "hash: " << HashFamily::name(HashFamily::selected()) << endl;
+    }
     out << "repeat: " << args.repeat << endl;
     out << "seed: " << args.seed << endl;
+    if (args.pipeline) {
+        out << "pipeline: on" << endl;
+    }
     out << endl;
 
-    out << "ALE of andor: " << test.ALE(ANDOR) << endl;
-    out << "ALE of dleft: " << test.ALE(DLEFT) << endl;
-    out << "ALE of cuckoo: " << test.ALE(CUCKOO) << endl;
-    out << "APE of andor: " << test.APE(ANDOR) << endl;
-    out << "APE of dleft: " << test.APE(DLEFT) << endl;
-    out << "APE of cuckoo: " << test.APE(CUCKOO) << endl;
-    out << "AAE of andor: " << test.AAE(ANDOR) << endl;
-    out << "AAE of dleft: " << test.AAE(DLEFT) << endl;
-    out << "AAE of cuckoo: " << test.AAE(CUCKOO) << endl;
-    out << "ARE of andor: " << test.ARE(ANDOR) << endl;
-    out << "ARE of dleft: " << test.ARE(DLEFT) << endl;
-    out << "ARE of cuckoo: " << test.ARE(CUCKOO) << endl;
-
-    out << "AppendTp of andor: " << test.appendTp(ANDOR) << " Mops" << endl;
-    out << "AppendTp of dleft: " << test.appendTp(DLEFT) << " Mops" << endl;
-    out << "AppendTp of cuckoo: " << test.appendTp(CUCKOO) << " Mops" << endl;
-    out << "QueryTp of andor: " << test.queryTp(ANDOR) << " Mops" << endl;
-    out << "QueryTp of dleft: " << test.queryTp(DLEFT) << " Mops" << endl;
-    out << "QueryTp of cuckoo: " << test.queryTp(CUCKOO) << " Mops" << endl;
+    auto metric = [&](const char* name, auto get, const char* unit) {
+        for (u32 m : test.tested()) {
+            out << name << " of " << model_name(m) << ": " << (test.*get)(m)
+                << unit << endl;
+        }
+    };
+    metric("ALE", &SketchTest<META>::ALE, "");
+    metric("APE", &SketchTest<META>::APE, "");
+    metric("AAE", &SketchTest<META>::AAE, "");
+    metric("ARE", &SketchTest<META>::ARE, "");
+
+    metric("AppendTp", &SketchTest<META>::appendTp, " Mops");
+    metric("QueryTp", &SketchTest<META>::queryTp, " Mops");
     out << endl;
 }
 
+template <typename META>
+void run_bench(const main_args& args, const string& meta) {
+    BenchConfig config;
+    config.trials = args.repeat;
+    SketchBench<META> bench(args.memory, args.hash_num, args.seed,
+                            args.dataset, args.ddc_alpha, config,
+                            args.andor_config, args.models, args.shards);
+    bench.run();
+
+    string output_name = static_cast<string>(res_path) + "bench_" + meta
+                            + "_" + args.dataset + ".json";
+    ofstream out(output_name);
+    assert(out.is_open());
+    bench.writeJson(out, meta);
+}
+
+template <typename META>
+void run_mem(const main_args& args, const string& meta) {
+    SketchMemCheck<META> check(args.memory, args.hash_num, args.seed,
+                               args.dataset, args.ddc_alpha,
+                               args.andor_config, args.models);
+    check.run();
+
+    string output_name = static_cast<string>(res_path) + "mem_" + meta
+                            + "_" + args.dataset + ".txt";
+    ofstream out(output_name, ios::app);
+    assert(out.is_open());
+    check.write(out);
+    check.write(cout);
+}
+
+template <typename META>
+void run_test(const main_args& args, const string& meta) {
+    SketchTest<META> test(args.memory, args.hash_num, args.seed,
+                   args.dataset, args.repeat, args.ddc_alpha, args.pipeline,
+                   std::thread::hardware_concurrency(), args.andor_config,
+                   args.models);
+
+    test.run();
+
+    output_res(args, meta, test);
+}
+
+/// @brief Run the tests of every META sharing one dataset, ground truth
+///        and pool: the untimed parts of all their trials at once, then
+///        the timed parts one after another.
+void run_tests(const main_args& args) {
+    vector<FlowItem> dataset = load_dataset(args.dataset);
+    ThreadPool pool(std::thread::hardware_concurrency(), true);
+    GroundTruth truth(dataset, pool);
+
+    vector<std::function<void()>> jobs, timed;
+    for (u32 meta : args.metas) {
+        dispatch_meta(meta, [&](auto tag) {
+            using META = typename decltype(tag)::type;
+            auto test = std::make_shared<SketchTest<META>>(
+                args.memory, args.hash_num, args.seed, args.dataset,
+                args.repeat, args.ddc_alpha, false, pool.size(),
+                args.andor_config, args.models);
+            vector<std::function<void()>> part =
+                test->accuracyJobs(dataset, truth);
+            jobs.insert(jobs.end(), part.begin(), part.end());
+            timed.push_back([&, test, meta] {
+                cout << "META: " << meta_name(meta) << endl;
+                test->timeTrials(dataset, truth, pool);
+                output_res(args, meta_name(meta), *test);
+            });
+        });
+    }
+
+    cout << "Running " << jobs.size() << " trials on " << pool.size()
+         << " workers..." << endl;
+    pool.parallelFor(jobs.size(), 1, [&jobs](u64 begin, u64 end) {
+        for (u64 i = begin; i < end; ++i) {
+            jobs[i]();
+        }
+    });
+    for (auto& run : timed) {
+        run();
+    }
+    cout << "Test finished" << endl;
+}
+
 int main(int argc, char* argv[]) {
     main_args args = parse_args(argc, argv);
     if (!args.valid) {
@@ -126,13 +313,29 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    SketchTest<METATYPE> test(args.memory, args.hash_num, args.seed, 
-                   args.dataset, args.repeat, args.ddc_alpha);
-
-    test.run();
-
-    output_res(args, test);
+    if (!args.bench && !args.mem && !args.pipeline) {
+        run_tests(args);
+    } else {
+        // Each META is dispatched once, so the whole run below is compiled
+        // for it.
+        for (u32 meta : args.metas) {
+            cout << "META: " << meta_name(meta) << endl;
+            dispatch_meta(meta, [&](auto tag) {
+                using META = typename decltype(tag)::type;
+                if (args.bench) {
+                    run_bench<META>(args, meta_name(meta));
+                } else if (args.mem) {
+                    run_mem<META>(args, meta_name(meta));
+                } else {
+                    run_test<META>(args, meta_name(meta));
+                }
+            });
+        }
+    }
+    if (HugePages::largest() != HugePages::NORMAL) {
+        HugePages::report(cout);
+    }
+    if (HashFamily::selected() == HashFamily::CRC) {
+        CrcHash::report(cout);
+    }
 }
-
-#undef META
-#undef meta
@@ -0,0 +1,782 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <random>
+#include <cassert>
+#include <array>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "include/test/benchmark.hpp"
+#include "include/common/BOBHash32.h"
+#include "include/common/flow_key.hpp"
+#include "include/common/histogram.hpp"
+#include "include/common/sorted_view.hpp"
+#include "include/common/synthetic_trace.hpp"
+#include "include/common/tiny_counter.hpp"
+#include "include/framework/andor/andor_sketch.hpp"
+#include "include/framework/andor/andor_view.hpp"
+#include "include/framework/concurrent/concurrent_cuckoo.hpp"
+#include "include/framework/concurrent/concurrent_dleft.hpp"
+#include "include/framework/dleft/dleft_sketch.hpp"
+#include "include/framework/window/sliding_window.hpp"
+#include "include/meta/dd/ddsketch.hpp"
+#include "include/meta/dd_collapse/ddsketch_collapse.hpp"
+#include "include/meta/mreq/mreq_sketch.hpp"
+#include "include/meta/tdigest/tdigest.hpp"
+
+using namespace sketch;
+
+// Parameters of the METAs, as the frameworks use them.
+constexpr f64 dd_alpha = 0.15;
+constexpr f64 ddc_alpha = 0.1;
+constexpr u32 cmtor_cap = 8;
+constexpr u32 td_delta = 32;
+
+/// Items appended to one sketch, powers of two so that operation indices
+/// split into sketch and item with a shift and a mask.
+const u32 size_logs[] = {6, 10, 14};
+
+/// Item operations per trial of a benchmark.
+constexpr u64 trial_items = 1 << 20;
+
+enum Dist {
+    UNIFORM,
+    EXPONENTIAL,
+    PARETO,
+    NUM_DISTS,
+};
+
+const char* dist_names[NUM_DISTS] = {"uniform", "exp", "pareto"};
+
+/// @brief Generate values of a distribution, all of them positive.
+vec_u32 gen_values(Dist dist, u32 num, u32 seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<u32> uniform(1, 1000000);
+    std::exponential_distribution<f64> exponential(1e-4);
+    std::uniform_real_distribution<f64> unit(0.0, 1.0);
+
+    vec_u32 values(num);
+    for (u32& v : values) {
+        f64 x;
+        switch (dist) {
+            case UNIFORM: x = uniform(gen); break;
+            case EXPONENTIAL: x = exponential(gen); break;
+            default: x = 100 / std::pow(1 - unit(gen), 1 / 1.2); break;
+        }
+        v = static_cast<u32>(std::min(std::max(x, 1.0), 4e9));
+    }
+    return values;
+}
+
+/// @brief Runs benchmarks whose name contains a filter, and collects
+///        their results.
+class MicroBench {
+public:
+    MicroBench(const BenchConfig& config, const string& filter_)
+        : bench(config), filter(filter_) { }
+
+    template <typename Setup, typename Op>
+    void run(const string& name, u64 ops, Setup&& setup, Op&& op) {
+        if (wants(name)) {
+            add(bench.run(name, ops, setup, op));
+        }
+    }
+
+    /// @brief Return whether a benchmark passes the filter.
+    bool wants(const string& name) const {
+        return name.find(filter) != string::npos;
+    }
+
+    /// @brief Record and print a result measured outside the harness.
+    void add(BenchResult res) {
+        results.push_back(std::move(res));
+        print(results.back());
+    }
+
+    const BenchConfig& settings() const { return bench.settings(); }
+
+    void writeJson(std::ostream& out) const {
+        const BenchConfig& config = bench.settings();
+        out << "{\n  \"warmup\": " << config.warmup
+            << ",\n  \"trials\": " << config.trials
+            << ",\n  \"sample_every\": " << config.sample_every
+            << ",\n  \"ticks_per_ns\": " << CycleClock::ticksPerNs()
+            << ",\n  \"results\": [";
+        for (u64 i = 0; i < results.size(); ++i) {
+            out << (i ? ", " : "");
+            results[i].writeJson(out, 2);
+        }
+        out << "]\n}\n";
+    }
+
+private:
+    Benchmark bench;
+    string filter;
+    vector<BenchResult> results;
+
+    static void print(const BenchResult& res) {
+        cout << res.name << ": " << res.tp.median << " Mops"
+             << ", cv " << 100 * res.tp.stddev / res.tp.mean << "%";
+        if (res.latency.samples != 0) {
+            cout << ", p50 " << res.latency.p50 << " ns"
+                 << ", p99 " << res.latency.p99 << " ns";
+        }
+        cout << endl;
+    }
+};
+
+/// @brief Benchmark filling empty METAs with 2^size_log values each.
+template <typename META>
+void bench_append(MicroBench& mb, const string& name, const META& blank,
+                  const vec_u32& values, u32 size_log) {
+    u64 mask = (1ull << size_log) - 1;
+    vector<META> metas;
+    mb.run(name, trial_items,
+        [&] { metas.assign(trial_items >> size_log, blank); },
+        [&](u64 i) { metas[i >> size_log].append(values[i & mask]); });
+}
+
+/// @brief Benchmark quantiles of random ranks on a filled META.
+template <typename META>
+void bench_quantile(MicroBench& mb, const string& name, META meta,
+                    const vec_u32& values, const vec_f64& ranks) {
+    for (u32 v : values) {
+        meta.append(v);
+    }
+    u64 mask = ranks.size() - 1;
+    mb.run(name, trial_items, [] { },
+        [&](u64 i) { return meta.quantile(ranks[i & mask]); });
+}
+
+void bench_metas(MicroBench& mb, const string& suffix, const vec_u32& values,
+                 u32 size_log, const vec_f64& ranks) {
+    DDSketch dd(UINT32_MAX, dd_alpha);
+    DDCSketch ddc(UINT32_MAX, dd_alpha, ddc_alpha);
+    mReqSketch mreq(UINT32_MAX, cmtor_cap);
+    TDigest td(UINT32_MAX, td_delta);
+
+    bench_append(mb, "dd/append" + suffix, dd, values, size_log);
+    bench_quantile(mb, "dd/quantile" + suffix, dd, values, ranks);
+    bench_append(mb, "ddc/append" + suffix, ddc, values, size_log);
+    bench_append(mb, "mreq/append" + suffix, mreq, values, size_log);
+    bench_quantile(mb, "mreq/quantile" + suffix, mreq, values, ranks);
+    bench_append(mb, "tdigest/append" + suffix, td, values, size_log);
+}
+
+void bench_histogram(MicroBench& mb, const string& suffix,
+                     const vec_u32& values, const vec_u32& others,
+                     const vec_f64& ranks) {
+    DDSketch a(UINT32_MAX, dd_alpha), b(UINT32_MAX, dd_alpha);
+    for (u32 v : values) {
+        a.append(v);
+    }
+    for (u32 v : others) {
+        b.append(v);
+    }
+    Histogram ha = a, hb = b;
+
+    u64 ops = std::max<u64>(trial_items / values.size(), 1024);
+    mb.run("histogram/and" + suffix, ops, [] { },
+        [&](u64) { return (ha & hb).empty(); });
+    mb.run("histogram/or" + suffix, ops, [] { },
+        [&](u64) { return (ha | hb).empty(); });
+
+    u64 mask = ranks.size() - 1;
+    mb.run("histogram/quantile" + suffix, trial_items, [] { },
+        [&](u64 i) { return ha.quantile(ranks[i & mask]); });
+}
+
+void bench_sorted_view(MicroBench& mb, const string& suffix,
+                       const vec_u32& values) {
+    // insertion is quadratic, so larger views are built fewer times
+    u64 num = values.size();
+    u64 ops = std::max<u64>((1ull << 26) / (num * num), 4);
+    mb.run("sorted_view/build" + suffix, ops, [] { },
+        [&](u64) {
+            SortedView view(values.size());
+            view.insert(values.cbegin(), values.cend(), 1);
+            view.convertToCumulative();
+            return view.quantile(0.5);
+        });
+}
+
+void bench_tiny_counter(MicroBench& mb, const vec_u32& values) {
+    // Counters cycle through appends until full and are then reset, as
+    // level 0 of Andor promotes full counters.
+    constexpr u32 cnt_log = 12;
+    vector<TinyCnter> cnts;
+    u64 mask = values.size() - 1;
+    mb.run("tiny_counter/append", trial_items,
+        [&] { cnts.assign(1 << cnt_log, TinyCnter()); },
+        [&](u64 i) {
+            TinyCnter& cnt = cnts[i & ((1 << cnt_log) - 1)];
+            u32 idx = (i >> cnt_log) & 3;
+            if (cnt.full(idx)) {
+                cnt = TinyCnter();
+            }
+            cnt.append(values[i & mask], idx);
+            return cnt.value();
+        });
+}
+
+/// @brief Benchmark hashing a flow key, read from a table as a sketch
+///        reads it from its input.
+template <typename Key>
+void bench_key_hash(MicroBench& mb, const string& name) {
+    vector<Key> keys(1 << 10);
+    std::mt19937_64 gen(1);
+    for (Key& key : keys) {
+        u64 words[(sizeof(Key) + 7) / 8];
+        for (u64& word : words) {
+            word = gen();
+        }
+        std::memcpy(&key, words, sizeof(Key));
+    }
+    KeyHash<Key> hash(17);
+    mb.run("keyhash/" + name, trial_items, [] { },
+        [&](u64 i) { return hash.run(keys[i & (keys.size() - 1)]); });
+}
+
+void bench_hash(MicroBench& mb) {
+    BOBHash32 hash(17);
+    mb.run("bobhash32/run", trial_items, [] { },
+        [&](u64 i) { return hash.run(static_cast<u32>(i)); });
+    CrcHash crc(0);
+    mb.run("crc32/run", trial_items, [] { },
+        [&](u64 i) { return crc.run(static_cast<u32>(i)); });
+
+    bench_key_hash<u64>(mb, "u64");
+    bench_key_hash<FiveTuple>(mb, "5tuple");
+    bench_key_hash<std::array<u64, 4>>(mb, "32B");
+}
+
+/// @brief Benchmark the synthetic trace generator, per item generated in
+///        batches as the ingestion path reads it.
+void bench_synthetic(MicroBench& mb) {
+    const char* specs[][2] = {
+        {"synth/iid/lognormal", "synth:flows=1e8,items=1e12"},
+        {"synth/burst/bimodal",
+         "synth:flows=1e8,items=1e12,arrival=burst,value=bimodal"},
+        {"synth/churn/pareto",
+         "synth:flows=1e8,items=1e12,arrival=churn,value=pareto,drift=1"},
+    };
+    constexpr u32 batch = 1024;
+    for (auto [name, spec] : specs) {
+        SyntheticConfig config = SyntheticConfig::parse(spec);
+        std::unique_ptr<SyntheticTrace> trace;
+        FlowItem items[batch];
+        mb.run(name, trial_items,
+            [&] { trace.reset(new SyntheticTrace(config)); },
+            [&](u64 i) {
+                if (i % batch == 0) {
+                    trace->read(items, batch);
+                }
+                return items[i % batch].value;
+            });
+    }
+}
+
+/// @brief Benchmark writer threads appending to a concurrent framework
+///        while a reader thread queries it.
+/// @details Writers append the same few flows round-robin, so that they
+///          contend on the same buckets. The reader checks that no flow
+///          ever shrinks, which a torn read would show, and after each
+///          trial every append must be found in its flow.
+/// @throw std::runtime_error if a check fails.
+template <typename Sketch>
+void bench_concurrent(MicroBench& mb, const string& name, u32 writers) {
+    string prefix = name + "/w=" + std::to_string(writers);
+    if (!mb.wants(prefix + "/append") && !mb.wants(prefix + "/query")) {
+        return;
+    }
+
+    constexpr u32 flow_num = 64;
+    u64 per_writer = trial_items / writers;
+    u64 per_flow = per_writer * writers / flow_num;
+    const BenchConfig& config = mb.settings();
+    BenchResult append_res, query_res;
+    append_res.name = prefix + "/append";
+    append_res.ops = per_writer * writers;
+    query_res.name = prefix + "/query";
+
+    for (u32 t = 0; t < config.warmup + config.trials; ++t) {
+        Sketch sketch(1 << 20, 0);
+        std::atomic<bool> stop{false};
+        bool shrunk = false;
+        u64 queries = 0, sink = 0;
+        std::thread reader([&] {
+            u32 last[flow_num] = {};
+            while (!stop.load(std::memory_order_acquire)) {
+                for (u32 f = 0; f < flow_num; ++f) {
+                    u32 size = sketch.size(f);
+                    shrunk |= size < last[f];
+                    last[f] = size;
+                    sink += size != 0 ? sketch.quantile(f, 0.5) : 0;
+                    queries += 1 + (size != 0);
+                }
+            }
+        });
+
+        auto start = steady_clock::now();
+        vector<std::thread> threads;
+        for (u32 w = 0; w < writers; ++w) {
+            threads.emplace_back([&sketch, per_writer, w] {
+                xorshift32 gen(w + 1);
+                for (u64 i = 0; i < per_writer; ++i) {
+                    sketch.append(i % flow_num, 1 + gen() % 1000000);
+                }
+            });
+        }
+        for (std::thread& th : threads) {
+            th.join();
+        }
+        auto end = steady_clock::now();
+        stop.store(true, std::memory_order_release);
+        reader.join();
+
+        for (u32 f = 0; f < flow_num; ++f) {
+            if (sketch.size(f) != per_flow) {
+                throw std::runtime_error(prefix + ": appends were lost");
+            }
+        }
+        if (shrunk) {
+            throw std::runtime_error(prefix + ": a reader saw a flow shrink");
+        }
+        volatile u64 unused = sink;     // just for avoiding optimization
+        (void) unused;
+        if (t >= config.warmup) {
+            f64 ns = duration_cast<nanoseconds>(end - start).count();
+            append_res.mops.push_back(append_res.ops * 1e3 / ns);
+            query_res.mops.push_back(queries * 1e3 / ns);
+            query_res.ops += queries;
+        }
+    }
+
+    for (BenchResult* res : {&append_res, &query_res}) {
+        res->tp = BenchSummary::of(res->mops);
+        std::fill(res->perOp, res->perOp + PerfCounters::NUM_EVENTS, -1);
+    }
+    query_res.ops /= std::max<u32>(config.trials, 1);
+    mb.add(append_res);
+    mb.add(query_res);
+}
+
+void bench_concurrent(MicroBench& mb) {
+    for (u32 writers : {1, 2, 4}) {
+        bench_concurrent<ConcurrentDLeftSketch<DDSketch>>(
+            mb, "concurrent/dleft/dd", writers);
+        bench_concurrent<ConcurrentDLeftSketch<mReqSketch>>(
+            mb, "concurrent/dleft/mreq", writers);
+        bench_concurrent<ConcurrentCuckoo<DDSketch>>(
+            mb, "concurrent/cuckoo/dd", writers);
+        bench_concurrent<ConcurrentCuckoo<mReqSketch>>(
+            mb, "concurrent/cuckoo/mreq", writers);
+    }
+}
+
+/// @brief Benchmark appending to AndorSketch alone and while a reader
+///        thread takes snapshots and queries them.
+/// @details The reader queries each snapshot once when it gets it and
+///          again after the writer has moved on, and both answers must
+///          agree, i.e. appends never write a slab a snapshot shares. At
+///          the end, a last snapshot must answer as the sketch itself.
+/// @throw std::runtime_error if a check fails.
+void bench_snapshot(MicroBench& mb) {
+    const string names[] = {"andor/snapshot/append/alone",
+                            "andor/snapshot/append/reader",
+                            "andor/snapshot/query"};
+    if (!mb.wants(names[0]) && !mb.wants(names[1]) && !mb.wants(names[2])) {
+        return;
+    }
+    using Sketch = AndorSketch<DDSketch>;
+
+    vector<FlowItem> items(trial_items);
+    SyntheticTrace(SyntheticConfig::parse("synth:flows=1e5,items=1e6"))
+        .read(items.data(), items.size());
+    vector<u32> watched;
+    for (const FlowItem& item : items) {
+        if (watched.size() < 64 && std::find(watched.begin(), watched.end(),
+                                             item.id) == watched.end()) {
+            watched.push_back(item.id);
+        }
+    }
+    // tiny flows keep no distribution to query
+    auto answers = [&watched](const Sketch& sketch) {
+        vector<u32> res;
+        for (u32 id : watched) {
+            res.push_back(sketch.type(id) != TINY ? sketch.quantile(id, 0.5)
+                                                  : 0);
+        }
+        return res;
+    };
+
+    const BenchConfig& config = mb.settings();
+    BenchResult res[3];
+    for (u32 k = 0; k < 3; ++k) {
+        res[k].name = names[k];
+        res[k].ops = k < 2 ? items.size() : 0;
+    }
+
+    for (u32 t = 0; t < config.warmup + config.trials; ++t) {
+        for (u32 with_reader = 0; with_reader < 2; ++with_reader) {
+            Sketch sketch(1 << 20, 3, 0);
+            std::atomic<bool> stop{false};
+            bool changed = false;
+            u64 snapshots = 0;
+            std::thread reader;
+            if (with_reader) {
+                reader = std::thread([&] {
+                    Sketch::Snapshot prev;
+                    vector<u32> prev_answers;
+                    while (!stop.load(std::memory_order_acquire)) {
+                        u64 epoch = sketch.requestSnapshot();
+                        while (sketch.epoch() < epoch
+                               && !stop.load(std::memory_order_acquire)) {
+                            std::this_thread::yield();
+                        }
+                        Sketch::Snapshot snap = sketch.snapshot();
+                        if (prev) {
+                            changed |= answers(*prev) != prev_answers;
+                        }
+                        prev = snap;
+                        prev_answers = answers(*snap);
+                        ++snapshots;
+                    }
+                });
+            }
+
+            auto start = steady_clock::now();
+            for (const FlowItem& item : items) {
+                sketch.append(item.id, item.value);
+            }
+            auto end = steady_clock::now();
+            stop.store(true, std::memory_order_release);
+            if (with_reader) {
+                reader.join();
+            }
+
+            sketch.publish();
+            if (changed || answers(*sketch.snapshot()) != answers(sketch)) {
+                throw std::runtime_error(
+                    "andor/snapshot: a snapshot changed under a reader");
+            }
+            if (t >= config.warmup) {
+                f64 ns = duration_cast<nanoseconds>(end - start).count();
+                res[with_reader].mops.push_back(items.size() * 1e3 / ns);
+                if (with_reader) {
+                    res[2].mops.push_back(snapshots * watched.size() * 1e3
+                                          / ns);
+                    res[2].ops += snapshots * watched.size();
+                }
+            }
+        }
+    }
+
+    res[2].ops /= std::max<u32>(config.trials, 1);
+    for (BenchResult& r : res) {
+        r.tp = BenchSummary::of(r.mops);
+        std::fill(r.perOp, r.perOp + PerfCounters::NUM_EVENTS, -1);
+        if (mb.wants(r.name)) {
+            mb.add(r);
+        }
+    }
+}
+
+/// @brief Benchmark appending to a sliding window of DLeft sub-sketches,
+///        the appends that rotate it, and the clear a rotation avoids.
+/// @details Checks that every flow the window keeps was appended within
+///          its last @c windows rotations, i.e. that recycled sub-sketches
+///          come back empty. Checks that its medians are no worse than
+///          those of one sub-sketch given only the recent items, and
+///          exactly those of a flow appended to the head alone, which
+///          the other sub-sketches would answer with all their traffic.
+///          Checks that a window left idle for longer than it spans comes
+///          back empty.
+/// @throw std::runtime_error if a check fails.
+void bench_window(MicroBench& mb) {
+    const string names[] = {"window/append", "window/rotate", "window/clear"};
+    if (!mb.wants(names[0]) && !mb.wants(names[1]) && !mb.wants(names[2])) {
+        return;
+    }
+    using Sub = DLeftSketch<DDSketch>;
+    using Window = SlidingWindow<Sub>;
+    constexpr u32 windows = 4;
+    constexpr u64 mem = 1 << 20;
+
+    vector<FlowItem> items(trial_items);
+    SyntheticTrace(SyntheticConfig::parse("synth:flows=1e5,items=1e6"))
+        .read(items.data(), items.size());
+    const u64 period = items.size() / 16;
+
+    const BenchConfig& config = mb.settings();
+    BenchResult res[3];
+    for (u32 k = 0; k < 3; ++k) {
+        res[k].name = names[k];
+    }
+    res[0].ops = items.size();
+    res[1].ops = items.size() / period - 1;
+    res[2].ops = 1;
+
+    for (u32 t = 0; t < config.warmup + config.trials; ++t) {
+        Window window(windows, period, nanoseconds::zero(), mem);
+        f64 rotate_ns = 0;
+        auto start = steady_clock::now();
+        for (u64 i = 0; i < items.size(); ++i) {
+            if (i % period != 0 || i == 0) {
+                window.append(items[i].id, items[i].value);
+                continue;
+            }
+            auto before = steady_clock::now();
+            window.append(items[i].id, items[i].value);
+            rotate_ns += duration_cast<nanoseconds>(
+                steady_clock::now() - before).count();
+        }
+        auto end = steady_clock::now();
+
+        // the window holds the items after the last windows rotations
+        const u64 first = (items.size() / period - windows) * period;
+        std::unordered_map<u32, vector<u32>> recent;
+        for (u64 i = first; i < items.size(); ++i) {
+            recent[items[i].id].push_back(items[i].value);
+        }
+        for (u32 id : window.flows()) {
+            if (recent.count(id) == 0) {
+                throw std::runtime_error(
+                    "window: a flow outlived its sub-sketch");
+            }
+        }
+
+        if (t == 0) {
+            // d-left evicts, so compare typical errors of the larger flows
+            Sub single(mem);
+            for (u64 i = first; i < items.size(); ++i) {
+                single.append(items[i].id, items[i].value);
+            }
+            vector<f64> errors[2];
+            for (auto& [id, values] : recent) {
+                if (values.size() < 16) {
+                    continue;
+                }
+                std::nth_element(values.begin(),
+                                 values.begin() + values.size() / 2,
+                                 values.end());
+                f64 truth = values[values.size() / 2];
+                u32 est[2] = {window.quantile(id, 0.5),
+                              single.quantile(id, 0.5)};
+                for (u32 k = 0; k < 2; ++k) {
+                    errors[k].push_back(std::abs(est[k] - truth)
+                                        / std::max(truth, 1.0));
+                }
+            }
+            f64 median[2];
+            for (u32 k = 0; k < 2; ++k) {
+                std::nth_element(errors[k].begin(),
+                                 errors[k].begin() + errors[k].size() / 2,
+                                 errors[k].end());
+                median[k] = errors[k][errors[k].size() / 2];
+            }
+            if (median[0] > median[1]) {
+                throw std::runtime_error(
+                    "window: medians off by " + std::to_string(median[0])
+                    + ", one sub-sketch by " + std::to_string(median[1]));
+            }
+
+            // a flow only the head keeps
+            constexpr u32 probe = 0xFFFF0000;
+            Sub alone(mem);
+            for (u32 i = 0; i < 64; ++i) {
+                window.append(probe, 10);
+                alone.append(probe, 10);
+            }
+            if (window.quantile(probe, 0.5)
+                    != alone.histogram(probe).quantile(0.5)) {
+                throw std::runtime_error(
+                    "window: a flow of one sub-sketch took in the traffic"
+                    " of the others");
+            }
+        }
+
+        // what each rotation used to pay on the ingestion thread
+        Sub sub(mem);
+        for (u64 i = 0; i < period; ++i) {
+            sub.append(items[i].id, items[i].value);
+        }
+        auto clear_start = steady_clock::now();
+        sub.clear();
+        auto clear_end = steady_clock::now();
+
+        if (t >= config.warmup) {
+            f64 ns = duration_cast<nanoseconds>(end - start).count();
+            res[0].mops.push_back(items.size() * 1e3 / ns);
+            res[1].mops.push_back(res[1].ops * 1e3 / rotate_ns);
+            res[2].mops.push_back(1e3 / duration_cast<nanoseconds>(
+                clear_end - clear_start).count());
+        }
+    }
+
+    // no append comes to rotate an idle window, the periods still pass
+    Window idle(windows, 0, milliseconds(1), mem);
+    for (u64 i = 0; i < period; ++i) {
+        idle.append(items[i].id, items[i].value);
+    }
+    std::this_thread::sleep_for(milliseconds(windows + 1));
+    if (!idle.flows().empty() || !idle.histogram(items[0].id).empty()) {
+        throw std::runtime_error("window: an idle window kept its items");
+    }
+
+    for (BenchResult& r : res) {
+        r.tp = BenchSummary::of(r.mops);
+        std::fill(r.perOp, r.perOp + PerfCounters::NUM_EVENTS, -1);
+        if (mb.wants(r.name)) {
+            mb.add(r);
+        }
+    }
+}
+
+/// @brief Benchmark opening a sketch file by loading it and by mapping it
+///        as an @c AndorView, and querying each.
+/// @details Every trial checks that the view answers as the loaded sketch.
+/// @throw std::runtime_error if the check fails.
+void bench_andor_file(MicroBench& mb) {
+    const string names[] = {"andor/file/load", "andor/file/view",
+                            "andor/file/query/loaded", "andor/file/query/view"};
+    if (std::none_of(std::begin(names), std::end(names),
+                     [&mb](const string& name) { return mb.wants(name); })) {
+        return;
+    }
+    using Sketch = AndorSketch<DDSketch>;
+    constexpr u64 mem = 64 << 20;
+
+    vector<FlowItem> items(trial_items);
+    SyntheticTrace(SyntheticConfig::parse("synth:flows=1e5,items=1e6"))
+        .read(items.data(), items.size());
+    const string path = (std::filesystem::temp_directory_path()
+                         / "microbench_andor.sk").string();
+    vector<u32> ids;
+    {
+        Sketch sketch(mem, 3, 0);
+        for (const FlowItem& item : items) {
+            sketch.append(item.id, item.value);
+        }
+        sketch.save(path);
+        for (const FlowItem& item : items) {
+            if (ids.size() < 4096 && sketch.type(item.id) != TINY) {
+                ids.push_back(item.id);
+            }
+        }
+    }
+
+    const BenchConfig& config = mb.settings();
+    BenchResult res[4];
+    for (u32 k = 0; k < 4; ++k) {
+        res[k].name = names[k];
+        res[k].ops = k < 2 ? 1 : ids.size();
+    }
+
+    for (u32 t = 0; t < config.warmup + config.trials; ++t) {
+        Sketch loaded(1 << 20, 3, 0);
+        auto start = steady_clock::now();
+        loaded.load(path);
+        auto loaded_at = steady_clock::now();
+        AndorView<> view(path);
+        auto viewed_at = steady_clock::now();
+
+        vector<u32> answers[2];
+        steady_clock::time_point done[2];
+        for (u32 k = 0; k < 2; ++k) {
+            const Framework& fw = k == 0 ? static_cast<Framework&>(loaded)
+                                         : view;
+            for (u32 id : ids) {
+                answers[k].push_back(fw.quantile(id, 0.99));
+            }
+            done[k] = steady_clock::now();
+        }
+        if (answers[0] != answers[1] || loaded.flows() != view.flows()) {
+            std::remove(path.c_str());
+            throw std::runtime_error(
+                "andor/file: the view answers unlike the loaded sketch");
+        }
+
+        if (t >= config.warmup) {
+            steady_clock::time_point from[] = {start, loaded_at, viewed_at,
+                                               done[0]};
+            steady_clock::time_point to[] = {loaded_at, viewed_at, done[0],
+                                             done[1]};
+            for (u32 k = 0; k < 4; ++k) {
+                f64 ns = duration_cast<nanoseconds>(to[k] - from[k]).count();
+                res[k].mops.push_back(res[k].ops * 1e3 / ns);
+            }
+        }
+    }
+    std::remove(path.c_str());
+
+    for (BenchResult& r : res) {
+        r.tp = BenchSummary::of(r.mops);
+        std::fill(r.perOp, r.perOp + PerfCounters::NUM_EVENTS, -1);
+        if (mb.wants(r.name)) {
+            mb.add(r);
+        }
+    }
+}
+
+void print_usage(char* file) {
+    cout << "usage: " << file << " [<filter>] [<trials>]" << endl;
+    cout << endl;
+
+    cout << "Meaning of arguments: " << endl;
+    cout << "    filter          run benchmarks whose name contains it,"
+         << " e.g. dd/append or /exp" << endl;
+    cout << "    trials          timed trials per benchmark, by default 5"
+         << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    BenchConfig config;
+    string filter = argc > 1 ? argv[1] : "";
+    if (argc > 2) {
+        config.trials = stoul(argv[2]);
+    }
+    MicroBench mb(config, filter);
+
+    vec_f64 ranks(1024);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<f64> unit(0.0, 1.0);
+    for (f64& r : ranks) {
+        r = unit(gen);
+    }
+
+    for (u32 d = 0; d < NUM_DISTS; ++d) {
+        for (u32 size_log : size_logs) {
+            u32 num = 1u << size_log;
+            string suffix = "/n=" + std::to_string(num) + "/" + dist_names[d];
+            vec_u32 values = gen_values(Dist(d), num, 1);
+
+            bench_metas(mb, suffix, values, size_log, ranks);
+            bench_histogram(mb, suffix, values,
+                            gen_values(Dist(d), num, 2), ranks);
+            bench_sorted_view(mb, suffix, values);
+        }
+    }
+    bench_tiny_counter(mb, gen_values(UNIFORM, 1 << 10, 1));
+    bench_hash(mb);
+    bench_synthetic(mb);
+    bench_concurrent(mb);
+    bench_snapshot(mb);
+    bench_window(mb);
+    bench_andor_file(mb);
+
+    string output_name = static_cast<string>(res_path) + "microbench.json";
+    ofstream out(output_name);
+    assert(out.is_open());
+    mb.writeJson(out);
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+#include "include/test/andor_tuner.hpp"
+
+using namespace sketch;
+
+void print_usage(char* file) {
+    cout << "usage: " << file
+         << " [--meta <meta>] [--pcap <file>]"
+         << " <memory> <dataset> <hash-num> <sample>"
+         << " [<seed>] [<output>]"
+         << endl;
+    cout << endl;
+
+    cout << "Meaning of arguments: " << endl;
+    cout << "    --meta          dd, mreq, tdigest or ddc, by default dd"
+         << endl;
+    cout << "    memory          memory budget in KB" << endl;
+    cout << "    --pcap          pcap or pcapng capture of M4 telemetry read"
+         << " as the pcap dataset" << endl;
+    cout << "    dataset         caida, imc, seattle, MAWI, or pcap" << endl;
+    cout << "    hash-num        number of hash functions per level" << endl;
+    cout << "    sample          items of the dataset to tune on, 0 for all"
+         << endl;
+    cout << "    seed            random seed, by default 0" << endl;
+    cout << "    output          file of the chosen configuration, by default"
+         << " andor_<meta>_<dataset>.cfg in the result directory" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    char* program = argv[0];
+    u32 meta = DD;
+    while (argc > 2 && string(argv[1]).rfind("--", 0) == 0) {
+        string flag = argv[1];
+        if (flag == "--meta") {
+            meta = parse_meta(argv[2]);
+        } else if (flag == "--pcap") {
+            pcap_path = argv[2];
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc < 5 || argc > 7 || (string(argv[2]) == "pcap" && !pcap_path)) {
+        print_usage(program);
+        return 1;
+    }
+
+    u64 memory = stoul(argv[1]) * 1024;
+    string dataset = argv[2];
+    u32 hash_num = stoul(argv[3]);
+    u64 sample_num = stoull(argv[4]);
+    u32 seed = argc >= 6 ? stoul(argv[5]) : 0;
+    string output = argc == 7 ? string(argv[6])
+                    : static_cast<string>(res_path) + "andor_"
+                      + meta_name(meta) + "_" + dataset + ".cfg";
+
+    auto sample = load_dataset(dataset);
+    if (sample_num != 0 && sample_num < sample.size()) {
+        sample.resize(sample_num);
+    }
+
+    dispatch_meta(meta, [&](auto tag) {
+        AndorTuner<typename decltype(tag)::type> tuner(memory, hash_num,
+                                                       seed, 0.1);
+        tuner.run(sample);
+        tuner.report(cout);
+
+        tuner.best().config.save(output);
+    });
+    cout << "Configuration saved to " << output << endl;
+}